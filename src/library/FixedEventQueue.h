@@ -0,0 +1,212 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_FIXEDEVENTQUEUE_H_INCLUDED
+#define LIBTAS_FIXEDEVENTQUEUE_H_INCLUDED
+
+/* Maximum number of events in each of our event queues */
+#define EVENTQUEUE_MAXLEN 1024
+
+namespace libtas {
+/* Storage for our event queues, with a fixed capacity. All events are stored
+ * inside a preallocated array of slots, so that inserting or removing events
+ * never allocates memory (which is important when events are pushed while
+ * a savestate is being made), and events are kept close together in memory.
+ *
+ * Events are chained in insertion order, and also chained by event type, so
+ * that getting the first event of a given type does not need to go through
+ * all the events of the queue. Event types are gathered in a fixed number
+ * of buckets, with each bucket keeping a count of its events. Lookups by type
+ * always return the oldest matching event first.
+ *
+ * This class is not thread-safe, callers must protect it with their own lock.
+ */
+template <typename T, int CAPACITY, int BUCKETS>
+class FixedEventQueue
+{
+    public:
+        /* Index value returned when there is no event */
+        enum { NONE = -1 };
+
+        FixedEventQueue() { clear(); }
+
+        /* Remove all events */
+        void clear()
+        {
+            for (int i = 0; i < CAPACITY; i++) {
+                slots[i].next = (i == (CAPACITY - 1)) ? NONE : (i + 1);
+            }
+            free_head = 0;
+            head = NONE;
+            tail = NONE;
+            count = 0;
+            seq = 0;
+
+            for (int b = 0; b < BUCKETS; b++) {
+                bucket_head[b] = NONE;
+                bucket_tail[b] = NONE;
+                bucket_count[b] = 0;
+            }
+        }
+
+        int size() const { return count; }
+        bool empty() const { return count == 0; }
+        bool full() const { return count == CAPACITY; }
+
+        /* Insert an event at the end of the queue. Returns false if the queue
+         * is full */
+        bool push(const T& event, int type)
+        {
+            if (free_head == NONE)
+                return false;
+
+            int i = free_head;
+            Slot& slot = slots[i];
+            free_head = slot.next;
+
+            slot.event = event;
+            slot.type = type;
+            slot.seq = seq++;
+
+            /* Chain in insertion order */
+            slot.prev = tail;
+            slot.next = NONE;
+            if (tail != NONE)
+                slots[tail].next = i;
+            else
+                head = i;
+            tail = i;
+
+            /* Chain in the type bucket */
+            int b = bucket(type);
+            slot.type_prev = bucket_tail[b];
+            slot.type_next = NONE;
+            if (bucket_tail[b] != NONE)
+                slots[bucket_tail[b]].type_next = i;
+            else
+                bucket_head[b] = i;
+            bucket_tail[b] = i;
+            bucket_count[b]++;
+
+            count++;
+            return true;
+        }
+
+        /* Remove the event at index i */
+        void erase(int i)
+        {
+            Slot& slot = slots[i];
+
+            if (slot.prev != NONE)
+                slots[slot.prev].next = slot.next;
+            else
+                head = slot.next;
+            if (slot.next != NONE)
+                slots[slot.next].prev = slot.prev;
+            else
+                tail = slot.prev;
+
+            int b = bucket(slot.type);
+            if (slot.type_prev != NONE)
+                slots[slot.type_prev].type_next = slot.type_next;
+            else
+                bucket_head[b] = slot.type_next;
+            if (slot.type_next != NONE)
+                slots[slot.type_next].type_prev = slot.type_prev;
+            else
+                bucket_tail[b] = slot.type_prev;
+            bucket_count[b]--;
+
+            slot.next = free_head;
+            free_head = i;
+            count--;
+        }
+
+        /* Index of the oldest event, or NONE */
+        int front() const { return head; }
+
+        /* Index of the event inserted after the event at index i, or NONE */
+        int next(int i) const { return slots[i].next; }
+
+        /* Index of the oldest event of a given type, or NONE */
+        int firstOfType(int type) const
+        {
+            int i = bucket_head[bucket(type)];
+            while ((i != NONE) && (slots[i].type != type))
+                i = slots[i].type_next;
+            return i;
+        }
+
+        /* Index of the next event with the same type as the event at index
+         * i, or NONE */
+        int nextOfType(int i) const
+        {
+            int type = slots[i].type;
+            i = slots[i].type_next;
+            while ((i != NONE) && (slots[i].type != type))
+                i = slots[i].type_next;
+            return i;
+        }
+
+        /* Returns if the queue may contain an event of this type. This is
+         * exact unless several types share the same bucket. */
+        bool mayContainType(int type) const { return bucket_count[bucket(type)] > 0; }
+
+        T& at(int i) { return slots[i].event; }
+        int typeAt(int i) const { return slots[i].type; }
+
+        /* Insertion order of the event at index i, used to compare the age
+         * of events of different types */
+        unsigned long orderAt(int i) const { return slots[i].seq; }
+
+    private:
+        struct Slot {
+            T event;
+            int type;
+            unsigned long seq;
+            int prev, next;
+            int type_prev, type_next;
+        };
+
+        static int bucket(int type)
+        {
+            unsigned int t = static_cast<unsigned int>(type);
+            /* Spread event types that are grouped by high byte (SDL) */
+            return static_cast<int>((t + (t >> 8) * 17) % BUCKETS);
+        }
+
+        Slot slots[CAPACITY];
+
+        /* First and last events in insertion order */
+        int head, tail;
+
+        /* First free slot */
+        int free_head;
+
+        int count;
+        unsigned long seq;
+
+        int bucket_head[BUCKETS];
+        int bucket_tail[BUCKETS];
+        int bucket_count[BUCKETS];
+};
+
+}
+
+#endif
@@ -21,6 +21,7 @@
 #include "logging.h"
 #include "GlobalState.h"
 #include "checkpoint/ThreadManager.h"
+#include "../shared/sockethelpers.h"
 
 #include <time.h>
 
@@ -33,7 +34,9 @@ void PerfTimer::switchTimer(TimerType type)
         TimeHolder end_time;
         NATIVECALL(clock_gettime(CLOCK_MONOTONIC, &end_time));
         
-        elapsed[current_type] += (end_time - current_time[current_type]);
+        TimeHolder delta = end_time - current_time[current_type];
+        elapsed[current_type] += delta;
+        addCall(current_type, delta);
     }
     
     /* Start new timer */
@@ -62,6 +65,59 @@ void PerfTimer::print()
     }
 }
 
+void PerfTimer::addCall(int counter, const TimeHolder& duration)
+{
+    uint64_t ns = static_cast<uint64_t>(duration.tv_sec) * 1000000000ULL + duration.tv_nsec;
+    frame_ns[counter].fetch_add(ns, std::memory_order_relaxed);
+    frame_calls[counter].fetch_add(1, std::memory_order_relaxed);
+
+    /* Histogram bucket from the log2 of the duration in microseconds */
+    uint64_t us = ns / 1000;
+    int bucket = (us == 0) ? 0 : (64 - __builtin_clzll(us));
+    if (bucket >= PERF_HISTOGRAM_SIZE)
+        bucket = PERF_HISTOGRAM_SIZE - 1;
+    frame_histogram[counter][bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void PerfTimer::addCalls(int counter, uint64_t calls)
+{
+    frame_calls[counter].fetch_add(calls, std::memory_order_relaxed);
+}
+
+void PerfTimer::endFrame(uint64_t framecount)
+{
+    addCalls(PerfCounters::HOOK_CALLS, hook_calls.exchange(0, std::memory_order_relaxed));
+
+    PerfCounters* shared = getSharedPerfCounters();
+
+    if (shared)
+        shared->beginWrite();
+
+    for (int c = 0; c < PerfCounters::COUNTER_COUNT; c++) {
+        uint64_t ns = frame_ns[c].exchange(0, std::memory_order_relaxed);
+        uint64_t calls = frame_calls[c].exchange(0, std::memory_order_relaxed);
+
+        if (!shared) {
+            for (int b = 0; b < PERF_HISTOGRAM_SIZE; b++)
+                frame_histogram[c][b].store(0, std::memory_order_relaxed);
+            continue;
+        }
+
+        PerfCounters::Value& value = shared->data.values[c];
+        value.frame_ns = ns;
+        value.frame_calls = calls;
+        value.total_ns += ns;
+        value.total_calls += calls;
+        for (int b = 0; b < PERF_HISTOGRAM_SIZE; b++)
+            value.histogram[b] += frame_histogram[c][b].exchange(0, std::memory_order_relaxed);
+    }
+
+    if (shared) {
+        shared->data.framecount = framecount;
+        shared->endWrite();
+    }
+}
+
 PerfTimerCall::PerfTimerCall(LogCategoryFlag lcf)
 {
     if ((lcf & LCF_TIMEGET) && ThreadManager::isMainThread() && perfTimer.currentTimer() == PerfTimer::GameTimer) {
@@ -76,6 +132,18 @@ PerfTimerCall::~PerfTimerCall()
         perfTimer.switchTimer(PerfTimer::GameTimer);
 }
 
+PerfScope::PerfScope(int c) : counter(c)
+{
+    NATIVECALL(clock_gettime(CLOCK_MONOTONIC, &start_time));
+}
+
+PerfScope::~PerfScope()
+{
+    TimeHolder end_time;
+    NATIVECALL(clock_gettime(CLOCK_MONOTONIC, &end_time));
+    perfTimer.addCall(counter, end_time - start_time);
+}
+
 PerfTimer perfTimer;
 
 }
@@ -22,6 +22,10 @@
 
 #include "TimeHolder.h"
 #include "../shared/lcf.h"
+#include "../shared/PerfCounters.h"
+
+#include <atomic>
+#include <stdint.h>
 
 namespace libtas {
 
@@ -45,11 +49,45 @@ class PerfTimer
         TimerType currentTimer();
         void print();
 
+        /* Add a call with its duration to a performance counter. This can
+         * be called from any thread. */
+        void addCall(int counter, const TimeHolder& duration);
+
+        /* Add a number of calls without duration to a performance counter */
+        void addCalls(int counter, uint64_t calls);
+
+        /* Count a call to a hooked function */
+        void countHookCall() {hook_calls.fetch_add(1, std::memory_order_relaxed);}
+
+        /* Publish the performance counters of the last frame into the memory
+         * shared with the program, and start counting the next frame */
+        void endFrame(uint64_t framecount);
+
     private:
         
         TimeHolder current_time[TotalTimer];
         TimeHolder elapsed[TotalTimer];
         TimerType current_type = NoTimer;
+
+        /* Counters of the current frame. Totals are only stored in the
+         * shared memory, so that they are not modified by state loading. */
+        std::atomic<uint64_t> frame_ns[PerfCounters::COUNTER_COUNT];
+        std::atomic<uint64_t> frame_calls[PerfCounters::COUNTER_COUNT];
+        std::atomic<uint32_t> frame_histogram[PerfCounters::COUNTER_COUNT][PERF_HISTOGRAM_SIZE];
+        std::atomic<uint64_t> hook_calls;
+};
+
+static_assert(static_cast<int>(PerfTimer::TotalTimer) == static_cast<int>(PerfCounters::SAVESTATE), "Timers and performance counters don't match");
+
+/* Add the duration of a scope to a performance counter */
+class PerfScope
+{
+public:
+    PerfScope(int counter);
+    ~PerfScope();
+private:
+    int counter;
+    TimeHolder start_time;
 };
 
 class PerfTimerCall
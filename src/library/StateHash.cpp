@@ -0,0 +1,115 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "StateHash.h"
+#include "logging.h"
+
+#include <string.h>
+#include <unistd.h>
+#ifdef __unix__
+#include <sys/uio.h>
+#elif defined(__APPLE__) && defined(__MACH__)
+#include <mach/mach.h>
+#include <mach/vm_map.h>
+#endif
+
+#define MAX_RANGES 32
+
+namespace libtas {
+
+static struct {
+    uintptr_t addr;
+    size_t size;
+} ranges[MAX_RANGES];
+
+static int range_count = 0;
+
+/* Chunk buffer, so that we don't allocate memory at each frame */
+static uint64_t buffer[8192];
+
+void StateHash::addRange(uintptr_t addr, size_t size)
+{
+    if (range_count == MAX_RANGES) {
+        debuglogstdio(LCF_ERROR, "Too many state hash ranges, ignoring %p", reinterpret_cast<void*>(addr));
+        return;
+    }
+
+    ranges[range_count].addr = addr;
+    ranges[range_count].size = size;
+    range_count++;
+}
+
+bool StateHash::isEnabled()
+{
+    return range_count > 0;
+}
+
+/* Copy our own memory without faulting if it is not mapped */
+static size_t readMemory(void* local_addr, uintptr_t remote_addr, size_t size)
+{
+#ifdef __unix__
+    struct iovec local, remote;
+    local.iov_base = local_addr;
+    local.iov_len = size;
+    remote.iov_base = reinterpret_cast<void*>(remote_addr);
+    remote.iov_len = size;
+
+    ssize_t ret = process_vm_readv(getpid(), &local, 1, &remote, 1, 0);
+    return (ret < 0) ? 0 : ret;
+#elif defined(__APPLE__) && defined(__MACH__)
+    vm_size_t ret_size = size;
+    kern_return_t error = vm_read_overwrite(mach_task_self(), remote_addr, size, reinterpret_cast<vm_address_t>(local_addr), &ret_size);
+    return (error == KERN_SUCCESS) ? ret_size : 0;
+#endif
+}
+
+uint64_t StateHash::compute()
+{
+    /* FNV-1a, processing 64-bit words instead of bytes */
+    static const uint64_t FNV_PRIME = 0x100000001b3ULL;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (int r = 0; r < range_count; r++) {
+        size_t offset = 0;
+        while (offset < ranges[r].size) {
+            size_t size = ranges[r].size - offset;
+            if (size > sizeof(buffer))
+                size = sizeof(buffer);
+
+            size_t ret = readMemory(buffer, ranges[r].addr + offset, size);
+            if (ret < size)
+                memset(reinterpret_cast<char*>(buffer) + ret, 0, size - ret);
+
+            /* Pad the last word with zeros */
+            size_t words = (size + 7) / 8;
+            if (size % 8)
+                memset(reinterpret_cast<char*>(buffer) + size, 0, words * 8 - size);
+
+            for (size_t i = 0; i < words; i++) {
+                hash ^= buffer[i];
+                hash *= FNV_PRIME;
+            }
+            offset += size;
+        }
+    }
+
+    return hash;
+}
+
+}
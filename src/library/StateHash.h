@@ -0,0 +1,42 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_STATEHASH_H_INCL
+#define LIBTAS_STATEHASH_H_INCL
+
+#include <cstdint>
+#include <cstddef>
+
+namespace libtas {
+namespace StateHash {
+
+/* Add a memory range to be hashed at each frame boundary */
+void addRange(uintptr_t addr, size_t size);
+
+/* Returns if there is any memory range to hash */
+bool isEnabled();
+
+/* Compute the hash of all memory ranges. Ranges that cannot be read are
+ * hashed as zeros instead of crashing the game. */
+uint64_t compute();
+
+}
+}
+
+#endif
@@ -19,12 +19,19 @@
 
 #include "AudioBuffer.h"
 #include "DecoderMSADPCM.h"
-#include "BinaryIStream.h"
 
 #include "logging.h"
+#include <algorithm>
 
 namespace libtas {
 
+/* Maximum memory used by fully decoded compressed buffers. Decoded samples
+ * live in the game memory, so they are also stored in savestates */
+static const size_t MAX_DECODED_BYTES = 64 * 1024 * 1024;
+
+/* Memory currently used by fully decoded compressed buffers */
+static size_t decodedBytes = 0;
+
 AudioBuffer::AudioBuffer(void)
 {
     id = 0;
@@ -39,6 +46,12 @@ AudioBuffer::AudioBuffer(void)
     blockSize = 0;
     loop_point_beg = 0;
     loop_point_end = 0;
+    rawComplete = false;
+}
+
+AudioBuffer::~AudioBuffer()
+{
+    discardRawSamples();
 }
 
 void AudioBuffer::makeSilent() {
@@ -50,8 +63,49 @@ void AudioBuffer::makeSilent() {
     }
 }
 
+void AudioBuffer::copySamples(const void* data, int dataSize)
+{
+    samples.resize(dataSize);
+    memcpy(samples.data(), data, dataSize);
+    size = dataSize;
+    discardRawSamples();
+}
+
+void AudioBuffer::discardRawSamples()
+{
+    if (rawComplete) {
+        decodedBytes -= rawSamples.size() * sizeof(int16_t);
+        /* Release the memory of the decoded buffer */
+        std::vector<int16_t>().swap(rawSamples);
+        rawComplete = false;
+    }
+    else {
+        rawSamples.clear();
+    }
+}
+
+bool AudioBuffer::decodeAll()
+{
+    size_t rawBytes = static_cast<size_t>(sampleSize) * nbChannels * sizeof(int16_t);
+    if ((decodedBytes + rawBytes) > MAX_DECODED_BYTES)
+        return false;
+
+    rawSamples.resize(sampleSize * nbChannels);
+    int decodedSamples = DecoderMSADPCM::toPCM(samples.data(), std::min(size, static_cast<int>(samples.size())), nbChannels, blockSamples, rawSamples.data());
+    rawSamples.resize(decodedSamples * nbChannels);
+
+    decodedBytes += rawSamples.size() * sizeof(int16_t);
+    rawComplete = true;
+
+    debuglogstdio(LCF_SOUND, "   Decompressed buffer %d: %d B -> %d B", id, size, rawSamples.size() * sizeof(int16_t));
+    return true;
+}
+
 void AudioBuffer::update(void)
 {
+    /* Parameters may have changed, decoded samples must be computed again */
+    discardRawSamples();
+
     switch (format) {
         case SAMPLE_FMT_U8:
             bitDepth = 8;
@@ -152,9 +206,20 @@ int AudioBuffer::getSamples(uint8_t* &outSamples, int nbSamples, int position, b
             else
                 /* We reach the end of the buffer */
                 return (sampleSize - position);
-        case SAMPLE_FMT_MSADPCM:
+        case SAMPLE_FMT_MSADPCM: {
+
+            /*** 1. Use the whole decoded buffer if available ***/
 
-            /*** 1. Compute which portion of our buffer we decompress ***/
+            if (rawComplete || decodeAll()) {
+                int rawNbSamples = rawSamples.size() / nbChannels;
+                if (position >= rawNbSamples)
+                    return 0;
+
+                outSamples = reinterpret_cast<uint8_t*>(&rawSamples[position*nbChannels]);
+                return std::min(nbSamples, rawNbSamples - position);
+            }
+
+            /*** 2. Otherwise, compute which portion of our buffer we decompress ***/
 
             /* Number of blocks to read */
             int firstBlock = position / blockSamples;
@@ -166,28 +231,27 @@ int AudioBuffer::getSamples(uint8_t* &outSamples, int nbSamples, int position, b
             /* Size of the portion of compressed buffer to decompress */
             int portionSize = std::min(size - firstBlock*blockSize, (lastBlock-firstBlock)*blockSize);
 
-            /* We wrap this portion into an home-made binary stream */
-            BinaryIStream sourceStream(firstSamples, portionSize);
-
-            /*** 2. Prepare the uncompressed buffer ***/
+            /*** 3. Prepare the uncompressed buffer ***/
 
             /* Compute the maximum uncompressed size */
-            int rawSize = nbSamples * nbChannels;
-            rawSamples.clear();
-            rawSamples.reserve(rawSize);
+            int rawSize = (lastBlock-firstBlock) * blockSamples * nbChannels;
+            rawSamples.resize(rawSize);
 
-            /*** 3. Call the decompression routine ***/
-            DecoderMSADPCM::toPCM(sourceStream, nbChannels, blockSamples, rawSamples);
+            /*** 4. Call the decompression routine ***/
+            int decodedSamples = DecoderMSADPCM::toPCM(firstSamples, portionSize, nbChannels, blockSamples, rawSamples.data());
+            rawSamples.resize(decodedSamples * nbChannels);
 
-            /*** 4. Return the proper values ***/
+            /*** 5. Return the proper values ***/
             int rawPosition = position % blockSamples;
+            if (rawPosition >= decodedSamples)
+                return 0;
+
             outSamples = reinterpret_cast<uint8_t*>(&rawSamples[rawPosition*nbChannels]);
-            int totSamples = nbSamples;
-            if ((rawSamples.size()/nbChannels - rawPosition) < static_cast<size_t>(nbSamples))
-                totSamples = rawSamples.size()/nbChannels - rawPosition;
+            int totSamples = std::min(nbSamples, decodedSamples - rawPosition);
 
-            debuglogstdio(LCF_SOUND, "   Decompressed %d B -> %d B", portionSize, rawSamples.size());
+            debuglogstdio(LCF_SOUND, "   Decompressed %d B -> %d B", portionSize, rawSamples.size() * sizeof(int16_t));
             return totSamples;
+        }
     }
     return 0;
 }
@@ -33,6 +33,7 @@ class AudioBuffer
 {
     public:
         AudioBuffer();
+        ~AudioBuffer();
 
         /* Return if the buffer size is correct regarding buffer parameters */
         bool checkSize(void);
@@ -54,6 +55,11 @@ class AudioBuffer
         /* Make the whole buffer silent */
         void makeSilent();
 
+        /* Copy samples into the buffer and set its size. The memory of the
+         * buffer is kept when shrinking, so recycled buffers do not
+         * allocate */
+        void copySamples(const void* data, int dataSize);
+
         /*** Primary parameters ***/
 
         /* Sample format */
@@ -95,9 +101,18 @@ class AudioBuffer
         /* Number of samples in a block for compressed formats */
         int blockSamples;
 
-        /* In the case of compressed audio, temporary uncompressed buffer */
+        /* In the case of compressed audio, uncompressed samples. The whole
+         * buffer is decoded on first access if it fits in the decoding budget,
+         * otherwise only the blocks of the last access are stored */
         std::vector<int16_t> rawSamples;
 
+        /* Is rawSamples storing the whole decoded buffer */
+        bool rawComplete;
+
+        /* Discard the decoded samples. Must be called when compressed
+         * samples are modified */
+        void discardRawSamples();
+
         /* Bit depth of the buffer. Computed from format */
         int bitDepth;
 
@@ -113,6 +128,11 @@ class AudioBuffer
          * Computed from blockSamples and format.
         */
         int blockSize;
+
+    private:
+        /* Decode the whole compressed buffer into rawSamples, if it fits in
+         * the decoding budget. Returns if the buffer was decoded */
+        bool decodeAll();
 };
 }
 
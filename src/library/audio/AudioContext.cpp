@@ -20,6 +20,7 @@
 #include "AudioContext.h"
 #include "AudioBuffer.h"
 #include "AudioSource.h"
+#include "AudioMixer.h"
 #ifdef __linux__
 #include "AudioPlayerAlsa.h"
 #elif defined(__APPLE__) && defined(__MACH__)
@@ -27,6 +28,7 @@
 #endif
 
 #include "logging.h"
+#include "PerfTimer.h"
 #include "global.h" // Global::shared_config
 #include "GlobalState.h"
 #include "checkpoint/ThreadManager.h" // isMainThread()
@@ -37,6 +39,13 @@
 #define MAXBUFFERS 2048 // Max I've seen so far: 960
 #define MAXSOURCES 256 // Max I've seen so far: 112
 
+/* Frequency of the audio fingerprint, low enough to be cheap to compute */
+#define FINGERPRINT_FREQUENCY 6000
+
+/* FNV-1a parameters for hashing the fingerprint */
+#define FINGERPRINT_INIT 0xcbf29ce484222325ULL
+#define FINGERPRINT_PRIME 0x100000001b3ULL
+
 namespace libtas {
 
 /* Helper function to convert ticks into a number of bytes in the audio buffer */
@@ -54,6 +63,20 @@ static int ticksToBytes(struct timespec ticks, int alignSize, int frequency)
     return static_cast<int>(bytes);
 }
 
+/* Helper function to convert ticks into a number of fingerprint samples */
+static int ticksToFingerprintSamples(struct timespec ticks)
+{
+    static int64_t samples_frac = 0;
+    uint64_t nsecs = static_cast<uint64_t>(ticks.tv_sec) * 1000000000 + ticks.tv_nsec;
+    uint64_t samples = (nsecs * FINGERPRINT_FREQUENCY) / 1000000000;
+    samples_frac += (nsecs * FINGERPRINT_FREQUENCY) % 1000000000;
+    if (samples_frac >= 500000000) {
+        samples_frac -= 1000000000;
+        samples++;
+    }
+    return static_cast<int>(samples);
+}
+
 /* Helper function to convert a number of samples in the audio buffer into ticks */
 static struct timespec samplesToTicks(int nbSamples, int frequency)
 {
@@ -73,10 +96,11 @@ static struct timespec samplesToTicks(int nbSamples, int frequency)
 }
 
 
-AudioContext::AudioContext(void)
+AudioContext::AudioContext(void) : buffers(MAXBUFFERS), sources(MAXSOURCES)
 {
     outVolume = 1.0f;
     audio_thread = 0;
+    fingerprint = FINGERPRINT_INIT;
     init();
 }
 
@@ -85,6 +109,14 @@ AudioContext& AudioContext::get() {
     return instance;
 }
 
+uint64_t AudioContext::takeFingerprint()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t hash = fingerprint;
+    fingerprint = FINGERPRINT_INIT;
+    return hash;
+}
+
 void AudioContext::init(void)
 {
     outBitDepth = Global::shared_config.audio_bitdepth;
@@ -97,113 +129,71 @@ void AudioContext::init(void)
 
 int AudioContext::createBuffer(void)
 {
-    if (buffers.size() >= MAXBUFFERS)
+    bool recycled;
+    int id = buffers.create(recycled);
+    if (id < 0)
         return -1;
 
-    /* Check if we can recycle a deleted buffer */
-    if (!buffers_pool.empty()) {
-        buffers.push_front(buffers_pool.front());
-        buffers_pool.pop_front();
-        return buffers.front()->id;
-    }
-
-    /* If not, we create a new buffer.
-     * The next available id equals the size of the buffer list + 1
-     * (ids must start by 1, because 0 is reserved for no buffer)
-     */
-    auto newab = std::make_shared<AudioBuffer>();
-    newab->id = buffers.size() + 1;
-    buffers.push_front(newab);
-    return newab->id;
+    buffers.find(id)->id = id;
+    return id;
 }
 
 void AudioContext::deleteBuffer(int id)
 {
-    buffers.remove_if([id,this](std::shared_ptr<AudioBuffer> const& buffer)
-        {
-            if (buffer->id == id) {
-                /* Push the deleted buffer into the pool */
-                buffers_pool.push_front(buffer);
-                return true;
-            }
-            return false;
-        });
+    /* Return the decoded samples to the decoding budget */
+    AudioBuffer* ab = buffers.find(id);
+    if (ab)
+        ab->discardRawSamples();
+    buffers.remove(id);
 }
 
 bool AudioContext::isBuffer(int id) const
 {
-    for (auto const& buffer : buffers) {
-        if (buffer->id == id)
-            return true;
-    }
-
-    return false;
+    return buffers.find(id) != nullptr;
 }
 
 std::shared_ptr<AudioBuffer> AudioContext::getBuffer(int id) const
 {
-    for (auto& buffer : buffers) {
-        if (buffer->id == id)
-            return buffer;
-    }
+    return buffers.get(id);
+}
 
-    return nullptr;
+AudioBuffer* AudioContext::findBuffer(int id) const
+{
+    return buffers.find(id);
 }
 
 int AudioContext::createSource(void)
 {
-    if (sources.size() >= MAXSOURCES)
+    bool recycled;
+    int id = sources.create(recycled);
+    if (id < 0)
         return -1;
 
-    /* Check if we can recycle a deleted source */
-    if (!sources_pool.empty()) {
-        sources.push_front(sources_pool.front());
-        sources_pool.pop_front();
-        sources.front()->init();
-        return sources.front()->id;
-    }
-
-    /* If not, we create a new source.
-     * The next available id equals the size of the source list + 1
-     * (ids must start by 1, because 0 is reserved for no source)
-     */
-    auto newas = std::make_shared<AudioSource>();
-    newas->id = sources.size() + 1;
-    sources.push_front(newas);
-    return newas->id;
+    AudioSource* source = sources.find(id);
+    if (recycled)
+        source->init();
+    source->id = id;
+    return id;
 }
 
 void AudioContext::deleteSource(int id)
 {
-    sources.remove_if([id,this](std::shared_ptr<AudioSource> const& source)
-        {
-            if (source->id == id) {
-                /* Push the deleted source into the pool */
-                sources_pool.push_front(source);
-                return true;
-            }
-            return false;
-        });
+    sources.remove(id);
 }
 
 bool AudioContext::isSource(int id) const
 {
-    for (auto& source : sources) {
-        if (source->id == id)
-            return true;
-    }
-
-    return false;
+    return sources.find(id) != nullptr;
 }
 
 std::shared_ptr<AudioSource> AudioContext::getSource(int id) const
 {
-    for (auto& source : sources) {
-        if (source->id == id)
-            return source;
-    }
+    return sources.get(id);
+}
 
-    return nullptr;
+AudioSource* AudioContext::findSource(int id) const
+{
+    return sources.find(id);
 }
 
 void AudioContext::mixAllSources(int nbSamples)
@@ -214,6 +204,8 @@ void AudioContext::mixAllSources(int nbSamples)
 
 void AudioContext::mixAllSources(struct timespec ticks)
 {
+    PerfScope ps(PerfCounters::AUDIO_MIX);
+
     /* Check that ticks is positive! */
     if (ticks.tv_sec < 0) {
         debuglogstdio(LCF_SOUND | LCF_ERROR, "Negative number of ticks for audio mixing!");
@@ -236,9 +228,28 @@ void AudioContext::mixAllSources(struct timespec ticks)
 
     pthread_t mix_thread = ThreadManager::getThreadId();
 
+    mixBus.assign(outNbSamples * outNbChannels, 0.0f);
+    bool mixed = false;
+
+    /* Also mix all sources into a mono fingerprint at a low frequency,
+     * which is still computed when fast-forward skips audio mixing */
+    float* fingerprintBusPtr = nullptr;
+    int fingerprintNbSamples = 0;
+    if (Global::shared_config.fastforward_mode & SharedConfig::FF_AUDIO_FINGERPRINT) {
+        fingerprintNbSamples = ticksToFingerprintSamples(ticks);
+        fingerprintBus.assign(fingerprintNbSamples, 0.0f);
+        fingerprintBusPtr = fingerprintBus.data();
+    }
+
     mutex.lock();
 
-    for (auto& source : sources) {
+    /* Sources can be created while the mutex is unlocked below, so we iterate
+     * over slots by index */
+    for (int slot = 0; slot < sources.slotCount(); slot++) {
+        AudioSource* source = sources.at(slot);
+        if (!source)
+            continue;
+
         /* If an audio source is filled asynchronously, and we will underrun,
          * try to wait until the source is filled.
          */
@@ -265,11 +276,32 @@ void AudioContext::mixAllSources(struct timespec ticks)
             }
         }
 
-        source->mixWith(ticks, &outSamples[0], outBytes, outBitDepth, outNbChannels, outFrequency, outVolume);
+        if (source->mixWith(ticks, mixBus.data(), outNbSamples, outBitDepth, outNbChannels, outFrequency, outVolume,
+                            fingerprintBusPtr, fingerprintNbSamples, FINGERPRINT_FREQUENCY) > 0)
+            mixed = true;
     }
     
     mutex.unlock();
 
+    /* Convert the mixing bus to the output format, clamping only once */
+    if (mixed) {
+        int nbSaturate = AudioMixer::store(mixBus.data(), outSamples.data(), outNbSamples, outNbChannels, outBitDepth);
+        if (nbSaturate > 0)
+            debuglogstdio(LCF_SOUND | LCF_WARNING, "Saturation during mixing for %d samples", nbSaturate);
+    }
+
+    if (fingerprintBusPtr) {
+        fingerprintSamples.resize(fingerprintNbSamples);
+        AudioMixer::store(fingerprintBusPtr, reinterpret_cast<uint8_t*>(fingerprintSamples.data()), fingerprintNbSamples, 1, 16);
+
+        /* FNV-1a on the 16-bit samples */
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int16_t sample : fingerprintSamples) {
+            fingerprint ^= static_cast<uint16_t>(sample);
+            fingerprint *= FINGERPRINT_PRIME;
+        }
+    }
+
     if (!isLoopback && !Global::shared_config.audio_mute) {
         /* Play the music */
 #ifdef __linux__
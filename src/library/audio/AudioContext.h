@@ -20,9 +20,10 @@
 #ifndef LIBTAS_AUDIOCONTEXT_H_INCL
 #define LIBTAS_AUDIOCONTEXT_H_INCL
 
+#include "AudioRegistry.h"
+
 #include <vector>
 #include <memory>
-#include <list>
 #include <mutex>
 
 namespace libtas {
@@ -91,6 +92,10 @@ class AudioContext
         /* Return the buffer of requested id, or nullptr if not exists */
         std::shared_ptr<AudioBuffer> getBuffer(int id) const;
 
+        /* Same as getBuffer() but returns a non-owning pointer, for queries
+         * that do not keep the buffer */
+        AudioBuffer* findBuffer(int id) const;
+
         /* Create a new source object and return an id of the source or -1 if it failed */
         int createSource(void);
 
@@ -103,10 +108,19 @@ class AudioContext
         /* Return the source of requested id, or nullptr if not exists */
         std::shared_ptr<AudioSource> getSource(int id) const;
 
+        /* Same as getSource() but returns a non-owning pointer, for queries
+         * that do not keep the source */
+        AudioSource* findSource(int id) const;
+
         /* Mix all source that are playing */
         void mixAllSources(struct timespec ticks);
         void mixAllSources(int nbSamples);
 
+        /* Return the fingerprint of the audio mixed since the last call, and
+         * reset it. The fingerprint is only computed when enabled in the
+         * fast-forward mode */
+        uint64_t takeFingerprint();
+
         /* Mutex to protect access to all audio objects */
         std::mutex mutex;
 
@@ -114,16 +128,25 @@ class AudioContext
         pthread_t audio_thread;
 
         /* Get the source and buffer lists for debug */
-        const std::list<std::shared_ptr<AudioBuffer>> getBufferList() const {return buffers;}
-        const std::list<std::shared_ptr<AudioSource>> getSourceList() const {return sources;}
+        std::vector<std::shared_ptr<AudioBuffer>> getBufferList() const {return buffers.list();}
+        std::vector<std::shared_ptr<AudioSource>> getSourceList() const {return sources.list();}
 
     private:
-        std::list<std::shared_ptr<AudioBuffer>> buffers;
-        std::list<std::shared_ptr<AudioSource>> sources;
+        /* Mixing bus where all sources are accumulated before being
+         * converted into outSamples */
+        std::vector<float> mixBus;
+
+        /* Mixing bus and samples of the audio fingerprint */
+        std::vector<float> fingerprintBus;
+        std::vector<int16_t> fingerprintSamples;
+
+        /* Running hash of the fingerprint samples */
+        uint64_t fingerprint;
 
-        /* Extra buffers and sources that have been deleted and can be recycled */
-        std::list<std::shared_ptr<AudioBuffer>> buffers_pool;
-        std::list<std::shared_ptr<AudioSource>> sources_pool;
+        /* Buffers and sources, indexed by their id. Deleted buffers and
+         * sources are recycled */
+        AudioRegistry<AudioBuffer> buffers;
+        AudioRegistry<AudioSource> sources;
 };
 
 }
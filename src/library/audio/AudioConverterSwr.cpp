@@ -28,6 +28,12 @@ extern "C" {
 }
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <map>
+#include <mutex>
+
+/* Maximum number of unused resampling contexts kept in the cache */
+#define SWR_CACHE_MAX 64
 
 namespace libtas {
 
@@ -46,8 +52,74 @@ DEFINE_ORIG_POINTER(swr_alloc_set_opts)
 #endif
 DEFINE_ORIG_POINTER(swr_convert)
 
+/* Resampling contexts that are not used by any converter, by parameters */
+static std::multimap<AudioConverterSwr::Params, struct SwrContext*> swr_cache;
+static std::mutex swr_cache_mutex;
+
+bool AudioConverterSwr::Params::operator<(const Params& other) const
+{
+    if (inFormat != other.inFormat) return inFormat < other.inFormat;
+    if (inChannels != other.inChannels) return inChannels < other.inChannels;
+    if (inFreq != other.inFreq) return inFreq < other.inFreq;
+    if (outFormat != other.outFormat) return outFormat < other.outFormat;
+    if (outChannels != other.outChannels) return outChannels < other.outChannels;
+    return outFreq < other.outFreq;
+}
+
+/* Take a context with the same parameters from the cache, or nullptr */
+static struct SwrContext* acquireContext(const AudioConverterSwr::Params& params)
+{
+    std::lock_guard<std::mutex> lock(swr_cache_mutex);
+    auto it = swr_cache.find(params);
+    if (it == swr_cache.end())
+        return nullptr;
+
+    struct SwrContext* swr = it->second;
+    swr_cache.erase(it);
+    return swr;
+}
+
+/* Reset a context and give it back to the cache */
+static void releaseContext(const AudioConverterSwr::Params& params, struct SwrContext* swr)
+{
+    if (orig::swr_is_initialized(swr))
+        orig::swr_close(swr);
+
+    std::lock_guard<std::mutex> lock(swr_cache_mutex);
+    if (swr_cache.size() >= SWR_CACHE_MAX) {
+        orig::swr_free(&swr);
+        return;
+    }
+    swr_cache.insert(std::make_pair(params, swr));
+}
+
+static AVSampleFormat toAVFormat(AudioBuffer::SampleFormat format)
+{
+    switch (format) {
+        case AudioBuffer::SAMPLE_FMT_U8:
+            return AV_SAMPLE_FMT_U8;
+        case AudioBuffer::SAMPLE_FMT_S16:
+        case AudioBuffer::SAMPLE_FMT_MSADPCM:
+            return AV_SAMPLE_FMT_S16;
+        case AudioBuffer::SAMPLE_FMT_S32:
+            return AV_SAMPLE_FMT_S32;
+        case AudioBuffer::SAMPLE_FMT_FLT:
+            return AV_SAMPLE_FMT_FLT;
+        case AudioBuffer::SAMPLE_FMT_DBL:
+            return AV_SAMPLE_FMT_DBL;
+        default:
+            debuglogstdio(LCF_SOUND | LCF_ERROR, "Unknown sample format");
+            return AV_SAMPLE_FMT_U8;
+    }
+}
+
 AudioConverterSwr::AudioConverterSwr(void)
 {
+    swr = nullptr;
+    passthrough = false;
+    passthroughAlign = 1;
+    passthroughPos = 0;
+
     /* Some systems don't create the unversionned symlinks when the libraries
      * are installed, so we add a link with the major version. */
 
@@ -62,13 +134,12 @@ AudioConverterSwr::AudioConverterSwr(void)
     /* Still test if it succeeded. */
     if (!orig::swr_alloc) {
         debuglogstdio(LCF_SOUND | LCF_ERROR, "Could not link to swr_alloc, disable audio mixing");
-        swr = nullptr;
     }
     else {
         /* We link to swr_free here, because linking during destructor can softlock */
         LINK_NAMESPACE(swr_free, "swresample");
-
-        swr = orig::swr_alloc();        
+        LINK_NAMESPACE(swr_is_initialized, "swresample");
+        LINK_NAMESPACE(swr_close, "swresample");
     }
 }
 
@@ -80,23 +151,45 @@ AudioConverterSwr::~AudioConverterSwr(void)
 
 bool AudioConverterSwr::isAvailable()
 {
-    return swr;
+    return orig::swr_alloc != nullptr;
 }
 
 bool AudioConverterSwr::isInited()
 {
+    if (passthrough)
+        return true;
+
     if (!swr)
         return false;
 
-    LINK_NAMESPACE(swr_is_initialized, "swresample");
     return orig::swr_is_initialized(swr);
 }
 
 void AudioConverterSwr::init(AudioBuffer::SampleFormat inFormat, int inChannels, int inFreq, AudioBuffer::SampleFormat outFormat, int outChannels, int outFreq)
 {
-    if (!swr)
+    if (!isAvailable())
         return;
-        
+
+    /* Give back the previous context if any */
+    dirty();
+
+    params.inFormat = inFormat;
+    params.inChannels = inChannels;
+    params.inFreq = inFreq;
+    params.outFormat = outFormat;
+    params.outChannels = outChannels;
+    params.outFreq = outFreq;
+
+    /* Copy samples directly if there is nothing to convert. MS-ADPCM
+     * buffers are already decoded into signed 16-bit samples. */
+    AudioBuffer::SampleFormat inDecodedFormat = (inFormat == AudioBuffer::SAMPLE_FMT_MSADPCM) ? AudioBuffer::SAMPLE_FMT_S16 : inFormat;
+    if ((inDecodedFormat == outFormat) && (inChannels == outChannels) && (inFreq == outFreq) &&
+        ((outFormat == AudioBuffer::SAMPLE_FMT_U8) || (outFormat == AudioBuffer::SAMPLE_FMT_S16))) {
+        passthrough = true;
+        passthroughAlign = outChannels * ((outFormat == AudioBuffer::SAMPLE_FMT_U8) ? 1 : 2);
+        return;
+    }
+
     LINK_NAMESPACE(swr_init, "swresample");
     LINK_NAMESPACE(swr_convert, "swresample");
 #if LIBSWRESAMPLE_VERSION_INT >= AV_VERSION_INT(4,7,100)
@@ -105,92 +198,61 @@ void AudioConverterSwr::init(AudioBuffer::SampleFormat inFormat, int inChannels,
     LINK_NAMESPACE(swr_alloc_set_opts, "swresample");
 #endif
 
-    AVSampleFormat inAVFormat = AV_SAMPLE_FMT_U8;
-    switch (inFormat) {
-        case AudioBuffer::SAMPLE_FMT_U8:
-            inAVFormat = AV_SAMPLE_FMT_U8;
-            break;
-        case AudioBuffer::SAMPLE_FMT_S16:
-        case AudioBuffer::SAMPLE_FMT_MSADPCM:
-            inAVFormat = AV_SAMPLE_FMT_S16;
-            break;
-        case AudioBuffer::SAMPLE_FMT_S32:
-            inAVFormat = AV_SAMPLE_FMT_S32;
-            break;
-        case AudioBuffer::SAMPLE_FMT_FLT:
-            inAVFormat = AV_SAMPLE_FMT_FLT;
-            break;
-        case AudioBuffer::SAMPLE_FMT_DBL:
-            inAVFormat = AV_SAMPLE_FMT_DBL;
-            break;
-        default:
-            debuglogstdio(LCF_SOUND | LCF_ERROR, "Unknown sample format");
-            break;
-    }
+    /* A cached context already has its options set, and keeps its
+     * resampling filter when initialized again with the same options */
+    swr = acquireContext(params);
 
-    AVSampleFormat outAVFormat = AV_SAMPLE_FMT_U8;
-    switch (outFormat) {
-        case AudioBuffer::SAMPLE_FMT_U8:
-            outAVFormat = AV_SAMPLE_FMT_U8;
-            break;
-        case AudioBuffer::SAMPLE_FMT_S16:
-        case AudioBuffer::SAMPLE_FMT_MSADPCM:
-            outAVFormat = AV_SAMPLE_FMT_S16;
-            break;
-        case AudioBuffer::SAMPLE_FMT_S32:
-            outAVFormat = AV_SAMPLE_FMT_S32;
-            break;
-        case AudioBuffer::SAMPLE_FMT_FLT:
-            outAVFormat = AV_SAMPLE_FMT_FLT;
-            break;
-        case AudioBuffer::SAMPLE_FMT_DBL:
-            outAVFormat = AV_SAMPLE_FMT_DBL;
-            break;
-        default:
-            debuglogstdio(LCF_SOUND | LCF_ERROR, "Unknown sample format");
-            break;
-    }
+    if (!swr) {
+        swr = orig::swr_alloc();
+        if (!swr) {
+            debuglogstdio(LCF_SOUND | LCF_ERROR, "Could not allocate swr context");
+            return;
+        }
+
+        AVSampleFormat inAVFormat = toAVFormat(inFormat);
+        AVSampleFormat outAVFormat = toAVFormat(outFormat);
 
 #if LIBSWRESAMPLE_VERSION_INT >= AV_VERSION_INT(4,7,100)
-    /* Get the channel layout */
-    AVChannelLayout in_ch_layout;
-    AVChannelLayout out_ch_layout;
+        /* Get the channel layout */
+        AVChannelLayout in_ch_layout;
+        AVChannelLayout out_ch_layout;
 
-    if (inChannels == 1) {
-        in_ch_layout = AV_CHANNEL_LAYOUT_MONO;
-    }
-    if (inChannels == 2) {
-        in_ch_layout = AV_CHANNEL_LAYOUT_STEREO;
-    }
-    if (outChannels == 1) {
-        out_ch_layout = AV_CHANNEL_LAYOUT_MONO;
-    }
-    if (outChannels == 2) {
-        out_ch_layout = AV_CHANNEL_LAYOUT_STEREO;
-    }
+        if (inChannels == 1) {
+            in_ch_layout = AV_CHANNEL_LAYOUT_MONO;
+        }
+        if (inChannels == 2) {
+            in_ch_layout = AV_CHANNEL_LAYOUT_STEREO;
+        }
+        if (outChannels == 1) {
+            out_ch_layout = AV_CHANNEL_LAYOUT_MONO;
+        }
+        if (outChannels == 2) {
+            out_ch_layout = AV_CHANNEL_LAYOUT_STEREO;
+        }
 
-    MYASSERT(0 == orig::swr_alloc_set_opts2(&swr, &out_ch_layout, outAVFormat, outFreq, &in_ch_layout, inAVFormat, inFreq, 0, nullptr));
+        MYASSERT(0 == orig::swr_alloc_set_opts2(&swr, &out_ch_layout, outAVFormat, outFreq, &in_ch_layout, inAVFormat, inFreq, 0, nullptr));
 #else
 
-    /* Get the channel layout */
-    int64_t in_ch_layout = 0;
-    int64_t out_ch_layout = 0;
+        /* Get the channel layout */
+        int64_t in_ch_layout = 0;
+        int64_t out_ch_layout = 0;
 
-    if (inChannels == 1) {
-        in_ch_layout = AV_CH_LAYOUT_MONO;
-    }
-    if (inChannels == 2) {
-        in_ch_layout = AV_CH_LAYOUT_STEREO;
-    }
-    if (outChannels == 1) {
-        out_ch_layout = AV_CH_LAYOUT_MONO;
-    }
-    if (outChannels == 2) {
-        out_ch_layout = AV_CH_LAYOUT_STEREO;
-    }
+        if (inChannels == 1) {
+            in_ch_layout = AV_CH_LAYOUT_MONO;
+        }
+        if (inChannels == 2) {
+            in_ch_layout = AV_CH_LAYOUT_STEREO;
+        }
+        if (outChannels == 1) {
+            out_ch_layout = AV_CH_LAYOUT_MONO;
+        }
+        if (outChannels == 2) {
+            out_ch_layout = AV_CH_LAYOUT_STEREO;
+        }
 
-    MYASSERT(nullptr != orig::swr_alloc_set_opts(swr, out_ch_layout, outAVFormat, outFreq, in_ch_layout, inAVFormat, inFreq, 0, nullptr));
+        MYASSERT(nullptr != orig::swr_alloc_set_opts(swr, out_ch_layout, outAVFormat, outFreq, in_ch_layout, inAVFormat, inFreq, 0, nullptr));
 #endif
+    }
 
     /* Open the context */
     if (orig::swr_init(swr) < 0) {
@@ -201,11 +263,13 @@ void AudioConverterSwr::init(AudioBuffer::SampleFormat inFormat, int inChannels,
 
 void AudioConverterSwr::dirty(void)
 {
+    passthrough = false;
+    passthroughSamples.clear();
+    passthroughPos = 0;
+
     if (swr) {
-        LINK_NAMESPACE(swr_is_initialized, "swresample");
-        LINK_NAMESPACE(swr_close, "swresample");
-        if (orig::swr_is_initialized(swr))
-            orig::swr_close(swr);
+        releaseContext(params, swr);
+        swr = nullptr;
     }
 }
 
@@ -213,7 +277,12 @@ void AudioConverterSwr::queueSamples(const uint8_t* inSamples, int inNbSamples)
 {
     if (!isAvailable() || !isInited())
         return;
-    
+
+    if (passthrough) {
+        passthroughSamples.insert(passthroughSamples.end(), inSamples, inSamples + inNbSamples * passthroughAlign);
+        return;
+    }
+
     orig::swr_convert(swr, nullptr, 0, &inSamples, inNbSamples);
 }
 
@@ -221,7 +290,25 @@ int AudioConverterSwr::getSamples(uint8_t* outSamples, int outNbSamples)
 {
     if (!isAvailable() || !isInited())
         return 0;
-    
+
+    if (passthrough) {
+        int availableSamples = (passthroughSamples.size() - passthroughPos) / passthroughAlign;
+        int nbSamples = (availableSamples < outNbSamples) ? availableSamples : outNbSamples;
+        memcpy(outSamples, passthroughSamples.data() + passthroughPos, nbSamples * passthroughAlign);
+        passthroughPos += nbSamples * passthroughAlign;
+
+        /* Remove the read samples */
+        if (passthroughPos == passthroughSamples.size()) {
+            passthroughSamples.clear();
+            passthroughPos = 0;
+        }
+        else if (passthroughPos > passthroughSamples.size() / 2) {
+            passthroughSamples.erase(passthroughSamples.begin(), passthroughSamples.begin() + passthroughPos);
+            passthroughPos = 0;
+        }
+        return nbSamples;
+    }
+
     return orig::swr_convert(swr, &outSamples, outNbSamples, nullptr, 0);
 }
 
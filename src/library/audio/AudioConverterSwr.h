@@ -23,12 +23,18 @@
 #include "AudioBuffer.h"
 #include "AudioConverter.h"
 
+#include <vector>
+#include <stdint.h>
 extern "C" {
 #include <libswresample/swresample.h>
 }
 
 namespace libtas {
-/* Resampler implementation using libswresample library */
+/* Resampler implementation using libswresample library.
+ * Resampling contexts are shared between all converters through a cache
+ * keyed by the conversion parameters, and are reset instead of freed when a
+ * converter does not need them anymore. Conversions that do not change the
+ * format, the number of channels or the frequency bypass libswresample. */
 class AudioConverterSwr : public AudioConverter
 {
 public:
@@ -47,9 +53,35 @@ public:
 
     int getSamples(uint8_t* outSamples, int outNbSamples);
 
+    /* Parameters of a conversion, used as a key for the context cache */
+    struct Params {
+        AudioBuffer::SampleFormat inFormat;
+        int inChannels;
+        int inFreq;
+        AudioBuffer::SampleFormat outFormat;
+        int outChannels;
+        int outFreq;
+
+        bool operator<(const Params& other) const;
+    };
+
 private:
-    /* Context for resampling audio */
+    /* Context for resampling audio, taken from the cache */
     struct SwrContext *swr;
+
+    /* Parameters of the current context */
+    Params params;
+
+    /* Is the converter copying samples without libswresample */
+    bool passthrough;
+
+    /* Size of a sample when copying samples */
+    int passthroughAlign;
+
+    /* Queued samples when copying samples, and position of the first
+     * sample that was not read */
+    std::vector<uint8_t> passthroughSamples;
+    size_t passthroughPos;
 };
 }
 
@@ -0,0 +1,154 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AudioMixer.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace libtas {
+
+/* Gain applied to a channel */
+static inline float channelGain(int channel, float lgain, float rgain)
+{
+    return (channel & 1) ? rgain : lgain;
+}
+
+void AudioMixer::accumulate(float* bus, const uint8_t* samples, int nbSamples, int nbChannels, int bitDepth, float lgain, float rgain)
+{
+    if (nbChannels == 1)
+        rgain = lgain;
+
+    int nbValues = nbSamples * nbChannels;
+    int i = 0;
+
+    /* U8 samples are scaled to the signed 16-bit range of the bus */
+    float scale = (bitDepth == 8) ? 256.0f : 1.0f;
+
+#ifdef __SSE2__
+    /* Gains of four consecutive values, which only repeat every four values
+     * for mono, stereo and quad layouts. */
+    if ((4 % nbChannels) == 0) {
+        __m128 gains = _mm_setr_ps(channelGain(0, lgain, rgain) * scale,
+                                   channelGain(1, lgain, rgain) * scale,
+                                   channelGain(2, lgain, rgain) * scale,
+                                   channelGain(3, lgain, rgain) * scale);
+
+        if (bitDepth == 16) {
+            const int16_t* samples16 = reinterpret_cast<const int16_t*>(samples);
+            for (; i + 8 <= nbValues; i += 8) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples16 + i));
+                /* Sign-extend to 32-bit */
+                __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+                __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+                __m128 flo = _mm_mul_ps(_mm_cvtepi32_ps(lo), gains);
+                __m128 fhi = _mm_mul_ps(_mm_cvtepi32_ps(hi), gains);
+                _mm_storeu_ps(bus + i, _mm_add_ps(_mm_loadu_ps(bus + i), flo));
+                _mm_storeu_ps(bus + i + 4, _mm_add_ps(_mm_loadu_ps(bus + i + 4), fhi));
+            }
+        }
+        else {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i center = _mm_set1_epi16(128);
+            for (; i + 8 <= nbValues; i += 8) {
+                __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(samples + i));
+                /* Zero-extend to 16-bit and center around 0 */
+                v = _mm_sub_epi16(_mm_unpacklo_epi8(v, zero), center);
+                __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+                __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+                __m128 flo = _mm_mul_ps(_mm_cvtepi32_ps(lo), gains);
+                __m128 fhi = _mm_mul_ps(_mm_cvtepi32_ps(hi), gains);
+                _mm_storeu_ps(bus + i, _mm_add_ps(_mm_loadu_ps(bus + i), flo));
+                _mm_storeu_ps(bus + i + 4, _mm_add_ps(_mm_loadu_ps(bus + i + 4), fhi));
+            }
+        }
+    }
+#endif
+
+    /* Remaining values, or all of them without SIMD support */
+    if (bitDepth == 16) {
+        const int16_t* samples16 = reinterpret_cast<const int16_t*>(samples);
+        for (; i < nbValues; i++)
+            bus[i] += static_cast<float>(samples16[i]) * channelGain(i % nbChannels, lgain, rgain);
+    }
+    else {
+        for (; i < nbValues; i++)
+            bus[i] += static_cast<float>(static_cast<int>(samples[i]) - 128) * channelGain(i % nbChannels, lgain, rgain) * scale;
+    }
+}
+
+int AudioMixer::store(const float* bus, uint8_t* samples, int nbSamples, int nbChannels, int bitDepth)
+{
+    int nbValues = nbSamples * nbChannels;
+    int nbSaturate = 0;
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128 vmin = _mm_set1_ps(static_cast<float>(INT16_MIN));
+    const __m128 vmax = _mm_set1_ps(static_cast<float>(INT16_MAX));
+
+    for (; i + 8 <= nbValues; i += 8) {
+        __m128 lo = _mm_loadu_ps(bus + i);
+        __m128 hi = _mm_loadu_ps(bus + i + 4);
+
+        /* Count and clamp values out of range */
+        int mask = _mm_movemask_ps(_mm_or_ps(_mm_cmplt_ps(lo, vmin), _mm_cmpgt_ps(lo, vmax))) |
+            (_mm_movemask_ps(_mm_or_ps(_mm_cmplt_ps(hi, vmin), _mm_cmpgt_ps(hi, vmax))) << 4);
+        nbSaturate += __builtin_popcount(mask);
+
+        __m128i ilo = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(lo, vmin), vmax));
+        __m128i ihi = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(hi, vmin), vmax));
+
+        if (bitDepth == 16) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + 2*i), _mm_packs_epi32(ilo, ihi));
+        }
+        else {
+            const __m128i center = _mm_set1_epi32(128);
+            ilo = _mm_add_epi32(_mm_srai_epi32(ilo, 8), center);
+            ihi = _mm_add_epi32(_mm_srai_epi32(ihi, 8), center);
+            __m128i v = _mm_packs_epi32(ilo, ihi);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(samples + i), _mm_packus_epi16(v, v));
+        }
+    }
+#endif
+
+    /* Remaining values, or all of them without SIMD support */
+    for (; i < nbValues; i++) {
+        float v = bus[i];
+        if (v < static_cast<float>(INT16_MIN)) {
+            v = static_cast<float>(INT16_MIN);
+            nbSaturate++;
+        }
+        else if (v > static_cast<float>(INT16_MAX)) {
+            v = static_cast<float>(INT16_MAX);
+            nbSaturate++;
+        }
+
+        int iv = static_cast<int>(v);
+        if (bitDepth == 16)
+            reinterpret_cast<int16_t*>(samples)[i] = static_cast<int16_t>(iv);
+        else
+            samples[i] = static_cast<uint8_t>((iv >> 8) + 128);
+    }
+
+    return nbSaturate;
+}
+
+}
@@ -0,0 +1,46 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_AUDIOMIXER_H_INCL
+#define LIBTAS_AUDIOMIXER_H_INCL
+
+#include <stdint.h>
+
+namespace libtas {
+
+/* Functions to mix audio sources into a mixing bus of float samples in the
+ * signed 16-bit range. All sources are accumulated into the bus, which is
+ * clamped and converted to the output format only once at the end.
+ */
+namespace AudioMixer
+{
+    /* Add nbSamples samples of nbChannels channels in U8 or S16 format
+     * (depending on bitDepth) to the bus, with a gain for the left channel
+     * and a gain for the right channel. For mono samples, only lgain is
+     * used. */
+    void accumulate(float* bus, const uint8_t* samples, int nbSamples, int nbChannels, int bitDepth, float lgain, float rgain);
+
+    /* Convert the bus to U8 or S16 samples. Returns the number of values
+     * that were clamped. */
+    int store(const float* bus, uint8_t* samples, int nbSamples, int nbChannels, int bitDepth);
+}
+
+}
+
+#endif
@@ -0,0 +1,175 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_AUDIOREGISTRY_H_INCL
+#define LIBTAS_AUDIOREGISTRY_H_INCL
+
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+namespace libtas {
+/* Registry of audio objects (buffers or sources), stored in contiguous slots
+ * and referenced by integer handles. A handle contains the slot index in its
+ * lower bits (plus one, because 0 is reserved for no object) and the slot
+ * generation in the remaining upper bits, so that the handle of a deleted
+ * object does not match the object that reuses its slot.
+ *
+ * Handles fit in 15 bits, because ALSA pcm handles are stored in the `short`
+ * revents field of a pollfd (see snd_pcm_poll_descriptors()).
+ *
+ * Deleted objects are kept in their slot to be recycled by the next created
+ * object, instead of being freed.
+ */
+template <class T>
+class AudioRegistry
+{
+    public:
+        AudioRegistry(int max) : maxObjects(max), nbObjects(0)
+        {
+            /* Use the remaining handle bits for the generation */
+            indexBits = 1;
+            while ((1 << indexBits) <= max)
+                indexBits++;
+            generationMask = (1 << (HANDLE_BITS - indexBits)) - 1;
+
+            /* Slots are never reallocated, so that they can be iterated
+             * while the registry is modified */
+            slots.reserve(max);
+        }
+
+        /* Create a new object or recycle a deleted one. Returns the handle
+         * of the object or -1 if the registry is full. `recycled` is set if
+         * the object was recycled. */
+        int create(bool& recycled)
+        {
+            if (nbObjects >= maxObjects)
+                return -1;
+
+            int index;
+            if (!free_slots.empty()) {
+                index = free_slots.back();
+                free_slots.pop_back();
+                slots[index].generation = (slots[index].generation + 1) & generationMask;
+                recycled = true;
+            }
+            else {
+                index = slots.size();
+                slots.emplace_back();
+                slots[index].object = std::make_shared<T>();
+                slots[index].generation = 0;
+                recycled = false;
+            }
+
+            slots[index].alive = true;
+            nbObjects++;
+            return handle(index);
+        }
+
+        /* Delete the object of a handle, keeping it for recycling */
+        void remove(int handle)
+        {
+            int index = slotIndex(handle);
+            if (index < 0)
+                return;
+
+            slots[index].alive = false;
+            free_slots.push_back(index);
+            nbObjects--;
+        }
+
+        /* Return a non-owning pointer to the object of a handle, or nullptr
+         * if the handle is not valid */
+        T* find(int handle) const
+        {
+            int index = slotIndex(handle);
+            return (index < 0) ? nullptr : slots[index].object.get();
+        }
+
+        /* Return the object of a handle, or nullptr if the handle is not
+         * valid */
+        std::shared_ptr<T> get(int handle) const
+        {
+            int index = slotIndex(handle);
+            return (index < 0) ? nullptr : slots[index].object;
+        }
+
+        /* Number of slots, used to iterate over all objects with `at()` */
+        int slotCount() const
+        {
+            return slots.size();
+        }
+
+        /* Return the object in a slot, or nullptr if the slot is free */
+        T* at(int index) const
+        {
+            return slots[index].alive ? slots[index].object.get() : nullptr;
+        }
+
+        /* Return all existing objects */
+        std::vector<std::shared_ptr<T>> list() const
+        {
+            std::vector<std::shared_ptr<T>> objects;
+            for (const auto& slot : slots)
+                if (slot.alive)
+                    objects.push_back(slot.object);
+            return objects;
+        }
+
+    private:
+        static const int HANDLE_BITS = 15;
+
+        struct Slot {
+            std::shared_ptr<T> object;
+            uint16_t generation;
+            bool alive;
+        };
+
+        int handle(int index) const
+        {
+            return (static_cast<int>(slots[index].generation) << indexBits) | (index + 1);
+        }
+
+        /* Return the slot index of a valid handle, or -1 */
+        int slotIndex(int handle) const
+        {
+            if (handle <= 0)
+                return -1;
+
+            int index = (handle & ((1 << indexBits) - 1)) - 1;
+            if ((index < 0) || (index >= static_cast<int>(slots.size())))
+                return -1;
+
+            const Slot& slot = slots[index];
+            if (!slot.alive || (slot.generation != (handle >> indexBits)))
+                return -1;
+
+            return index;
+        }
+
+        std::vector<Slot> slots;
+        std::vector<int> free_slots;
+        int maxObjects;
+        int nbObjects;
+        int indexBits;
+        int generationMask;
+};
+}
+
+#endif
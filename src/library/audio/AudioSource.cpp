@@ -20,6 +20,8 @@
 #include "AudioSource.h"
 #include "AudioConverter.h"
 #include "AudioBuffer.h"
+#include "AudioContext.h"
+#include "AudioMixer.h"
 #ifdef __unix__
 #include "AudioConverterSwr.h"
 #elif defined(__APPLE__) && defined(__MACH__)
@@ -52,8 +54,10 @@ AudioSource::AudioSource(void)
 {
 #ifdef __unix__
     audioConverter = std::unique_ptr<AudioConverter>(new AudioConverterSwr());
+    fingerprintConverter = std::unique_ptr<AudioConverter>(new AudioConverterSwr());
 #elif defined(__APPLE__) && defined(__MACH__)
     audioConverter = std::unique_ptr<AudioConverter>(new AudioConverterCoreAudio());
+    fingerprintConverter = std::unique_ptr<AudioConverter>(new AudioConverterCoreAudio());
 #endif
 
     init();
@@ -62,6 +66,7 @@ AudioSource::AudioSource(void)
 void AudioSource::init(void)
 {
     volume = 1.0f;
+    pan = 0.0f;
     pitch = 1.0f;
     looping = false;
     source = SOURCE_UNDETERMINED;
@@ -83,6 +88,7 @@ void AudioSource::rewind(void)
 void AudioSource::dirty(void)
 {
     audioConverter->dirty();
+    fingerprintConverter->dirty();
 }
 
 int AudioSource::nbQueue()
@@ -153,6 +159,33 @@ void AudioSource::setPosition(int pos)
     samples_frac = 0;
 }
 
+std::shared_ptr<AudioBuffer> AudioSource::recycleBuffer()
+{
+    if (buffer_queue.empty())
+        return nullptr;
+
+    if (queue_index > 0) {
+        std::shared_ptr<AudioBuffer> ab = buffer_queue.front();
+        buffer_queue.pop_front();
+        queue_index--;
+        return ab;
+    }
+
+    AudioContext& audiocontext = AudioContext::get();
+    std::shared_ptr<AudioBuffer> ab = audiocontext.getBuffer(audiocontext.createBuffer());
+    if (!ab)
+        return nullptr;
+
+    auto ref = buffer_queue.front();
+    ab->format = ref->format;
+    ab->nbChannels = ref->nbChannels;
+    ab->frequency = ref->frequency;
+
+    /* Streamed buffers usually have the same size */
+    ab->samples.reserve(ref->samples.size());
+    return ab;
+}
+
 bool AudioSource::willEnd(struct timespec ticks)
 {
     if (state != SOURCE_PLAYING)
@@ -175,7 +208,8 @@ bool AudioSource::willEnd(struct timespec ticks)
 }
 
 
-int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outBytes, int outBitDepth, int outNbChannels, int outFrequency, float outVolume)
+int AudioSource::mixWith( struct timespec ticks, float* mixBus, int outNbSamples, int outBitDepth, int outNbChannels, int outFrequency, float outVolume,
+                          float* fingerprintBus, int fingerprintNbSamples, int fingerprintFrequency)
 {
     if (state != SOURCE_PLAYING)
         return -1;
@@ -215,16 +249,31 @@ int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outByt
         }
     }
 
+    /* The fingerprint does not depend on the output parameters, so that it
+     * matches between runs that mix audio and runs that don't */
+    bool fingerprint = (fingerprintBus != nullptr) && fingerprintConverter->isAvailable();
+    if (fingerprint && !fingerprintConverter->isInited()) {
+        fingerprintConverter->init(curBuf->format, curBuf->nbChannels, static_cast<int>(curBuf->frequency*pitch), AudioBuffer::SAMPLE_FMT_S16, 1, fingerprintFrequency);
+    }
+
+    /* Send samples to the converters in use */
+    auto queueSamples = [&](const uint8_t* samples, int nbSamples) {
+        if (!skipMixing)
+            audioConverter->queueSamples(samples, nbSamples);
+        if (fingerprint)
+            fingerprintConverter->queueSamples(samples, nbSamples);
+    };
+
     /* Mixing source volume and master volume.
      * Taken from openAL doc:
      * "The implementation is free to clamp the total gain (effective gain
      * per-source multiplied by the listener gain) to one to prevent overflow."
      *
-     * TODO: This is where we can support panning.
+     * Panning attenuates the opposite channel.
      */
     float resultVolume = (volume * outVolume) > 1.0?1.0:(volume*outVolume);
-    int lvas = (int)(resultVolume * 65536.0f);
-    int rvas = (int)(resultVolume * 65536.0f);
+    float lgain = resultVolume * ((pan > 0.0f) ? (1.0f - pan) : 1.0f);
+    float rgain = resultVolume * ((pan < 0.0f) ? (1.0f + pan) : 1.0f);
 
     /* Number of samples to advance in the buffer. */
     int inNbSamples = ticksToSamples(ticks, static_cast<int>(curBuf->frequency*pitch));
@@ -240,17 +289,13 @@ int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outByt
 
         position = newPosition;
         debuglogstdio(LCF_SOUND, "  Buffer %d in read in range %d - %d", curBuf->id, oldPosition, position);
-        if (!skipMixing) {
-            audioConverter->queueSamples(begSamples, inNbSamples);
-        }
+        queueSamples(begSamples, inNbSamples);
     }
     else {
         /* We reached the end of the buffer */
         debuglogstdio(LCF_SOUND, "  Buffer %d is read from %d to its end %d", curBuf->id, oldPosition, curBuf->sampleSize);
-        if (!skipMixing) {
-            if (availableSamples > 0)
-                audioConverter->queueSamples(begSamples, availableSamples);
-        }
+        if (availableSamples > 0)
+            queueSamples(begSamples, availableSamples);
 
         int remainingSamples = inNbSamples - availableSamples;
         if (source == SOURCE_CALLBACK) {
@@ -268,9 +313,7 @@ int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outByt
                 callback(*curBuf);
                 detTimer.fakeAdvanceTimer({0, 0});
                 availableSamples = curBuf->getSamples(begSamples, remainingSamples, 0, false);
-                if (!skipMixing) {
-                    audioConverter->queueSamples(begSamples, availableSamples);
-                }
+                queueSamples(begSamples, availableSamples);
 
                 debuglogstdio(LCF_SOUND, "  Buffer %d is read again from 0 to %d", curBuf->id, availableSamples);
                 if (remainingSamples == availableSamples)
@@ -290,9 +333,7 @@ int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outByt
                     availableSamples = loopbuf->getSamples(begSamples, remainingSamples, loopbuf->loop_point_beg, (source == SOURCE_STATIC) && looping);
                     debuglogstdio(LCF_SOUND, "  Buffer %d in read in range %d - %d", loopbuf->id, loopbuf->loop_point_beg, availableSamples);
 
-                    if (!skipMixing) {
-                        audioConverter->queueSamples(begSamples, availableSamples);
-                    }
+                    queueSamples(begSamples, availableSamples);
 
                     finalIndex = i;
                     finalPos = loopbuf->loop_point_beg + availableSamples;
@@ -305,9 +346,7 @@ int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outByt
                     availableSamples = loopbuf->getSamples(begSamples, remainingSamples, 0, false);
                     debuglogstdio(LCF_SOUND, "  Buffer %d in read in range 0 - %d", loopbuf->id, availableSamples);
 
-                    if (!skipMixing) {
-                        audioConverter->queueSamples(begSamples, availableSamples);
-                    }
+                    queueSamples(begSamples, availableSamples);
 
                     finalIndex = i;
                     finalPos = availableSamples;
@@ -334,9 +373,7 @@ int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outByt
                             availableSamples = loopbuf->getSamples(begSamples, remainingSamples, 0, false);
                             debuglogstdio(LCF_SOUND, "  Buffer %d in read in range 0 - %d", loopbuf->id, availableSamples);
 
-                            if (!skipMixing) {
-                                audioConverter->queueSamples(begSamples, availableSamples);
-                            }
+                            queueSamples(begSamples, availableSamples);
 
                             finalIndex = i;
                             finalPos = availableSamples;
@@ -369,58 +406,21 @@ int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outByt
     int convOutSamples = 0;
 
     if (!skipMixing) {
-        /* Allocate the mixed audio array */
-        int outNbSamples = outBytes / (outNbChannels * outBitDepth / 8);
-        mixedSamples.resize(outBytes);
+        /* Allocate the converted audio array */
+        mixedSamples.resize(outNbSamples * outNbChannels * outBitDepth / 8);
 
         /* Get the converter samples */
         convOutSamples = audioConverter->getSamples(mixedSamples.data(), outNbSamples);
 
-        #define clamptofullsignedrange(x,lo,hi) ((static_cast<unsigned int>((x)-(lo))<=static_cast<unsigned int>((hi)-(lo)))?(x):(((x)<0)?(lo):(hi)))
-
-        int nbSaturate = 0;
-
-        /* Add mixed source to the output buffer */
-        if (outBitDepth == 8) {
-            for (int s=0; s<convOutSamples*outNbChannels; s+=outNbChannels) {
-                int myL = mixedSamples[s];
-                int otherL = outSamples[s];
-                int sumL = otherL + ((myL * lvas) >> 16) - 256;
-                outSamples[s] = clamptofullsignedrange(sumL, 0, UINT8_MAX);
-                nbSaturate += (sumL < 0) || (sumL > UINT8_MAX);
-
-                if (outNbChannels == 2) {
-                    int myR = mixedSamples[s+1];
-                    int otherR = outSamples[s+1];
-                    int sumR = otherR + ((myR * rvas) >> 16) - 256;
-                    outSamples[s+1] = clamptofullsignedrange(sumR, 0, UINT8_MAX);
-                    nbSaturate += (sumR < 0) || (sumR > UINT8_MAX);
-                }
-            }
-        }
+        /* Add converted samples to the mixing bus */
+        AudioMixer::accumulate(mixBus, mixedSamples.data(), convOutSamples, outNbChannels, outBitDepth, lgain, rgain);
+    }
 
-        if (outBitDepth == 16) {
-            int16_t* mixedSamples16 = reinterpret_cast<int16_t*>(mixedSamples.data());
-            int16_t* outSamples16 = reinterpret_cast<int16_t*>(outSamples);
-            for (int s=0; s<convOutSamples*outNbChannels; s+=outNbChannels) {
-                int myL = mixedSamples16[s];
-                int otherL = outSamples16[s];
-                int sumL = otherL + ((myL * lvas) >> 16);
-                outSamples16[s] = clamptofullsignedrange(sumL, INT16_MIN, INT16_MAX);
-                nbSaturate += (sumL < INT16_MIN) || (sumL > INT16_MAX);
-
-                if (outNbChannels == 2) {
-                    int myR = mixedSamples16[s+1];
-                    int otherR = outSamples16[s+1];
-                    int sumR = otherR + ((myR * rvas) >> 16);
-                    outSamples16[s+1] = clamptofullsignedrange(sumR, INT16_MIN, INT16_MAX);
-                    nbSaturate += (sumR < INT16_MIN) || (sumR > INT16_MAX);
-                }
-            }
-        }
-        
-        if (nbSaturate > 0)
-            debuglogstdio(LCF_SOUND | LCF_WARNING, "Saturation during mixing for %d samples", nbSaturate);        
+    if (fingerprint) {
+        /* Panning is ignored as the fingerprint is mono */
+        fingerprintSamples.resize(fingerprintNbSamples);
+        int fingerprintOutSamples = fingerprintConverter->getSamples(reinterpret_cast<uint8_t*>(fingerprintSamples.data()), fingerprintNbSamples);
+        AudioMixer::accumulate(fingerprintBus, reinterpret_cast<uint8_t*>(fingerprintSamples.data()), fingerprintOutSamples, 1, 16, resultVolume, resultVolume);
     }
 
     /* Reset the audio converter if the source has stopped */
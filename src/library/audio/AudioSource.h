@@ -21,6 +21,7 @@
 #define LIBTAS_AUDIOSOURCE_H_INCL
 
 #include <vector>
+#include <deque>
 #include <memory>
 #include <functional>
 #include "AudioConverter.h"
@@ -54,6 +55,10 @@ class AudioSource
          * Can be larger than 1 but output volume will be clamped to one */
         float volume;
 
+        /* Balance between left and right channels, from -1 (left only)
+         * to 1 (right only) */
+        float pan;
+
         /* Is it a static source (we got the entire buffer at once)
          * or a streaming source (we continuously get buffers)
          */
@@ -102,8 +107,9 @@ class AudioSource
         };
         SourceState state;
 
-        /* A queue of buffers to play */
-        std::vector<std::shared_ptr<AudioBuffer>> buffer_queue;
+        /* A queue of buffers to play. Buffers that were entirely played are
+         * removed from the front */
+        std::deque<std::shared_ptr<AudioBuffer>> buffer_queue;
 
         /* Indicate the current position in the buffer queue */
         int queue_index;
@@ -111,9 +117,15 @@ class AudioSource
         /* Object for resampling audio */
         std::unique_ptr<AudioConverter> audioConverter;
 
+        /* Object for resampling audio into the fingerprint format */
+        std::unique_ptr<AudioConverter> fingerprintConverter;
+
         /* Temporary array of mixed samples */
         std::vector<uint8_t> mixedSamples;
 
+        /* Temporary array of fingerprint samples */
+        std::vector<int16_t> fingerprintSamples;
+
         /* In case of callback type, callback function.
          * We send as an argument a pointer to the buffer to refill.
          */
@@ -162,14 +174,27 @@ class AudioSource
          */
         void setPosition(int pos);
 
+        /* Get a buffer to push streamed samples into. The oldest buffer that
+         * was entirely played is removed from the queue and reused, so that
+         * streaming does not allocate new buffers. Otherwise, a new buffer is
+         * created with the parameters of the queued buffers.
+         * Returns nullptr if there is no queued buffer to get parameters from.
+         * Must be called with the audio mutex locked.
+         */
+        std::shared_ptr<AudioBuffer> recycleBuffer();
+
         /* Check if reading a number of ticks will reach the end of the source */
         bool willEnd(struct timespec ticks);
 
-        /* Mix the buffer with an external buffer of the given format.
-         * The number of samples to mix correspond to the number of ticks given.
-         * The function returns the number of samples written in the output buffer.
+        /* Mix the buffer into a mixing bus, after converting it to the given
+         * format. The number of samples to mix correspond to the number of
+         * ticks given.
+         * If fingerprintBus is not null, the buffer is also mixed into it
+         * as mono samples at fingerprintFrequency.
+         * The function returns the number of samples added to the mixing bus.
          */
-        int mixWith( struct timespec ticks, uint8_t* outSamples, int outBytes, int outBitDepth, int outNbChannels, int outFrequency, float outVolume);
+        int mixWith( struct timespec ticks, float* mixBus, int outNbSamples, int outBitDepth, int outNbChannels, int outFrequency, float outVolume,
+                     float* fingerprintBus, int fingerprintNbSamples, int fingerprintFrequency);
 };
 }
 
@@ -18,12 +18,32 @@
  */
 
 #include "DecoderMSADPCM.h"
-#include "BinaryIStream.h"
 
 #include "logging.h"
+#include <algorithm>
+#include <cstddef>
 
 namespace libtas {
 
+static const int adaptionTable[] = {
+    230, 230, 230, 230, 307, 409, 512, 614,
+    768, 614, 512, 409, 307, 230, 230, 230
+};
+
+static const int adaptCoeff_1[] = {
+    256, 512, 0, 192, 240, 460, 392
+};
+static const int adaptCoeff_2[] = {
+    0, -256, 0, 64, 0, -208, -232
+};
+
+static const uint8_t maxPredictor = sizeof(adaptCoeff_1) / sizeof(adaptCoeff_1[0]) - 1;
+
+static inline int16_t readInt16(const uint8_t* data)
+{
+    return static_cast<int16_t>(data[0] | (data[1] << 8));
+}
+
 int16_t DecoderMSADPCM::calculateSample(uint8_t nibble, uint8_t predictor, int16_t& sample1, int16_t& sample2, int16_t& delta)
 {
     /*
@@ -35,18 +55,6 @@ int16_t DecoderMSADPCM::calculateSample(uint8_t nibble, uint8_t predictor, int16
         signedNibble -= 0x10;
     }
 
-    static const int adaptionTable[] = {
-        230, 230, 230, 230, 307, 409, 512, 614,
-        768, 614, 512, 409, 307, 230, 230, 230
-    };
-
-    static const int adaptCoeff_1[] = {
-        256, 512, 0, 192, 240, 460, 392
-    };
-    static const int adaptCoeff_2[] = {
-        0, -256, 0, 64, 0, -208, -232
-    };
-
     /* Calculate new sample */
     int sampleInt = (
             (	(sample1 * adaptCoeff_1[predictor]) +
@@ -77,68 +85,78 @@ int16_t DecoderMSADPCM::calculateSample(uint8_t nibble, uint8_t predictor, int16
     return sample;
 }
 
-void DecoderMSADPCM::toPCM(BinaryIStream &source, int nbChannels, int sampleAlign, std::vector<int16_t> &pcmOut)
+int DecoderMSADPCM::toPCM(const uint8_t* source, int size, int nbChannels, int blockSamples, int16_t* pcmOut)
 {
-    /* Mono or Stereo? */
-    if (nbChannels == 1) {
-        uint8_t predictor;
+    if ((nbChannels != 1) && (nbChannels != 2)) {
+        debuglogstdio(LCF_SOUND | LCF_ERROR, "MSADPCM data is not mono or stereo");
+        return 0;
+    }
 
-        /* Read to the end of the buffer */
-        while (source >> predictor) {
+    if (blockSamples < 2) {
+        debuglogstdio(LCF_SOUND | LCF_ERROR, "MSADPCM block alignment %d is invalid", blockSamples);
+        return 0;
+    }
 
-            int16_t sample1, sample2, delta;
+    /* Size in bytes of the block preamble and of a full block */
+    const int preambleSize = 7 * nbChannels;
+    const int blockSize = nbChannels * (7 + (blockSamples - 2) / 2);
 
-            /* Read block preamble */
-            source >> delta >> sample1 >> sample2;
+    int16_t* out = pcmOut;
+    const uint8_t* end = source + size;
+
+    /* Read to the end of the buffer, ignoring a truncated preamble */
+    while ((end - source) >= preambleSize) {
+        const uint8_t* blockEnd = source + std::min<ptrdiff_t>(blockSize, end - source);
+
+        /* Mono or Stereo? */
+        if (nbChannels == 1) {
+            /* Read block preamble. An invalid predictor would read outside
+             * of the coefficient tables */
+            uint8_t predictor = std::min(source[0], maxPredictor);
+            int16_t delta = readInt16(source + 1);
+            int16_t sample1 = readInt16(source + 3);
+            int16_t sample2 = readInt16(source + 5);
+            source += preambleSize;
 
             /* Send the initial samples straight to PCM out. */
-            pcmOut.push_back(sample2);
-            pcmOut.push_back(sample1);
-
-            /* Go through the bytes in this MSADPCM block. */
-            for (int bi = 2; bi < sampleAlign; bi += 2) {
-                /* Each sample is one half of a nibbleBlock. */
-                uint8_t sampleByte;
-                source >> sampleByte;
-                if (!source) break;
-                pcmOut.push_back(calculateSample(sampleByte >>  4, predictor, sample1, sample2, delta));
-                pcmOut.push_back(calculateSample(sampleByte & 0xF, predictor, sample1, sample2, delta));
+            *out++ = sample2;
+            *out++ = sample1;
+
+            /* Go through the bytes in this MSADPCM block.
+             * Each sample is one half of a nibbleBlock. */
+            for (; source < blockEnd; source++) {
+                *out++ = calculateSample(*source >>  4, predictor, sample1, sample2, delta);
+                *out++ = calculateSample(*source & 0xF, predictor, sample1, sample2, delta);
             }
-
         }
-    } else if (nbChannels == 2) {
-        uint8_t lpredictor, rpredictor = 0;
-
-        /* Read to the end of the buffer */
-        while (source >> lpredictor) {
-            int16_t lsample1, lsample2, ldelta;
-            int16_t rsample1, rsample2, rdelta;
-
+        else {
             /* Read block preamble */
-            source >> rpredictor;
-            source >> ldelta >> rdelta;
-            source >> lsample1 >> rsample1;
-            source >> lsample2 >> rsample2;
+            uint8_t lpredictor = std::min(source[0], maxPredictor);
+            uint8_t rpredictor = std::min(source[1], maxPredictor);
+            int16_t ldelta = readInt16(source + 2);
+            int16_t rdelta = readInt16(source + 4);
+            int16_t lsample1 = readInt16(source + 6);
+            int16_t rsample1 = readInt16(source + 8);
+            int16_t lsample2 = readInt16(source + 10);
+            int16_t rsample2 = readInt16(source + 12);
+            source += preambleSize;
 
             /* Send the initial samples straight to PCM out. */
-            pcmOut.push_back(lsample2);
-            pcmOut.push_back(rsample2);
-            pcmOut.push_back(lsample1);
-            pcmOut.push_back(rsample1);
-
-            /* Go through the bytes in this MSADPCM block. */
-            for (int bi = 4; bi < (sampleAlign*2); bi += 2) {
-                uint8_t sampleByte;
-                source >> sampleByte;
-                if (!source) break;
-                /* Each sample is one half of a nibbleBlock. */
-                pcmOut.push_back(calculateSample(sampleByte >>  4, lpredictor, lsample1, lsample2, ldelta));
-                pcmOut.push_back(calculateSample(sampleByte & 0xF, rpredictor, rsample1, rsample2, rdelta));
+            *out++ = lsample2;
+            *out++ = rsample2;
+            *out++ = lsample1;
+            *out++ = rsample1;
+
+            /* Go through the bytes in this MSADPCM block.
+             * Each sample is one half of a nibbleBlock. */
+            for (; source < blockEnd; source++) {
+                *out++ = calculateSample(*source >>  4, lpredictor, lsample1, lsample2, ldelta);
+                *out++ = calculateSample(*source & 0xF, rpredictor, rsample1, rsample2, rdelta);
             }
         }
-    } else {
-        debuglogstdio(LCF_SOUND | LCF_ERROR, "MSADPCM data is not mono or stereo");
     }
+
+    return (out - pcmOut) / nbChannels;
 }
 
 }
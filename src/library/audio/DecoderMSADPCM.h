@@ -24,23 +24,24 @@
 #ifndef LIBTAS_DECODERMSADPCM_H_INCL
 #define LIBTAS_DECODERMSADPCM_H_INCL
 
-#include <vector>
 #include <cstdint>
 
 namespace libtas {
     
-class BinaryIStream;
-    
 namespace DecoderMSADPCM
 {
     /**
-     * Decodes MSADPCM data to signed 16-bit PCM data.
-     * @param source     [in]  source stream containing the compressed samples
-     * @param nbChannels [in]  number of channels
-     * @param blockAlign [in]  size (in samples!) of a single ADPCM block
-     * @param pcmOut     [out] destination buffer
+     * Decodes MSADPCM data to signed 16-bit PCM data. A trailing incomplete
+     * block is decoded as long as its preamble is complete.
+     * @param source       [in]  compressed samples
+     * @param size         [in]  size (in bytes) of the compressed samples
+     * @param nbChannels   [in]  number of channels
+     * @param blockSamples [in]  size (in samples!) of a single ADPCM block
+     * @param pcmOut       [out] destination buffer, large enough to store
+     *                           all decoded samples
+     * @return                   the number of decoded samples per channel
      */
-    void toPCM(BinaryIStream &source, int nbChannels, int sampleAlign, std::vector<int16_t> &pcmOut);
+    int toPCM(const uint8_t* source, int size, int nbChannels, int blockSamples, int16_t* pcmOut);
 
     /**
      * Calculates PCM samples based on previous samples and a nibble input.
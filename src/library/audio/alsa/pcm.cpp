@@ -82,7 +82,11 @@ int snd_pcm_open(snd_pcm_t **pcm, const char *name, snd_pcm_stream_t stream, int
 
     /* Create a source and push buffer in the source */
     int sourceId = audiocontext.createSource();
-    auto source = audiocontext.getSource(sourceId);
+    auto source = audiocontext.findSource(sourceId);
+    if (!source) {
+        audiocontext.deleteBuffer(bufferId);
+        return -ENOMEM;
+    }
 
     source->buffer_queue.push_back(buffer);
     source->source = AudioSource::SOURCE_STREAMING_CONTINUOUS;
@@ -124,7 +128,7 @@ int snd_pcm_close(snd_pcm_t *pcm)
 
     /* Delete source buffers and source */
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = audiocontext.getSource(sourceId);
+    auto source = audiocontext.findSource(sourceId);
 
     if (source) {
         for (auto& buffer : source->buffer_queue)
@@ -204,7 +208,9 @@ int snd_async_add_pcm_handler(snd_async_handler_t **handler, snd_pcm_t *pcm, snd
 
     AudioContext& audiocontext = AudioContext::get();
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = audiocontext.getSource(sourceId);
+    auto source = audiocontext.findSource(sourceId);
+    if (!source)
+        return -EBADFD;
 
     snd_async_handler_t *h = reinterpret_cast<snd_async_handler_t *>(pcm);
     *handler = h;
@@ -238,7 +244,9 @@ void *snd_async_handler_get_callback_private(snd_async_handler_t *handler)
 
     AudioContext& audiocontext = AudioContext::get();
     int sourceId = reinterpret_cast<intptr_t>(handler);
-    auto source = audiocontext.getSource(sourceId);
+    auto source = audiocontext.findSource(sourceId);
+    if (!source)
+        return nullptr;
 
     return source->callback_data;
 }
@@ -251,7 +259,9 @@ int snd_async_del_handler(snd_async_handler_t *handler)
 
     AudioContext& audiocontext = AudioContext::get();
     int sourceId = reinterpret_cast<intptr_t>(handler);
-    auto source = audiocontext.getSource(sourceId);
+    auto source = audiocontext.findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     source->callback = nullptr;
     
     return 0;
@@ -263,7 +273,9 @@ int snd_pcm_start(snd_pcm_t *pcm)
 
     DEBUGLOGCALL(LCF_SOUND);
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = AudioContext::get().getSource(sourceId);
+    auto source = AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     source->state = AudioSource::SOURCE_PLAYING;
 
     return 0;
@@ -275,7 +287,9 @@ int snd_pcm_drop(snd_pcm_t *pcm)
 
     DEBUGLOGCALL(LCF_SOUND);
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = AudioContext::get().getSource(sourceId);
+    auto source = AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     source->setPosition(source->queueSize());
     return 0;
 }
@@ -295,7 +309,9 @@ int snd_pcm_pause(snd_pcm_t *pcm, int enable)
     DEBUGLOGCALL(LCF_SOUND);
 
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = AudioContext::get().getSource(sourceId);
+    auto source = AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     if (enable)
         source->state = AudioSource::SOURCE_PAUSED;
     else
@@ -311,7 +327,9 @@ snd_pcm_state_t snd_pcm_state(snd_pcm_t *pcm)
     DEBUGLOGCALL(LCF_SOUND);
 
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source =  AudioContext::get().getSource(sourceId);
+    auto source =  AudioContext::get().findSource(sourceId);
+    if (!source)
+        return SND_PCM_STATE_DISCONNECTED;
     switch (source->state) {
         case AudioSource::SOURCE_INITIAL:
             return SND_PCM_STATE_OPEN;
@@ -336,7 +354,9 @@ int snd_pcm_resume(snd_pcm_t *pcm)
 
     DEBUGLOGCALL(LCF_SOUND);
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source =  AudioContext::get().getSource(sourceId);
+    auto source =  AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     source->state = AudioSource::SOURCE_PLAYING;
 
     return 0;
@@ -428,7 +448,9 @@ snd_pcm_sframes_t snd_pcm_rewind(snd_pcm_t *pcm, snd_pcm_uframes_t frames)
 
     DEBUGLOGCALL(LCF_SOUND);
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source =  AudioContext::get().getSource(sourceId);
+    auto source =  AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     snd_pcm_uframes_t pos = source->getPosition();
     if (frames <= pos) {
         source->setPosition(pos - frames);
@@ -445,7 +467,9 @@ int snd_pcm_recover(snd_pcm_t *pcm, int err, int silent)
 
     if (err == -EPIPE) {
         int sourceId = reinterpret_cast<intptr_t>(pcm);
-        auto source =  AudioContext::get().getSource(sourceId);
+        auto source =  AudioContext::get().findSource(sourceId);
+        if (!source)
+            return -EBADFD;
 
         if (source->state == AudioSource::SOURCE_UNDERRUN)
             source->state = AudioSource::SOURCE_PREPARED;
@@ -461,7 +485,9 @@ int snd_pcm_reset(snd_pcm_t *pcm)
     RETURN_IF_NATIVE(snd_pcm_reset, (pcm), nullptr);
 
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source =  AudioContext::get().getSource(sourceId);
+    auto source =  AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     source->setPosition(source->queueSize());
     DEBUGLOGCALL(LCF_SOUND);
     return 0;
@@ -472,7 +498,7 @@ int snd_pcm_status(snd_pcm_t *pcm, snd_pcm_status_t *status)
     RETURN_IF_NATIVE(snd_pcm_status, (pcm, status), nullptr);
 
     // int sourceId = reinterpret_cast<intptr_t>(pcm);
-    // auto source = audiocontext.getSource(sourceId);
+    // auto source = audiocontext.findSource(sourceId);
     // source->setPosition(source->queueSize());
     DEBUGLOGCALL(LCF_SOUND);
     return 0;
@@ -486,7 +512,9 @@ int snd_pcm_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
 
     /* Update internal buffer parameters */
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source =  AudioContext::get().getSource(sourceId);
+    auto source =  AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     auto buffer = source->buffer_queue[0];
     buffer->size = 0;
     buffer->update();
@@ -521,7 +549,9 @@ int snd_pcm_sw_params(snd_pcm_t *pcm, snd_pcm_sw_params_t *params)
 
     /* Update internal buffer parameters */
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source =  AudioContext::get().getSource(sourceId);
+    auto source =  AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     auto buffer = source->buffer_queue[0];
     buffer->size = 0;
     buffer->update();
@@ -538,7 +568,9 @@ int snd_pcm_prepare(snd_pcm_t *pcm)
 
     DEBUGLOGCALL(LCF_SOUND);
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source =  AudioContext::get().getSource(sourceId);
+    auto source =  AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     if ((source->state == AudioSource::SOURCE_INITIAL) ||
         (source->state == AudioSource::SOURCE_UNDERRUN) ||
         (source->state == AudioSource::SOURCE_STOPPED))
@@ -552,7 +584,9 @@ static int get_latency(snd_pcm_t *pcm)
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = audiocontext.getSource(sourceId);
+    auto source = audiocontext.findSource(sourceId);
+    if (!source)
+        return 0;
     return source->queueSize() - source->getPosition();
 }
 
@@ -566,7 +600,9 @@ snd_pcm_sframes_t snd_pcm_writei(snd_pcm_t *pcm, const void *buffer, snd_pcm_ufr
     AudioContext& audiocontext = AudioContext::get();
     audiocontext.audio_thread = ThreadManager::getThreadId();
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = audiocontext.getSource(sourceId);
+    auto source = audiocontext.findSource(sourceId);
+    if (!source)
+        return -EBADFD;
 
     if (source->state == AudioSource::SOURCE_PREPARED) {
         /* Start playback */
@@ -607,36 +643,16 @@ snd_pcm_sframes_t snd_pcm_writei(snd_pcm_t *pcm, const void *buffer, snd_pcm_ufr
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
 
     /* We try to reuse a buffer that has been processed from the source */
-    std::shared_ptr<AudioBuffer> ab;
-    if (source->nbQueueProcessed() > 0) {
-        /* Removing first buffer */
-        ab = source->buffer_queue[0];
-        source->buffer_queue.erase(source->buffer_queue.begin());
-        source->queue_index--;
-    }
-    else {
-        /* Building a new buffer */
-        int bufferId = audiocontext.createBuffer();
-        ab = audiocontext.getBuffer(bufferId);
-
-        /* Getting the parameters of the buffer from one of the queue */
-        if (source->buffer_queue.empty()) {
-            debuglogstdio(LCF_SOUND | LCF_ERROR, "Empty queue, cannot guess buffer parameters");
-            return -1;
-        }
-
-        auto ref = source->buffer_queue[0];
-        ab->format = ref->format;
-        ab->nbChannels = ref->nbChannels;
-        ab->frequency = ref->frequency;
+    std::shared_ptr<AudioBuffer> ab = source->recycleBuffer();
+    if (!ab) {
+        debuglogstdio(LCF_SOUND | LCF_ERROR, "Empty queue, cannot guess buffer parameters");
+        return -1;
     }
 
     /* Filling buffer */
     ab->update(); // Compute alignSize
+    ab->copySamples(buffer, size * ab->alignSize);
     ab->sampleSize = size;
-    ab->size = size * ab->alignSize;
-    ab->samples.clear();
-    ab->samples.insert(ab->samples.end(), static_cast<const uint8_t*>(buffer), &(static_cast<const uint8_t*>(buffer))[ab->size]);
 
     source->buffer_queue.push_back(ab);
 
@@ -680,30 +696,15 @@ int snd_pcm_mmap_begin(snd_pcm_t *pcm, const snd_pcm_channel_area_t **areas, snd
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
 
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = audiocontext.getSource(sourceId);
+    auto source = audiocontext.findSource(sourceId);
+    if (!source)
+        return -EBADFD;
 
     /* We try to reuse a buffer that has been processed from the source */
-    if (source->nbQueueProcessed() > 0) {
-        /* Removing first buffer */
-        mmap_ab = source->buffer_queue[0];
-        source->buffer_queue.erase(source->buffer_queue.begin());
-        source->queue_index--;
-    }
-    else {
-        /* Building a new buffer */
-        int bufferId = audiocontext.createBuffer();
-        mmap_ab = audiocontext.getBuffer(bufferId);
-
-        /* Getting the parameters of the buffer from one of the queue */
-        if (source->buffer_queue.empty()) {
-            debuglogstdio(LCF_SOUND | LCF_ERROR, "Empty queue, cannot guess buffer parameters");
-            return -1;
-        }
-
-        auto ref = source->buffer_queue[0];
-        mmap_ab->format = ref->format;
-        mmap_ab->nbChannels = ref->nbChannels;
-        mmap_ab->frequency = ref->frequency;
+    mmap_ab = source->recycleBuffer();
+    if (!mmap_ab) {
+        debuglogstdio(LCF_SOUND | LCF_ERROR, "Empty queue, cannot guess buffer parameters");
+        return -1;
     }
 
     /* Configuring the buffer */
@@ -733,7 +734,9 @@ snd_pcm_sframes_t snd_pcm_mmap_commit(snd_pcm_t *pcm, snd_pcm_uframes_t offset,
 
     /* Push the mmap buffer to the source */
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = AudioContext::get().getSource(sourceId);
+    auto source = AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     source->buffer_queue.push_back(mmap_ab);
 
     /* We should unlock the audio mutex here, but we don't (see above comment) */
@@ -804,7 +807,9 @@ int snd_pcm_hw_params_set_format(snd_pcm_t *pcm, snd_pcm_hw_params_t *params, sn
     debuglogstdio(LCF_SOUND, "%s call with format %d", __func__, val);
 
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = AudioContext::get().getSource(sourceId);
+    auto source = AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     auto buffer = source->buffer_queue[0];
 
     switch(val) {
@@ -843,7 +848,9 @@ int snd_pcm_hw_params_get_channels(const snd_pcm_hw_params_t *params, unsigned i
 
     /* We don't have the pcm parameter here, so using the last opened source */
     int sourceId = last_source;
-    auto source = AudioContext::get().getSource(sourceId);
+    auto source = AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     auto buffer = source->buffer_queue[0];
     *val = buffer->nbChannels;
 
@@ -877,7 +884,9 @@ int snd_pcm_hw_params_set_channels(snd_pcm_t *pcm, snd_pcm_hw_params_t *params,
     debuglogstdio(LCF_SOUND, "%s call with channels %d", __func__, val);
 
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = AudioContext::get().getSource(sourceId);
+    auto source = AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     auto buffer = source->buffer_queue[0];
     buffer->nbChannels = val;
 
@@ -891,7 +900,9 @@ int snd_pcm_hw_params_set_rate(snd_pcm_t *pcm, snd_pcm_hw_params_t *params, unsi
     debuglogstdio(LCF_SOUND, "%s call with rate %d and dir %d", __func__, val, dir);
 
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = AudioContext::get().getSource(sourceId);
+    auto source = AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     auto buffer = source->buffer_queue[0];
     buffer->frequency = val;
 
@@ -905,7 +916,9 @@ int snd_pcm_hw_params_set_rate_near(snd_pcm_t *pcm, snd_pcm_hw_params_t *params,
     debuglogstdio(LCF_SOUND, "%s call with rate %d", __func__, *val);
 
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = AudioContext::get().getSource(sourceId);
+    auto source = AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     auto buffer = source->buffer_queue[0];
     buffer->frequency = *val;
 
@@ -930,7 +943,9 @@ int snd_pcm_hw_params_get_rate(const snd_pcm_hw_params_t *params, unsigned int *
 
     /* We don't have the pcm parameter here, so using the last opened source */
     int sourceId = last_source;
-    auto source = AudioContext::get().getSource(sourceId);
+    auto source = AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     auto buffer = source->buffer_queue[0];
     if (buffer->frequency != 0) {
         *val = buffer->frequency;
@@ -988,7 +1003,9 @@ int snd_pcm_hw_params_set_period_time_near(snd_pcm_t *pcm, snd_pcm_hw_params_t *
     debuglogstdio(LCF_SOUND, "%s call with period time %d us and dir %d", __func__, *val, dir?*dir:-2);
 
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = AudioContext::get().getSource(sourceId);
+    auto source = AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     auto buffer = source->buffer_queue[0];
 
     if (buffer->frequency != 0) {
@@ -1073,7 +1090,9 @@ int snd_pcm_hw_params_get_buffer_time_max(const snd_pcm_hw_params_t *params, uns
 
     /* We don't have the pcm parameter here, so using the last opened source */
     int sourceId = last_source;
-    auto source = AudioContext::get().getSource(sourceId);
+    auto source = AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     auto buffer = source->buffer_queue[0];
 
     /* The next operation can overflow using 32-bit ints */
@@ -1101,7 +1120,9 @@ int snd_pcm_hw_params_set_buffer_time_near(snd_pcm_t *pcm, snd_pcm_hw_params_t *
     debuglogstdio(LCF_SOUND, "%s call with buffer time %d", __func__, *val);
 
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = AudioContext::get().getSource(sourceId);
+    auto source = AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     auto buffer = source->buffer_queue[0];
 
     /* Special case for 0, return the default value */
@@ -1179,7 +1200,9 @@ int snd_pcm_set_params(snd_pcm_t *pcm, snd_pcm_format_t format, snd_pcm_access_t
     DEBUGLOGCALL(LCF_SOUND);
 
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = AudioContext::get().getSource(sourceId);
+    auto source = AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     auto buffer = source->buffer_queue[0];
 
     switch(format) {
@@ -1309,7 +1332,9 @@ int snd_pcm_set_chmap(snd_pcm_t *pcm, const snd_pcm_chmap_t *map)
 
     /* Set the number of channels */
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = AudioContext::get().getSource(sourceId);
+    auto source = AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     auto buffer = source->buffer_queue[0];
     buffer->nbChannels = map->channels;
     
@@ -1352,7 +1377,9 @@ snd_pcm_sframes_t snd_pcm_bytes_to_frames(snd_pcm_t *pcm, ssize_t bytes)
 
     debuglogstdio(LCF_SOUND, "%s called with bytes %d", __func__, bytes);
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = AudioContext::get().getSource(sourceId);
+    auto source = AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     auto buffer = source->buffer_queue[0];
     return bytes / buffer->alignSize;
 }
@@ -1363,7 +1390,9 @@ ssize_t snd_pcm_frames_to_bytes(snd_pcm_t *pcm, snd_pcm_sframes_t frames)
 
     debuglogstdio(LCF_SOUND, "%s called with frames %d", __func__, frames);
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = AudioContext::get().getSource(sourceId);
+    auto source = AudioContext::get().findSource(sourceId);
+    if (!source)
+        return -EBADFD;
     auto buffer = source->buffer_queue[0];
     return buffer->alignSize * frames;
 }
@@ -121,7 +121,7 @@ int cubeb_stream_init(cubeb * context,
 
     /* Push buffers in a source */
     int sourceId = audiocontext.createSource();
-    auto source = audiocontext.getSource(sourceId);
+    auto source = audiocontext.findSource(sourceId);
     *stream = reinterpret_cast<cubeb_stream*>(sourceId);
 
     source->buffer_queue.push_back(buffer);
@@ -153,7 +153,7 @@ int cubeb_stream_start(cubeb_stream * stream)
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
     int sourceId = reinterpret_cast<intptr_t>(stream);
-    auto source = audiocontext.getSource(sourceId);
+    auto source = audiocontext.findSource(sourceId);
     
     if (!source)
         return CUBEB_ERROR;
@@ -168,7 +168,7 @@ int cubeb_stream_stop(cubeb_stream * stream)
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
     int sourceId = reinterpret_cast<intptr_t>(stream);
-    auto source = audiocontext.getSource(sourceId);
+    auto source = audiocontext.findSource(sourceId);
     
     if (!source)
         return CUBEB_ERROR;
@@ -190,7 +190,7 @@ int cubeb_stream_get_position(cubeb_stream * stream, uint64_t * position)
         AudioContext& audiocontext = AudioContext::get();
         std::lock_guard<std::mutex> lock(audiocontext.mutex);
         int sourceId = reinterpret_cast<intptr_t>(stream);
-        auto source = audiocontext.getSource(sourceId);
+        auto source = audiocontext.findSource(sourceId);
         *position = source->getPosition(); // this is probabaly not the expected value
                                          // because the callback is reusing the same buffer
         return CUBEB_OK;
@@ -205,7 +205,7 @@ int cubeb_stream_get_latency(cubeb_stream * stream, uint32_t * latency)
         AudioContext& audiocontext = AudioContext::get();
         std::lock_guard<std::mutex> lock(audiocontext.mutex);
         int sourceId = reinterpret_cast<intptr_t>(stream);
-        auto source = audiocontext.getSource(sourceId);
+        auto source = audiocontext.findSource(sourceId);
         *latency = source->queueSize() - source->getPosition();
         return CUBEB_OK;
     }
@@ -224,13 +224,29 @@ int cubeb_stream_set_volume(cubeb_stream * stream, float volume)
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
     int sourceId = reinterpret_cast<intptr_t>(stream);
-    auto source = audiocontext.getSource(sourceId);
+    auto source = audiocontext.findSource(sourceId);
     if (!source)
         return CUBEB_ERROR_INVALID_PARAMETER;
     source->volume = volume;
     return CUBEB_OK;
 }
 
+int cubeb_stream_set_panning(cubeb_stream * stream, float panning)
+{
+    DEBUGLOGCALL(LCF_SOUND);
+    if (panning < -1.0f || panning > 1.0f)
+        return CUBEB_ERROR_INVALID_PARAMETER;
+
+    AudioContext& audiocontext = AudioContext::get();
+    std::lock_guard<std::mutex> lock(audiocontext.mutex);
+    int sourceId = reinterpret_cast<intptr_t>(stream);
+    auto source = audiocontext.findSource(sourceId);
+    if (!source)
+        return CUBEB_ERROR_INVALID_PARAMETER;
+    source->pan = panning;
+    return CUBEB_OK;
+}
+
 int cubeb_stream_get_current_device(cubeb_stream * stm, cubeb_device ** const device)
 {
     DEBUGLOGCALL(LCF_SOUND | LCF_TODO);
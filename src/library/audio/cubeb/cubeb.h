@@ -60,6 +60,7 @@ OVERRIDE int cubeb_stream_get_position(cubeb_stream * stream, uint64_t * positio
 OVERRIDE int cubeb_stream_get_latency(cubeb_stream * stream, uint32_t * latency);
 OVERRIDE int cubeb_stream_get_input_latency(cubeb_stream * stream, uint32_t * latency);
 OVERRIDE int cubeb_stream_set_volume(cubeb_stream * stream, float volume);
+OVERRIDE int cubeb_stream_set_panning(cubeb_stream * stream, float panning);
 OVERRIDE int cubeb_stream_get_current_device(cubeb_stream * stm,
                                                  cubeb_device ** const device);
 OVERRIDE int cubeb_stream_device_destroy(cubeb_stream * stream, cubeb_device * devices);
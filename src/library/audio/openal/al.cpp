@@ -277,7 +277,7 @@ void alBufferData(ALuint buffer, ALenum format, const ALvoid *data, ALsizei size
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
 
-	auto ab = audiocontext.getBuffer(buffer);
+	auto ab = audiocontext.findBuffer(buffer);
     if (ab == nullptr) {
         alSetError(AL_INVALID_NAME);
         return;
@@ -381,7 +381,7 @@ void alBufferi(ALuint buffer, ALenum param, ALint value)
 
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
-    auto ab = audiocontext.getBuffer(buffer);
+    auto ab = audiocontext.findBuffer(buffer);
     if (ab == nullptr) {
         alSetError(AL_INVALID_NAME);
         return;
@@ -418,7 +418,7 @@ void alBufferiv(ALuint buffer, ALenum param, const ALint *values)
         return;
     }
 
-    auto ab = AudioContext::get().getBuffer(buffer);
+    auto ab = AudioContext::get().findBuffer(buffer);
     if (ab == nullptr) {
         alSetError(AL_INVALID_NAME);
         return;
@@ -453,7 +453,7 @@ void alGetBufferi(ALuint buffer, ALenum pname, ALint *value)
 
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
-	auto ab = audiocontext.getBuffer(buffer);
+	auto ab = audiocontext.findBuffer(buffer);
     if (ab == nullptr) {
         alSetError(AL_INVALID_NAME);
         return;
@@ -497,7 +497,7 @@ void alGetBufferiv(ALuint buffer, ALenum pname, ALint *values)
 
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
-    auto ab = audiocontext.getBuffer(buffer);
+    auto ab = audiocontext.findBuffer(buffer);
     if (ab == nullptr) {
         alSetError(AL_INVALID_NAME);
         return;
@@ -568,7 +568,7 @@ void alDeleteSources(ALsizei n, ALuint *sources)
     }
 	for (int i=0; i<n; i++) {
         /* If the source is deleted when playing, the source must be stopped first */
-        auto as = audiocontext.getSource(sources[i]);
+        auto as = audiocontext.findSource(sources[i]);
         if (as->state == AudioSource::SOURCE_PLAYING)
             as->state = AudioSource::SOURCE_STOPPED;
 		audiocontext.deleteSource(sources[i]);
@@ -592,7 +592,7 @@ void alSourcef(ALuint source, ALenum param, ALfloat value)
 
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
-    auto as = audiocontext.getSource(source);
+    auto as = audiocontext.findSource(source);
     if (!as) {
         alSetError(AL_INVALID_NAME);
         return;
@@ -732,7 +732,7 @@ void alSourcei(ALuint source, ALenum param, ALint value)
 
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
-    auto as = audiocontext.getSource(source);
+    auto as = audiocontext.findSource(source);
     if (!as) {
         alSetError(AL_INVALID_NAME);
         return;
@@ -875,7 +875,7 @@ void alGetSourcef(ALuint source, ALenum param, ALfloat *value)
 
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
-    auto as = audiocontext.getSource(source);
+    auto as = audiocontext.findSource(source);
     if (!as)
         return;
 
@@ -973,7 +973,7 @@ void alGetSourcei(ALuint source, ALenum param, ALint *value)
 
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
-    auto as = audiocontext.getSource(source);
+    auto as = audiocontext.findSource(source);
     if (!as) {
         alSetError(AL_INVALID_NAME);
         return;
@@ -1117,7 +1117,7 @@ void alSourcePlay(ALuint source)
 
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
-    auto as = audiocontext.getSource(source);
+    auto as = audiocontext.findSource(source);
     if (!as)
         return;
 
@@ -1144,7 +1144,7 @@ void alSourcePause(ALuint source)
 
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
-    auto as = audiocontext.getSource(source);
+    auto as = audiocontext.findSource(source);
     if (!as)
         return;
 
@@ -1171,7 +1171,7 @@ void alSourceStop(ALuint source)
 
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
-    auto as = audiocontext.getSource(source);
+    auto as = audiocontext.findSource(source);
     if (!as)
         return;
 
@@ -1199,7 +1199,7 @@ void alSourceRewind(ALuint source)
 
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
-    auto as = audiocontext.getSource(source);
+    auto as = audiocontext.findSource(source);
     if (!as)
         return;
 
@@ -1227,7 +1227,7 @@ void alSourceQueueBuffers(ALuint source, ALsizei n, ALuint* buffers)
 
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
-    auto as = audiocontext.getSource(source);
+    auto as = audiocontext.findSource(source);
     if (!as)
         return;
 
@@ -1257,7 +1257,7 @@ void alSourceUnqueueBuffers(ALuint source, ALsizei n, ALuint* buffers)
 
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
-    auto as = audiocontext.getSource(source);
+    auto as = audiocontext.findSource(source);
     if (!as)
         return;
 
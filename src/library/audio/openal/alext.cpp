@@ -100,7 +100,7 @@ void myalBufferSubDataSOFT(ALuint buffer, ALenum format, const ALvoid *data, ALs
     AudioContext& audiocontext = AudioContext::get();
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
 
-    auto ab = audiocontext.getBuffer(buffer);
+    auto ab = audiocontext.findBuffer(buffer);
     if (ab == nullptr) {
         alSetError(AL_INVALID_VALUE);
         return;
@@ -175,6 +175,10 @@ void myalBufferSubDataSOFT(ALuint buffer, ALenum format, const ALvoid *data, ALs
     debuglogstdio(LCF_SOUND, "%s - do copy of length %d bytes", __func__, length);
 
     memcpy(samples, data, length);
+
+    /* Compressed buffers return decoded samples, do not keep them modified */
+    if (ab->format == AudioBuffer::SAMPLE_FMT_MSADPCM)
+        ab->discardRawSamples();
 }
 
 void myalBufferDataStatic(ALint bid, ALenum format, const ALvoid* data, ALsizei size, ALsizei freq)
@@ -415,34 +415,14 @@ void SDL_MixAudio(Uint8 * dst, const Uint8 * src, Uint32 len, int volume)
     std::lock_guard<std::mutex> lock(audiocontext.mutex);
 
     /* We try to reuse a buffer that has been processed from the source */
-    std::shared_ptr<AudioBuffer> ab;
-    if (sourcesSDL[dev-1]->nbQueueProcessed() > 0) {
-        /* Removing first buffer */
-        ab = sourcesSDL[dev-1]->buffer_queue[0];
-        sourcesSDL[dev-1]->buffer_queue.erase(sourcesSDL[dev-1]->buffer_queue.begin());
-        sourcesSDL[dev-1]->queue_index--;
-    }
-    else {
-        /* Building a new buffer */
-        int bufferId = audiocontext.createBuffer();
-        ab = audiocontext.getBuffer(bufferId);
-
-        /* Getting the parameters of the buffer from one of the queue */
-        if (sourcesSDL[dev-1]->buffer_queue.empty()) {
-            debuglogstdio(LCF_SDL | LCF_SOUND | LCF_ERROR, "Empty queue, cannot guess buffer parameters");
-            return -1;
-        }
-
-        auto ref = sourcesSDL[dev-1]->buffer_queue[0];
-        ab->format = ref->format;
-        ab->nbChannels = ref->nbChannels;
-        ab->frequency = ref->frequency;
+    std::shared_ptr<AudioBuffer> ab = sourcesSDL[dev-1]->recycleBuffer();
+    if (!ab) {
+        debuglogstdio(LCF_SDL | LCF_SOUND | LCF_ERROR, "Empty queue, cannot guess buffer parameters");
+        return -1;
     }
 
     /* Filling buffer */
-    ab->samples.clear();
-    ab->samples.insert(ab->samples.end(), static_cast<const uint8_t*>(data), &(static_cast<const uint8_t*>(data))[len]);
-    ab->size = len;
+    ab->copySamples(data, len);
     ab->update();
     sourcesSDL[dev-1]->buffer_queue.push_back(ab);
 
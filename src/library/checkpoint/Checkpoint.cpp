@@ -31,6 +31,7 @@
 #endif
 #include "StateHeader.h"
 #include "ReservedMemory.h"
+#include "CheckpointStats.h"
 #include "SaveStateSaving.h"
 #include "SaveStateLoading.h"
 #include "TimeHolder.h"
@@ -40,6 +41,7 @@
 #include "GlobalState.h"
 #include "Utils.h"
 #include "renderhud/RenderHUD.h"
+#include "fileio/SaveFileList.h"
 #include "../shared/sockethelpers.h"
 #ifdef __unix__
 #include "../external/xcbint.h"
@@ -90,11 +92,12 @@ static int base_ss_index = -1;
 static ucontext_t ss_ucontext;
 
 static void readAllAreas();
+static void restoreSaveFiles(const StateHeader &sh);
 static int reallocateArea(Area *saved_area, Area *current_area);
 static void readAnArea(SaveStateLoading &saved_area, int spmfd, SaveStateLoading &parent_state, SaveStateLoading &base_state);
 
 static void writeAllAreas(bool base);
-static size_t writeAnArea(SaveStateSaving state, int spmfd, SaveStateLoading &parent_state, bool base);
+static size_t writeAnArea(SaveStateSaving state, int spmfd, SaveStateLoading &parent_state, bool base, bool savefile);
 
 void Checkpoint::setSavestatePath(std::string path)
 {
@@ -165,6 +168,19 @@ static void setPagesFd(int index, int fd)
     pages[index] = fd;
 }
 
+void Checkpoint::freeSavestate()
+{
+    int pmfd = getPagemapFd(ss_index);
+    if (!pmfd)
+        return;
+
+    debuglogstdio(LCF_CHECKPOINT, "Freeing savestate in slot %d", ss_index);
+    NATIVECALL(close(pmfd));
+    NATIVECALL(close(getPagesFd(ss_index)));
+    setPagemapFd(ss_index, 0);
+    setPagesFd(ss_index, 0);
+}
+
 int Checkpoint::checkCheckpoint()
 {
     if (Global::shared_config.savestate_settings & SharedConfig::SS_RAM)
@@ -327,7 +343,9 @@ void Checkpoint::handler(int signum, siginfo_t *info, void *ucontext)
 
         TimeHolder old_time, new_time, delta_time;
         NATIVECALL(clock_gettime(CLOCK_MONOTONIC, &old_time));
+        CheckpointStats::startPhase(CheckpointStats::PHASE_AREAS);
         readAllAreas();
+        CheckpointStats::endPhase(CheckpointStats::PHASE_AREAS);
         NATIVECALL(clock_gettime(CLOCK_MONOTONIC, &new_time));
         delta_time = new_time - old_time;
         debuglogstdio(LCF_CHECKPOINT | LCF_INFO, "Loaded state %d in %f seconds", ss_index, delta_time.tv_sec + ((double)delta_time.tv_nsec) / 1000000000.0);
@@ -358,6 +376,8 @@ void Checkpoint::handler(int signum, siginfo_t *info, void *ucontext)
         memcpy(ucontext, &ss_ucontext, sizeof(ucontext_t));
     }
     else {
+        CheckpointStats::startPhase(CheckpointStats::PHASE_AREAS);
+
         /* Check that base savestate exists, otherwise save it */
         if (Global::shared_config.savestate_settings & SharedConfig::SS_INCREMENTAL) {
             if (Global::shared_config.savestate_settings & SharedConfig::SS_RAM) {
@@ -378,6 +398,7 @@ void Checkpoint::handler(int signum, siginfo_t *info, void *ucontext)
         memcpy(&ss_ucontext, ucontext, sizeof(ucontext_t));
 
         writeAllAreas(false);
+        CheckpointStats::endPhase(CheckpointStats::PHASE_AREAS);
     }
 }
 
@@ -406,6 +427,9 @@ static void readAllAreas()
 
     debuglogstdio(LCF_CHECKPOINT, "Performing restore.");
 
+    /* Restore the size and mapping of savefiles, before matching areas */
+    restoreSaveFiles(sh);
+
     /* Read the memory mapping */
 #ifdef __unix__
     ProcSelfMaps memMapLayout;
@@ -464,6 +488,17 @@ static void readAllAreas()
     }
 }
 
+static void restoreSaveFiles(const StateHeader &sh)
+{
+#ifdef __linux__
+    for (int i = 0; i < sh.savefile_count; i++) {
+        if (!SaveFileList::restoreMappedFile(sh.savefile_fds[i], sh.savefile_inodes[i], sh.savefile_addrs[i], sh.savefile_sizes[i])) {
+            debuglogstdio(LCF_CHECKPOINT | LCF_ERROR, "Savefile with fd %d could not be restored", sh.savefile_fds[i]);
+        }
+    }
+#endif
+}
+
 static int reallocateArea(Area *saved_area, Area *current_area)
 {
     /* Do Areas start on the same address? */
@@ -905,6 +940,8 @@ static void writeAllAreas(bool base)
         }
     }
     sh.thread_count = n;
+    sh.savefile_count = SaveFileList::getMappedFiles(sh.savefile_fds, sh.savefile_inodes,
+        sh.savefile_addrs, sh.savefile_sizes, STATEMAXSAVEFILES);
     Utils::writeAll(pmfd, &sh, sizeof(sh));
     savestate_size += sizeof(sh);
 
@@ -924,8 +961,20 @@ static void writeAllAreas(bool base)
     bool not_eof = memMapLayout.getNextArea(&area);
     
     while (not_eof) {
+        /* Look if the area is the mapping of a savefile. This is not stored
+         * in the area flags, because they must match the flags of the
+         * current areas when loading */
+        bool savefile = false;
+        for (int i = 0; i < sh.savefile_count; i++) {
+            if ((area.flags & Area::AREA_SHARED) && (area.addr >= sh.savefile_addrs[i]) &&
+                (static_cast<char*>(area.addr) < (static_cast<char*>(sh.savefile_addrs[i]) + sh.savefile_sizes[i]))) {
+                savefile = true;
+                break;
+            }
+        }
+
         state.processArea(area);
-        savestate_size += writeAnArea(state, spmfd, parent_state, base);
+        savestate_size += writeAnArea(state, spmfd, parent_state, base, savefile);
         not_eof = memMapLayout.getNextArea(&area);
     }
 
@@ -974,6 +1023,7 @@ static void writeAllAreas(bool base)
     NATIVECALL(clock_gettime(CLOCK_MONOTONIC, &new_time));
     delta_time = new_time - old_time;
     debuglogstdio(LCF_INFO, "Saved state %d of size %zu in %f seconds", base?0:ss_index, savestate_size, delta_time.tv_sec + ((double)delta_time.tv_nsec) / 1000000000.0);
+    CheckpointStats::setStateSize(savestate_size);
 
     if (Global::shared_config.savestate_settings & SharedConfig::SS_FORK) {
         /* Store that we are the child, so that destructors may act differently */
@@ -984,8 +1034,9 @@ static void writeAllAreas(bool base)
     }
 }
 
-/* Write a memory area into the savestate. Returns the size of the area in bytes */
-static size_t writeAnArea(SaveStateSaving state, int spmfd, SaveStateLoading &parent_state, bool base)
+/* Write a memory area into the savestate. `savefile` tells if the area is the
+ * mapping of a savefile. Returns the size of the area in bytes */
+static size_t writeAnArea(SaveStateSaving state, int spmfd, SaveStateLoading &parent_state, bool base, bool savefile)
 {
     Area area = state.getArea();    
     size_t area_size = sizeof(area);
@@ -1030,8 +1081,10 @@ static size_t writeAnArea(SaveStateSaving state, int spmfd, SaveStateLoading &pa
         bool page_present = page & (0x1ull << 63);
         bool soft_dirty = page & (0x1ull << 55);
 
-        /* Check if page is present */
-        if ((Global::shared_config.savestate_settings & SharedConfig::SS_PRESENT) && (!page_present)) {
+        /* Check if page is present. Savefile mappings may have content even
+         * if the page is not mapped in our address space. */
+        if ((Global::shared_config.savestate_settings & SharedConfig::SS_PRESENT) &&
+            (!page_present) && !savefile) {
             state.savePageFlag(Area::NO_PAGE);
         }
 
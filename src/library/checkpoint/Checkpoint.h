@@ -36,6 +36,9 @@ namespace Checkpoint
 
     void setCurrentToParent();
 
+    /* Free the memory of the savestate stored in RAM at the current index */
+    void freeSavestate();
+
     int checkCheckpoint();
     int checkRestore();
     void handler(int signum, siginfo_t *info, void *ucontext);
@@ -0,0 +1,153 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CheckpointStats.h"
+#include "ReservedMemory.h"
+
+#include "logging.h"
+#include "GlobalState.h"
+#include "TimeHolder.h"
+#include "PerfTimer.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h> // PATH_MAX
+#include <stdio.h> // dprintf
+
+namespace libtas {
+
+struct Stats {
+    TimeHolder start[CheckpointStats::PHASE_COUNT];
+    TimeHolder elapsed[CheckpointStats::PHASE_COUNT];
+    TimeHolder io_start;
+    TimeHolder io_elapsed;
+    uint64_t state_size;
+};
+
+static_assert(sizeof(Stats) <= ReservedMemory::STATS_SIZE, "Checkpoint stats don't fit in reserved memory");
+
+static const char* const phase_names[CheckpointStats::PHASE_COUNT] = {"suspend", "files", "areas", "resume"};
+
+/* Output file for timings, empty if not set */
+static char stats_path[PATH_MAX] = {0};
+
+static Stats* getStats()
+{
+    return static_cast<Stats*>(ReservedMemory::getAddr(ReservedMemory::STATS_ADDR));
+}
+
+void CheckpointStats::init()
+{
+    const char* path;
+    NATIVECALL(path = getenv("LIBTAS_CHECKPOINT_STATS"));
+    if (path) {
+        strncpy(stats_path, path, PATH_MAX-1);
+    }
+}
+
+void CheckpointStats::reset()
+{
+    Stats* stats = getStats();
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        stats->elapsed[p] = TimeHolder();
+    }
+    stats->io_elapsed = TimeHolder();
+    stats->state_size = 0;
+}
+
+void CheckpointStats::startPhase(Phase phase)
+{
+    NATIVECALL(clock_gettime(CLOCK_MONOTONIC, &getStats()->start[phase]));
+}
+
+void CheckpointStats::endPhase(Phase phase)
+{
+    Stats* stats = getStats();
+    TimeHolder end_time;
+    NATIVECALL(clock_gettime(CLOCK_MONOTONIC, &end_time));
+    stats->elapsed[phase] += (end_time - stats->start[phase]);
+}
+
+void CheckpointStats::startIO()
+{
+    /* State file I/O is timed around each read or write, so only do it when
+     * timings are requested */
+    if (!stats_path[0])
+        return;
+
+    NATIVECALL(clock_gettime(CLOCK_MONOTONIC, &getStats()->io_start));
+}
+
+void CheckpointStats::endIO()
+{
+    if (!stats_path[0])
+        return;
+
+    Stats* stats = getStats();
+    TimeHolder end_time;
+    NATIVECALL(clock_gettime(CLOCK_MONOTONIC, &end_time));
+    stats->io_elapsed += (end_time - stats->io_start);
+}
+
+void CheckpointStats::setStateSize(size_t size)
+{
+    getStats()->state_size = size;
+}
+
+void CheckpointStats::report(bool loading, int slot)
+{
+    Stats* stats = getStats();
+
+    TimeHolder total;
+    double ms[PHASE_COUNT];
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        total += stats->elapsed[p];
+        ms[p] = stats->elapsed[p].tv_sec * 1000.0 + stats->elapsed[p].tv_nsec / 1000000.0;
+        debuglogstdio(LCF_CHECKPOINT | LCF_INFO, "%s state %d: %s phase took %.3f ms", loading?"Loading":"Saving", slot, phase_names[p], ms[p]);
+    }
+
+    perfTimer.addCall(loading ? PerfCounters::LOADSTATE : PerfCounters::SAVESTATE, total);
+
+    if (!stats_path[0])
+        return;
+
+    double io_ms = stats->io_elapsed.tv_sec * 1000.0 + stats->io_elapsed.tv_nsec / 1000000.0;
+    debuglogstdio(LCF_CHECKPOINT | LCF_INFO, "%s state %d: state file I/O took %.3f ms", loading?"Loading":"Saving", slot, io_ms);
+
+    perfTimer.addCall(PerfCounters::STATE_IO, stats->io_elapsed);
+
+    /* Append a line: operation, slot, the phase timings in ms, the state size
+     * and the state file I/O timing in ms */
+    int fd;
+    NATIVECALL(fd = open(stats_path, O_WRONLY | O_CREAT | O_APPEND, 0644));
+    if (fd < 0) {
+        debuglogstdio(LCF_CHECKPOINT | LCF_ERROR, "Could not open checkpoint stats file %s", stats_path);
+        return;
+    }
+
+    NATIVECALL(dprintf(fd, "%s %d %.3f %.3f %.3f %.3f %llu %.3f\n", loading?"load":"save", slot,
+        ms[PHASE_SUSPEND], ms[PHASE_FILES], ms[PHASE_AREAS], ms[PHASE_RESUME],
+        static_cast<unsigned long long>(stats->state_size), io_ms));
+    NATIVECALL(close(fd));
+}
+
+}
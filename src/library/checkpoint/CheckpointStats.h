@@ -0,0 +1,63 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_CHECKPOINTSTATS_H
+#define LIBTAS_CHECKPOINTSTATS_H
+
+#include <cstddef>
+
+namespace libtas {
+/* Timings of each phase of a savestate or loadstate, to measure the effect
+ * of checkpoint changes. They are stored in our reserved memory, so that
+ * they survive the loading of memory areas. */
+namespace CheckpointStats
+{
+    enum Phase {
+        PHASE_SUSPEND, // suspending all other threads
+        PHASE_FILES, // tracking file handles and savefiles
+        PHASE_AREAS, // writing or reading all memory areas, including state files
+        PHASE_RESUME, // resuming all other threads
+        PHASE_COUNT
+    };
+
+    /* Get the optional output file from environment variable
+     * LIBTAS_CHECKPOINT_STATS */
+    void init();
+
+    /* Reset all timings, at the start of a savestate or loadstate */
+    void reset();
+
+    /* Start and end a phase. A phase may be timed in several parts */
+    void startPhase(Phase phase);
+    void endPhase(Phase phase);
+
+    /* Start and end a read or write of the state files. This time is also
+     * counted in the areas phase. Only measured when an output file is set */
+    void startIO();
+    void endIO();
+
+    /* Store the size of the saved state */
+    void setStateSize(size_t size);
+
+    /* Log the timings, and append them to the output file if any */
+    void report(bool loading, int slot);
+}
+}
+
+#endif
@@ -24,6 +24,9 @@
 
 #include "logging.h"
 #include "Utils.h"
+#include "../shared/sockethelpers.h"
+#include "renderhud/LogWindow.h"
+#include "renderhud/LuaDraw.h"
 
 #include <unistd.h>
 #include <sys/mman.h> // PROT_READ, PROT_WRITE, etc.
@@ -97,6 +100,21 @@ bool Area::isSkipped() const
         return true;
     }
 
+    /* Don't save the channel with the program, its state is not ours */
+    if (isChannelArea(addr, size)) {
+        return true;
+    }
+
+    /* Don't save the log window lines, so that they are kept after loading */
+    if (LogWindow::isLogArea(addr, size)) {
+        return true;
+    }
+
+    /* Don't save the lua draw list, the program only sends its changes */
+    if (LuaDraw::isLuaDrawArea(addr, size)) {
+        return true;
+    }
+
     /* Don't save area that cannot be promoted to read/write */
     if ((max_prot & (PROT_WRITE|PROT_READ)) != (PROT_WRITE|PROT_READ)) {
         return false;
@@ -29,6 +29,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <cstring>
 
 namespace libtas {
@@ -39,7 +40,9 @@ ProcSelfMaps::ProcSelfMaps() : off(0)
     int fd;
     NATIVECALL(fd = open("/proc/self/maps", O_RDONLY));
     MYASSERT(fd != -1);
-    NATIVECALL(tmp_fd = open("/tmp/libtas-maps", O_RDWR | O_CREAT | O_TRUNC, 0666));
+    /* Use a private file, so that multiple game instances don't overwrite
+     * each other's copy */
+    tmp_fd = syscall(SYS_memfd_create, "libtas-maps", 0);
     MYASSERT(tmp_fd != -1);
     
     ssize_t sz = 1;
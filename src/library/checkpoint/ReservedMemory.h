@@ -22,6 +22,8 @@
 #ifndef LIBTAS_RESERVEDMEMORY_H
 #define LIBTAS_RESERVEDMEMORY_H
 
+#include "../../shared/SharedConfig.h"
+
 #include <cstdint> // intptr_t
 #include <cstddef> // size_t
 
@@ -32,21 +34,25 @@ namespace libtas {
 namespace ReservedMemory {
     enum Addresses {
         PAGEMAPS_ADDR = 0,
-        PAGES_ADDR = 11*sizeof(int),
-        SS_SLOTS_ADDR = 22*sizeof(int),
-        PSM_ADDR = 22*sizeof(int)+11*sizeof(bool),
+        PAGES_ADDR = SharedConfig::SLOT_COUNT*sizeof(int),
+        SS_SLOTS_ADDR = 2*SharedConfig::SLOT_COUNT*sizeof(int),
+        STATS_ADDR = 512, // aligned, after the savestate slots
+        PSM_ADDR = STATS_ADDR+256,
         COMPRESSED_ADDR = ONE_MB,
         STACK_ADDR = 6 * ONE_MB,
     };
     enum Sizes {
         PAGEMAPS_SIZE = PAGES_ADDR - PAGEMAPS_ADDR,
         PAGES_SIZE = SS_SLOTS_ADDR - PAGES_ADDR,
-        SS_SLOTS_SIZE = PSM_ADDR - SS_SLOTS_ADDR,
+        SS_SLOTS_SIZE = STATS_ADDR - SS_SLOTS_ADDR,
+        STATS_SIZE = PSM_ADDR - STATS_ADDR,
         PSM_SIZE = COMPRESSED_ADDR - PSM_ADDR,
         COMPRESSED_SIZE = STACK_ADDR - COMPRESSED_ADDR,
         STACK_SIZE = RESTORE_TOTAL_SIZE - STACK_ADDR,
     };
 
+    static_assert(static_cast<int>(SS_SLOTS_SIZE) >= static_cast<int>(SharedConfig::SLOT_COUNT*sizeof(bool)), "Savestate slots don't fit in reserved memory");
+
     void init();
     void* getAddr(intptr_t offset);
     size_t getSize();
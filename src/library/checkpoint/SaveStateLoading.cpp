@@ -21,6 +21,7 @@
 
 #include "SaveStateLoading.h"
 #include "StateHeader.h"
+#include "CheckpointStats.h"
 
 #include "Utils.h"
 #include "logging.h"
@@ -33,6 +34,14 @@
 
 namespace libtas {
 
+/* Read from a state file, and time it */
+static void readStateFile(int fd, void* buf, size_t count)
+{
+    CheckpointStats::startIO();
+    Utils::readAll(fd, buf, count);
+    CheckpointStats::endIO();
+}
+
 SaveStateLoading::SaveStateLoading(const char* pagemappath, const char* pagespath, int pagemapfd, int pagesfd)
 {
     queued_size = 0;
@@ -76,7 +85,7 @@ SaveStateLoading::~SaveStateLoading()
 void SaveStateLoading::readHeader(StateHeader& sh)
 {
     lseek(pmfd, 0, SEEK_SET);
-    Utils::readAll(pmfd, &sh, sizeof(sh));
+    readStateFile(pmfd, &sh, sizeof(sh));
 
     restart();
 }
@@ -100,7 +109,7 @@ char SaveStateLoading::nextFlag()
 
     	int size = (flags_remaining > 4096 ? 4096 : flags_remaining);
 
-    	Utils::readAll(pmfd, flags, size);
+    	readStateFile(pmfd, flags, size);
     	flags_remaining -= size;
 
     	flag_i = 0;
@@ -114,7 +123,7 @@ Area SaveStateLoading::nextArea()
 {
     if (flags_remaining > 0)
         lseek(pmfd, flags_remaining, SEEK_CUR);
-    Utils::readAll(pmfd, &area, sizeof(Area));
+    readStateFile(pmfd, &area, sizeof(Area));
     next_pfd_offset = area.page_offset;
     current_addr = static_cast<char*>(area.addr);
     flag_i = 4096;
@@ -161,7 +170,7 @@ char SaveStateLoading::getPageFlag(char* addr)
         }
         else if (flag == Area::COMPRESSED_PAGE) {
             lseek(pfd, next_pfd_offset, SEEK_SET);
-            Utils::readAll(pfd, &compressed_length, sizeof(int));
+            readStateFile(pfd, &compressed_length, sizeof(int));
             next_pfd_offset += sizeof(int) + compressed_length;
         }
         current_addr += 4096;
@@ -180,7 +189,7 @@ char SaveStateLoading::getNextPageFlag()
     }
     else if (flag == Area::COMPRESSED_PAGE) {
         lseek(pfd, next_pfd_offset, SEEK_SET);
-        Utils::readAll(pfd, &compressed_length, sizeof(int));
+        readStateFile(pfd, &compressed_length, sizeof(int));
         next_pfd_offset += sizeof(int) + compressed_length;
     }
     current_addr += 4096;
@@ -191,7 +200,7 @@ void SaveStateLoading::finishLoad()
 {
     if (queued_size > 0) {
         lseek(pfd, queued_offset, SEEK_SET);
-        Utils::readAll(pfd, queued_addr, queued_size);
+        readStateFile(pfd, queued_addr, queued_size);
         queued_size = 0;
     }
 }
@@ -208,7 +217,7 @@ void SaveStateLoading::queuePageLoad(char* addr)
                 return;
         	} else {
                 lseek(pfd, queued_offset, SEEK_SET);
-                Utils::readAll(pfd, queued_addr, queued_size);
+                readStateFile(pfd, queued_addr, queued_size);
         	}
         }
         queued_offset = (next_pfd_offset - 4096);
@@ -217,7 +226,7 @@ void SaveStateLoading::queuePageLoad(char* addr)
     }
     else if (current_flag == Area::COMPRESSED_PAGE) {
         char compressed[LZ4_COMPRESSBOUND(4096)];
-        Utils::readAll(pfd, compressed, compressed_length);
+        readStateFile(pfd, compressed, compressed_length);
         LZ4_decompress_safe_continue (&lz4s, compressed, addr, compressed_length, 4096);
     }
 }
@@ -25,6 +25,7 @@
 #include "Checkpoint.h"
 #include "AltStack.h"
 #include "ReservedMemory.h"
+#include "CheckpointStats.h"
 #include "ThreadInfo.h"
 
 #include "general/timewrappers.h" // clock_gettime
@@ -38,6 +39,7 @@
 #include "audio/AudioPlayerCoreAudio.h"
 #endif
 #include "fileio/FileHandleList.h"
+#include "fileio/SaveFileList.h"
 #include "renderhud/MessageWindow.h"
 #ifdef __unix__
 #include "xlib/xdisplay.h" // x11::gameDisplays
@@ -83,7 +85,9 @@ void SaveStateManager::init()
     ReservedMemory::init();
 
     state_dirty = static_cast<bool*>(ReservedMemory::getAddr(ReservedMemory::SS_SLOTS_ADDR));
-    memset(state_dirty, 0, 11*sizeof(bool));
+    memset(state_dirty, 0, SharedConfig::SLOT_COUNT*sizeof(bool));
+
+    CheckpointStats::init();
 }
 
 void SaveStateManager::initCheckpointThread()
@@ -147,7 +151,7 @@ int SaveStateManager::waitChild()
         return -1;
     }
     status = WEXITSTATUS(status);
-    if ((status < 0) && (status > 10)) {
+    if ((status < 0) || (status >= SharedConfig::SLOT_COUNT)) {
         debuglogstdio(LCF_THREAD | LCF_CHECKPOINT | LCF_ERROR, "Got unknown status code %d from pid %d", status, pid);
         return -1;
     }
@@ -165,7 +169,7 @@ bool SaveStateManager::stateReady(int slot)
     if (!(Global::shared_config.savestate_settings & SharedConfig::SS_FORK))
         return true;
 
-    if ((slot < 0) && (slot > 10)) {
+    if ((slot < 0) || (slot >= SharedConfig::SLOT_COUNT)) {
         debuglogstdio(LCF_THREAD | LCF_CHECKPOINT | LCF_ERROR, "Wrong slot number");
         return false;
     }
@@ -188,6 +192,8 @@ int SaveStateManager::checkpoint(int slot)
 
     ThreadSync::acquireLocks();
 
+    CheckpointStats::reset();
+
     restoreInProgress = false;
 
     /* We must close the connection to the sound device. This must be done
@@ -247,7 +253,9 @@ int SaveStateManager::checkpoint(int slot)
 #endif
 
     /* Sending a suspend signal to all threads */
+    CheckpointStats::startPhase(CheckpointStats::PHASE_SUSPEND);
     suspendThreads();
+    CheckpointStats::endPhase(CheckpointStats::PHASE_SUSPEND);
 
 #ifdef __linux__
     /* Disable the signal that refills the fake urandom pipe. Must be done
@@ -259,8 +267,14 @@ int SaveStateManager::checkpoint(int slot)
     /* We flag all opened files as tracked and store their offset. This must be
      * done AFTER suspending threads.
      */
+    CheckpointStats::startPhase(CheckpointStats::PHASE_FILES);
     FileHandleList::trackAllFiles();
 
+    /* Map savefiles in memory so that their content is saved along the other
+     * memory areas. */
+    SaveFileList::syncAllFiles();
+    CheckpointStats::endPhase(CheckpointStats::PHASE_FILES);
+
     /* We set the alternate stack to our reserved memory. The game might
      * register its own alternate stack, so we set our own just before the
      * checkpoint and we restore the game's alternate stack just after.
@@ -281,13 +295,21 @@ int SaveStateManager::checkpoint(int slot)
     /* We recover the offset of all opened files. This must also be done BEFORE
      * resuming threads.
      */
+    CheckpointStats::startPhase(CheckpointStats::PHASE_FILES);
     FileHandleList::recoverAllFiles();
 
+    /* Savefiles content was rewritten through their memory mapping, register
+     * their current state so that they are not considered modified. */
+    if (isLoading())
+        SaveFileList::refreshAllFiles();
+    CheckpointStats::endPhase(CheckpointStats::PHASE_FILES);
+
 #ifdef __linux__
     /* Restore the signal that refills the fake urandom pipe */
     urandom_enable_handler();
 #endif
 
+    CheckpointStats::startPhase(CheckpointStats::PHASE_RESUME);
     resumeThreads();
 
 #ifdef __unix__
@@ -302,9 +324,12 @@ int SaveStateManager::checkpoint(int slot)
     debuglogstdio(LCF_THREAD | LCF_CHECKPOINT, "Waiting for other threads to resume");
     waitForAllRestored(current_thread);
     debuglogstdio(LCF_THREAD | LCF_CHECKPOINT, "Resuming main thread");
+    CheckpointStats::endPhase(CheckpointStats::PHASE_RESUME);
 
     ThreadSync::releaseLocks();
 
+    CheckpointStats::report(isLoading(), slot);
+
     /* Mark the savestate as dirty in case of fork savestate */
     if (!isLoading())
         stateStatus(slot, true);
@@ -321,6 +346,8 @@ int SaveStateManager::restore(int slot)
     MYASSERT(current_thread->state == ThreadInfo::ST_CKPNTHREAD)
     ThreadSync::acquireLocks();
 
+    CheckpointStats::reset();
+
     /* We must close the connection to the sound device. This must be done
      * BEFORE suspending threads.
      */
@@ -356,7 +383,9 @@ int SaveStateManager::restore(int slot)
     }
 #endif
 
+    CheckpointStats::startPhase(CheckpointStats::PHASE_SUSPEND);
     suspendThreads();
+    CheckpointStats::endPhase(CheckpointStats::PHASE_SUSPEND);
 
     restoreInProgress = true;
 
@@ -367,8 +396,14 @@ int SaveStateManager::restore(int slot)
 
     /* We close all untracked files, because by definition they are closed when
      * the savestate will be loaded. */
+    CheckpointStats::startPhase(CheckpointStats::PHASE_FILES);
     FileHandleList::closeUntrackedFiles();
 
+    /* Flag savefiles modified since the last savestate as dirty, so that
+     * their content is entirely loaded back. */
+    SaveFileList::syncAllFiles();
+    CheckpointStats::endPhase(CheckpointStats::PHASE_FILES);
+
     /* We set the alternate stack to our reserved memory. The game might
      * register its own alternate stack, so we set our own just before the
      * checkpoint and we restore the game's alternate stack just after.
@@ -21,6 +21,7 @@
 
 #include "SaveStateSaving.h"
 #include "ReservedMemory.h"
+#include "CheckpointStats.h"
 
 #include "Utils.h"
 #include "logging.h"
@@ -33,6 +34,14 @@
 
 namespace libtas {
 
+/* Write into a state file, and time it */
+static void writeStateFile(int fd, const void* buf, size_t count)
+{
+    CheckpointStats::startIO();
+    Utils::writeAll(fd, buf, count);
+    CheckpointStats::endIO();
+}
+
 SaveStateSaving::SaveStateSaving(int pagemapfd, int pagesfd, int selfpagemapfd)
 {
     ss_pagemap_i = 0;
@@ -66,7 +75,7 @@ void SaveStateSaving::processArea(Area a)
     else
         area.uncommitted = false;
     
-    Utils::writeAll(pmfd, &area, sizeof(area));
+    writeStateFile(pmfd, &area, sizeof(area));
 }
 
 Area SaveStateSaving::getArea()
@@ -78,7 +87,7 @@ void SaveStateSaving::savePageFlag(char flag)
 {
     /* We write a chunk of savestate pagemaps if it is full */
     if (ss_pagemap_i >= 4096) {
-        Utils::writeAll(pmfd, ss_pagemaps, 4096);
+        writeStateFile(pmfd, ss_pagemaps, 4096);
         ss_pagemap_i = 0;
     }
 
@@ -141,7 +150,7 @@ size_t SaveStateSaving::queuePageSave(char* addr)
 size_t SaveStateSaving::flushSave()
 {
     if (queued_size > 0) {
-        Utils::writeAll(pfd, queued_addr, queued_size);
+        writeStateFile(pfd, queued_addr, queued_size);
         int returned_size = queued_size;
         queued_size = 0;
         return returned_size;
@@ -152,7 +161,7 @@ size_t SaveStateSaving::flushSave()
 size_t SaveStateSaving::flushCompressedSave()
 {
     if (queued_compressed_size > 0) {
-        Utils::writeAll(pfd, queued_compressed_base_addr, queued_compressed_size);
+        writeStateFile(pfd, queued_compressed_base_addr, queued_compressed_size);
         int returned_size = queued_compressed_size;
         queued_compressed_size = 0;
         return returned_size;        
@@ -170,7 +179,7 @@ size_t SaveStateSaving::finishSave()
     returned_size += flushCompressedSave();
     
     /* Writing the last savestate pagemap chunk */
-    Utils::writeAll(pmfd, ss_pagemaps, ss_pagemap_i);
+    writeStateFile(pmfd, ss_pagemaps, ss_pagemap_i);
     
     return returned_size;
 }
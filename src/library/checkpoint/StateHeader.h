@@ -23,8 +23,10 @@
 #define LIBTAS_STATEHEADER_H
 
 #include <pthread.h>
+#include <sys/types.h>
 
 #define STATEMAXTHREADS 1000
+#define STATEMAXSAVEFILES 256
 
 namespace libtas {
 struct StateHeader {
@@ -32,6 +34,14 @@ struct StateHeader {
     pthread_t pthread_ids[STATEMAXTHREADS];
     pid_t tids[STATEMAXTHREADS];
     int states[STATEMAXTHREADS];
+
+    /* Savefiles that are mapped in memory. Their content is stored with the
+     * other memory areas, but their size must be restored beforehand. */
+    int savefile_count;
+    int savefile_fds[STATEMAXSAVEFILES];
+    ino_t savefile_inodes[STATEMAXSAVEFILES];
+    void* savefile_addrs[STATEMAXSAVEFILES];
+    off_t savefile_sizes[STATEMAXSAVEFILES];
 };
 }
 
@@ -21,6 +21,7 @@
 #include "NutMuxer.h"
 
 #include "logging.h"
+#include "PerfTimer.h"
 #include "screencapture/ScreenCapture.h"
 #include "audio/AudioContext.h"
 #include "global.h" // Global::shared_config
@@ -42,10 +43,48 @@ char AVEncoder::ffmpeg_options[4096] = {0};
 
 std::unique_ptr<AVEncoder> avencoder;
 
+/* Fast hash of a frame, used to detect duplicate frames. This is FNV-1a on
+ * 64-bit words, with four independent lanes so that multiplications can be
+ * pipelined */
+static uint64_t frameHash(const uint8_t* data, int size)
+{
+    static const uint64_t FNV_PRIME = 0x100000001b3ULL;
+    uint64_t lanes[4];
+    for (int l=0; l<4; l++)
+        lanes[l] = 0xcbf29ce484222325ULL + l;
+
+    int i = 0;
+    for (; i + 32 <= size; i += 32) {
+        uint64_t words[4];
+        memcpy(words, data + i, 32);
+        for (int l=0; l<4; l++) {
+            lanes[l] ^= words[l];
+            lanes[l] *= FNV_PRIME;
+        }
+    }
+
+    uint64_t hash = lanes[0];
+    for (int l=1; l<4; l++) {
+        hash ^= lanes[l];
+        hash *= FNV_PRIME;
+    }
+    for (; i < size; i++) {
+        hash ^= data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
 
 AVEncoder::AVEncoder() {
     std::ostringstream commandline;
     commandline << "ffmpeg -hide_banner -y -f nut -i - ";
+    /* Frames converted by us are limited range rec601, which ffmpeg cannot
+     * get from the nut header. This also matches the default conversion of
+     * ffmpeg if frames cannot be converted. User options come after, so they
+     * can still override it. */
+    if (Global::shared_config.video_yuv_conversion)
+        commandline << "-colorspace bt470bg -color_range tv ";
     commandline << ffmpeg_options;
     commandline << " \"";
     commandline.write(dumpfile, static_cast<int>(strrchr(dumpfile, '.') - dumpfile));
@@ -79,15 +118,33 @@ void AVEncoder::initMuxer() {
 
     const char* pixfmt = ScreenCapture::getPixelFormat();
 
+    /* Convert frames ourselves if asked and if the format is supported */
+    convert_video = false;
+    if (Global::shared_config.video_yuv_conversion) {
+        convert_video = converter.init(width, height, pixfmt, Global::shared_config.video_downscale);
+        if (convert_video) {
+            width = converter.outWidth;
+            height = converter.outHeight;
+            pixfmt = converter.getPixelFormat();
+        }
+        else {
+            debuglogstdio(LCF_DUMP | LCF_WARNING, "Cannot convert frames of pixel format %.4s, sending them unconverted", pixfmt);
+        }
+    }
+
     /* Initialize the muxer with either framerate or video framerate */
     AudioContext& audiocontext = AudioContext::get();
     if (Global::shared_config.variable_framerate)
-        nutMuxer = new NutMuxer(width, height, Global::shared_config.video_framerate, 1, pixfmt, audiocontext.outFrequency, audiocontext.outAlignSize, audiocontext.outNbChannels, ffmpeg_pipe);
+        nutMuxer = new NutMuxer(width, height, Global::shared_config.video_framerate, 1, pixfmt, audiocontext.outFrequency, audiocontext.outAlignSize, audiocontext.outNbChannels, ffmpeg_pipe, convert_video, !Global::shared_config.video_skip_duplicates);
     else
-        nutMuxer = new NutMuxer(width, height, Global::shared_config.initial_framerate_num, Global::shared_config.initial_framerate_den, pixfmt, audiocontext.outFrequency, audiocontext.outAlignSize, audiocontext.outNbChannels, ffmpeg_pipe);
+        nutMuxer = new NutMuxer(width, height, Global::shared_config.initial_framerate_num, Global::shared_config.initial_framerate_den, pixfmt, audiocontext.outFrequency, audiocontext.outAlignSize, audiocontext.outNbChannels, ffmpeg_pipe, convert_video, !Global::shared_config.video_skip_duplicates);
+
+    video_frame_size = ScreenCapture::getSize();
+    readback_delay = ScreenCapture::getReadbackDelay();
 }
 
 void AVEncoder::encodeOneFrame(bool draw, TimeHolder frametime) {
+    PerfScope ps(PerfCounters::ENCODE);
 
     /* If the muxer is not initialized, try to initialize it. Otherwise, store
      * that we skipped one frame and we need to encode it later.
@@ -105,9 +162,7 @@ void AVEncoder::encodeOneFrame(bool draw, TimeHolder frametime) {
             /* Just getting the size of an image */
             int size = ScreenCapture::getSize();
             startup_audio_bytes.resize(size, 0); // reusing the audio samples vector
-            for (int i=0; i<startup_video_frames; i++) {
-                nutMuxer->writeVideoFrame(startup_audio_bytes.data(), size);
-            }
+            writeVideoFrames(startup_audio_bytes.data(), size, startup_video_frames, false);
         }
         else {
             startup_video_frames++;
@@ -117,14 +172,7 @@ void AVEncoder::encodeOneFrame(bool draw, TimeHolder frametime) {
         }
     }
 
-    /*** Audio ***/
-    debuglogstdio(LCF_DUMP, "Encode an audio frame");
-
-    nutMuxer->writeAudioFrame(audiocontext.outSamples.data(), audiocontext.outBytes);
-
-    /*** Video ***/
-
-    /* Number of frames to encode */
+    /* Number of video frames to encode */
     int frames = 1;
 
     if (Global::shared_config.variable_framerate) {
@@ -135,17 +183,138 @@ void AVEncoder::encodeOneFrame(bool draw, TimeHolder frametime) {
         frame_remainder -= frames;
     }
 
+    if (readback_delay == 0) {
+        writeFrame(audiocontext.outSamples.data(), audiocontext.outBytes, frames, draw);
+        return;
+    }
+
+    /* The pixels of this frame will only be available after a few frames,
+     * so we store the frame and encode the oldest one instead. Audio
+     * buffers of encoded frames are reused. */
+    std::vector<uint8_t> audio_bytes;
+    if (delayed_frames.size() >= static_cast<size_t>(readback_delay)) {
+        DelayedFrame& oldest = delayed_frames.front();
+        writeFrame(oldest.audio_bytes.data(), oldest.audio_bytes.size(), oldest.video_frames, oldest.draw);
+        audio_bytes.swap(oldest.audio_bytes);
+        delayed_frames.pop_front();
+    }
+
+    audio_bytes.assign(audiocontext.outSamples.data(), audiocontext.outSamples.data() + audiocontext.outBytes);
+    delayed_frames.push_back(DelayedFrame());
+    delayed_frames.back().audio_bytes.swap(audio_bytes);
+    delayed_frames.back().video_frames = frames;
+    delayed_frames.back().draw = draw;
+}
+
+void AVEncoder::writeFrame(const uint8_t* audio_bytes, int audio_size, int video_frames, bool draw) {
+    /*** Audio ***/
+    debuglogstdio(LCF_DUMP, "Encode an audio frame");
+
+    nutMuxer->writeAudioFrame(audio_bytes, audio_size);
+
+    /*** Video ***/
+
     /* Access to the screen pixels, or last screen pixels if not a draw frame */
     int size = ScreenCapture::getPixelsFromSurface(&pixels, draw);
 
-    for (int f=0; f<frames; f++) {
+    /* Pixels of a non-draw frame are the ones that we sent last */
+    bool repeated = !draw && last_frame_captured;
+    last_frame_captured = true;
+
+    /* The screen capture was closed while frames were delayed, so we encode
+     * blank frames like for startup frames */
+    if (size == 0) {
+        size = video_frame_size;
+        startup_audio_bytes.assign(size, 0);
+        pixels = startup_audio_bytes.data();
+        repeated = false;
+        last_frame_captured = false;
+    }
+
+    writeVideoFrames(pixels, size, video_frames, repeated);
+}
+
+void AVEncoder::writeVideoFrames(const uint8_t* video_pixels, int size, int video_frames, bool repeated) {
+    if (video_frames == 0)
+        return;
+
+    bool skip_duplicates = Global::shared_config.video_skip_duplicates;
+
+    if (skip_duplicates) {
+        if (!repeated) {
+            uint64_t hash = frameHash(video_pixels, size);
+            repeated = has_last_hash && (hash == last_hash);
+            last_hash = hash;
+            has_last_hash = true;
+        }
+
+        /* Don't send the frame, the previous one will last longer instead */
+        if (repeated) {
+            if (skipped_frames == 0) {
+                /* Keep a copy of the frame, in case the encode ends with
+                 * duplicates of it. If converting, the converter still holds
+                 * the last converted frame. */
+                const uint8_t* frame = convert_video ? sent_pixels : video_pixels;
+                last_frame.assign(frame, frame + sent_size);
+            }
+            debuglogstdio(LCF_DUMP, "Skip %d duplicate video frames", video_frames);
+            nutMuxer->skipVideoFrames(video_frames);
+            skipped_frames += video_frames;
+            return;
+        }
+        skipped_frames = 0;
+    }
+
+    if (convert_video) {
+        video_pixels = converter.convert(video_pixels);
+        size = converter.getSize();
+    }
+
+    sent_pixels = video_pixels;
+    sent_size = size;
+
+    if (skip_duplicates) {
+        debuglogstdio(LCF_DUMP, "Encode a video frame");
+        nutMuxer->writeVideoFrame(video_pixels, size);
+
+        if (video_frames > 1) {
+            last_frame.assign(video_pixels, video_pixels + size);
+            nutMuxer->skipVideoFrames(video_frames - 1);
+            skipped_frames = video_frames - 1;
+        }
+        return;
+    }
+
+    has_last_hash = false;
+    skipped_frames = 0;
+
+    for (int f=0; f<video_frames; f++) {
         debuglogstdio(LCF_DUMP, "Encode a video frame");
-        nutMuxer->writeVideoFrame(pixels, size);
+        nutMuxer->writeVideoFrame(video_pixels, size);
+    }
+}
+
+void AVEncoder::flushDelayedFrames() {
+    if (!nutMuxer)
+        return;
+
+    while (!delayed_frames.empty()) {
+        DelayedFrame& oldest = delayed_frames.front();
+        writeFrame(oldest.audio_bytes.data(), oldest.audio_bytes.size(), oldest.video_frames, oldest.draw);
+        delayed_frames.pop_front();
     }
 }
 
 AVEncoder::~AVEncoder() {
     if (nutMuxer) {
+        flushDelayedFrames();
+
+        /* Send the last frame again if it was followed by skipped duplicates,
+         * otherwise the video would be cut short */
+        if (skipped_frames > 0) {
+            nutMuxer->writeLastSkippedVideoFrame(last_frame.data(), last_frame.size());
+        }
+
         nutMuxer->finish();
     }
 
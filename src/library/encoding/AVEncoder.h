@@ -21,8 +21,10 @@
 #define LIBTAS_AVDUMPING_H_INCL
 
 #include "TimeHolder.h"
+#include "VideoConverter.h"
 
 #include <vector>
+#include <deque>
 #include <memory> // std::unique_ptr
 
 namespace libtas {
@@ -48,6 +50,10 @@ class AVEncoder {
          */
         void encodeOneFrame(bool draw, TimeHolder frametime);
 
+        /* Encode the frames that are still waiting for their pixels. Must be
+         * called before the screen capture is closed or resized */
+        void flushDelayedFrames();
+
         /* Close all allocated objects and close the pipe at the end of an av dump
          */
         ~AVEncoder();
@@ -73,6 +79,53 @@ class AVEncoder {
 
         /* remainder of the number of video frames to send */
         double frame_remainder = 0;
+
+        /* Frame waiting for the screen capture to return its pixels */
+        struct DelayedFrame {
+            std::vector<uint8_t> audio_bytes;
+            int video_frames;
+            bool draw;
+        };
+
+        /* When the screen capture returns pixels a few frames after the
+         * copy, frames are kept here and encoded in order once the pixels
+         * are available */
+        std::deque<DelayedFrame> delayed_frames;
+
+        /* Size of a video frame in bytes */
+        int video_frame_size = 0;
+
+        /* Number of frames between a screen copy and its pixels */
+        int readback_delay = 0;
+
+        /* Optional conversion of frames to YUV before sending them */
+        VideoConverter converter;
+        bool convert_video = false;
+
+        /* Is the last sent frame coming from the screen capture */
+        bool last_frame_captured = false;
+
+        /* Hash of the last sent frame, to detect duplicate frames */
+        uint64_t last_hash = 0;
+        bool has_last_hash = false;
+
+        /* Number of duplicate frames skipped since the last sent frame */
+        int skipped_frames = 0;
+
+        /* Last sent frame, kept when skipping duplicates so that it can be
+         * sent again at the end of the encode */
+        const uint8_t* sent_pixels = nullptr;
+        int sent_size = 0;
+        std::vector<uint8_t> last_frame;
+
+        /* Encode a frame with the pixels currently returned by the screen
+         * capture */
+        void writeFrame(const uint8_t* audio_bytes, int audio_size, int video_frames, bool draw);
+
+        /* Send a video frame a number of times, converting it if needed.
+         * `repeated` indicates that the frame is known to be the same as the
+         * last sent frame */
+        void writeVideoFrames(const uint8_t* video_pixels, int size, int video_frames, bool repeated);
 };
 
 extern std::unique_ptr<AVEncoder> avencoder;
@@ -217,7 +217,7 @@ void NutMuxer::writeVideoHeader()
 	writeVarU(8, header_packet.data); // msb_pts_shift
 	writeVarU(1, header_packet.data); // max_pts_distance
 	writeVarU(0, header_packet.data); // decode_delay
-	writeVarU(1, header_packet.data); // stream_flags = FLAG_FIXED_FPS
+	writeVarU(avparams.fixedfps ? 1 : 0, header_packet.data); // stream_flags = FLAG_FIXED_FPS, unless frames are skipped
 	writeBytes("", 0, header_packet.data); // codec_specific_data
 
 	// stream_class = video
@@ -225,7 +225,10 @@ void NutMuxer::writeVideoHeader()
 	writeVarU(avparams.height, header_packet.data); // height
 	writeVarU(1, header_packet.data); // sample_width
 	writeVarU(1, header_packet.data); // sample_height
-	writeVarU(18, header_packet.data); // colorspace_type = full range rec709 (avisynth's "PC.709")
+	if (avparams.limitedrange601)
+		writeVarU(1, header_packet.data); // colorspace_type = limited range rec601 (avisynth's "TV.601")
+	else
+		writeVarU(18, header_packet.data); // colorspace_type = full range rec709 (avisynth's "PC.709")
 
 	header_packet.flush();
 }
@@ -308,6 +311,21 @@ void NutMuxer::writeVideoFrame(const uint8_t* video, unsigned int len)
 
 }
 
+void NutMuxer::skipVideoFrames(unsigned int count)
+{
+	debuglogstdio(LCF_DUMP, "Skip %u nut video frames", count);
+	videopts += count;
+}
+
+void NutMuxer::writeLastSkippedVideoFrame(const uint8_t* video, unsigned int len)
+{
+	if (videopts == 0)
+		return;
+
+	debuglogstdio(LCF_DUMP, "Write nut video frame at the last skipped frame");
+	writeFrame(video, len, videopts - 1, static_cast<uint64_t>(avparams.fpsden), static_cast<uint64_t>(avparams.fpsnum), 0, output);
+}
+
 void NutMuxer::writeAudioFrame(const uint8_t* samples, unsigned int len)
 {
 	debuglogstdio(LCF_DUMP, "Write nut audio frame");
@@ -318,7 +336,7 @@ void NutMuxer::writeAudioFrame(const uint8_t* samples, unsigned int len)
 	audiopts += static_cast<uint64_t>(len) / static_cast<uint64_t>(avparams.samplesize);
 }
 
-NutMuxer::NutMuxer(int width, int height, int fpsnum, int fpsden, const char* pixfmt, int samplerate, int samplesize, int channels, FILE *underlying)
+NutMuxer::NutMuxer(int width, int height, int fpsnum, int fpsden, const char* pixfmt, int samplerate, int samplesize, int channels, FILE *underlying, bool limitedrange601, bool fixedfps)
 {
 	avparams.width = width;
 	avparams.height = height;
@@ -329,6 +347,8 @@ NutMuxer::NutMuxer(int width, int height, int fpsnum, int fpsden, const char* pi
 	avparams.samplesize = samplesize;
 	avparams.channels = channels;
 	avparams.pixfmt = pixfmt;
+	avparams.limitedrange601 = limitedrange601;
+	avparams.fixedfps = fixedfps;
 	output = underlying;
 
 	audiopts = 0;
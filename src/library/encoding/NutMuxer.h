@@ -72,6 +72,8 @@ public:
     public:
 		int width, height, samplerate, samplesize, fpsnum, fpsden, channels;
 		const char* pixfmt;
+		bool limitedrange601; // video is limited range rec601 yuv
+		bool fixedfps; // a video frame is written at every frame
 		void reduce();
 	};
 
@@ -123,9 +125,19 @@ public:
 
     void writeVideoFrame(const uint8_t* video, unsigned int len);
 
+	/// <summary>
+	/// advance the video stream without writing frames, so that the previous frame lasts longer
+	/// </summary>
+    void skipVideoFrames(unsigned int count);
+
+	/// <summary>
+	/// write a frame at the time of the last skipped frame, so that the video has the correct length
+	/// </summary>
+    void writeLastSkippedVideoFrame(const uint8_t* video, unsigned int len);
+
     void writeAudioFrame(const uint8_t* samples, unsigned int len);
 
-	NutMuxer(int width, int height, int fpsnum, int fpsden, const char* pixfmt, int samplerate, int samplesize, int channels, FILE *underlying);
+	NutMuxer(int width, int height, int fpsnum, int fpsden, const char* pixfmt, int samplerate, int samplesize, int channels, FILE *underlying, bool limitedrange601 = false, bool fixedfps = true);
 
 	void finish();
 
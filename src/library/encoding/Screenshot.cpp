@@ -60,7 +60,7 @@ int Screenshot::save(const std::string& screenshotfile, bool draw) {
 
     /* Access to the screen pixels, or last screen pixels if not a draw frame */
     uint8_t* pixels = nullptr;
-    int size = ScreenCapture::getPixelsFromSurface(&pixels, draw);
+    int size = ScreenCapture::getCurrentPixels(&pixels, draw);
 
     debuglogstdio(LCF_DUMP, "Perform the screenshot");
     nutMuxer->writeVideoFrame(pixels, size);
@@ -0,0 +1,299 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "VideoConverter.h"
+
+#include "logging.h"
+#include "GlobalState.h"
+
+#include <thread>
+#include <algorithm>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace libtas {
+
+/* Maximum number of threads converting a frame */
+static const int MAX_THREADS = 8;
+
+/* Minimum number of chroma rows converted by a thread, so that small frames
+ * are not split into bands too small to be worth a thread */
+static const int MIN_BAND_ROWS = 32;
+
+bool VideoConverter::init(int width, int height, const char* pixfmt, int downscale)
+{
+    /* Find the position of each color component inside a pixel. We only
+     * support 32-bit formats with 8-bit components */
+    int ri = -1, gi = -1, bi = -1;
+    for (int k=0; k<4; k++) {
+        switch (pixfmt[k]) {
+            case 'R':
+                ri = k;
+                break;
+            case 'G':
+                gi = k;
+                break;
+            case 'B':
+                bi = k;
+                break;
+            case 'A':
+            case '0':
+                break;
+            default:
+                return false;
+        }
+    }
+
+    if ((ri < 0) || (gi < 0) || (bi < 0))
+        return false;
+
+    factor = (downscale > 1) ? downscale : 1;
+    inWidth = width;
+    inHeight = height;
+    outWidth = width / factor;
+    outHeight = height / factor;
+
+    if ((outWidth == 0) || (outHeight == 0))
+        return false;
+
+    /* BT.601 limited range coefficients, scaled by 256 */
+    for (int k=0; k<4; k++) {
+        coeffY[k] = coeffU[k] = coeffV[k] = 0;
+    }
+    coeffY[ri] = 66;   coeffY[gi] = 129; coeffY[bi] = 25;
+    coeffU[ri] = -38;  coeffU[gi] = -74; coeffU[bi] = 112;
+    coeffV[ri] = 112;  coeffV[gi] = -94; coeffV[bi] = -18;
+
+    frame.resize(getSize());
+
+    scaledRows.clear();
+    if (factor > 1)
+        scaledRows.resize(MAX_THREADS, std::vector<uint8_t>(2 * 4 * outWidth));
+
+    debuglogstdio(LCF_DUMP, "Converting %dx%d %.4s frames to %dx%d YUV 4:2:0", width, height, pixfmt, outWidth, outHeight);
+    return true;
+}
+
+int VideoConverter::getSize()
+{
+    return outWidth * outHeight + 2 * ((outWidth + 1) / 2) * ((outHeight + 1) / 2);
+}
+
+const char* VideoConverter::getPixelFormat()
+{
+    return "I420";
+}
+
+const uint8_t* VideoConverter::convert(const uint8_t* pixels)
+{
+    int chromaRows = (outHeight + 1) / 2;
+
+    int bands = std::thread::hardware_concurrency();
+    bands = std::min(bands, MAX_THREADS);
+    bands = std::min(bands, chromaRows / MIN_BAND_ROWS);
+    if (bands < 1)
+        bands = 1;
+
+    /* Our threads must not be seen as game threads */
+    GlobalNative gn;
+
+    std::vector<std::thread> workers;
+    for (int b=1; b<bands; b++) {
+        workers.emplace_back(&VideoConverter::convertBand, this, pixels,
+            chromaRows * b / bands, chromaRows * (b+1) / bands, b);
+    }
+
+    convertBand(pixels, 0, chromaRows / bands, 0);
+
+    for (auto& worker : workers)
+        worker.join();
+
+    return frame.data();
+}
+
+void VideoConverter::convertBand(const uint8_t* pixels, int start, int end, int band)
+{
+    int chromaWidth = (outWidth + 1) / 2;
+    uint8_t* planeY = frame.data();
+    uint8_t* planeU = planeY + outWidth * outHeight;
+    uint8_t* planeV = planeU + chromaWidth * ((outHeight + 1) / 2);
+
+    for (int cy=start; cy<end; cy++) {
+        int y = 2 * cy;
+        bool hasSecondRow = (y + 1) < outHeight;
+
+        const uint8_t* row0;
+        const uint8_t* row1;
+        if (factor == 1) {
+            row0 = pixels + 4 * y * inWidth;
+            row1 = hasSecondRow ? (row0 + 4 * inWidth) : row0;
+        }
+        else {
+            uint8_t* scaled = scaledRows[band].data();
+            downscaleRow(pixels, y, scaled);
+            row0 = scaled;
+            if (hasSecondRow) {
+                downscaleRow(pixels, y + 1, scaled + 4 * outWidth);
+                row1 = scaled + 4 * outWidth;
+            }
+            else {
+                row1 = row0;
+            }
+        }
+
+        convertRows(row0, row1, planeY + y * outWidth,
+            hasSecondRow ? (planeY + (y + 1) * outWidth) : nullptr,
+            planeU + cy * chromaWidth, planeV + cy * chromaWidth);
+    }
+}
+
+void VideoConverter::downscaleRow(const uint8_t* pixels, int y, uint8_t* out)
+{
+    int area = factor * factor;
+    for (int x=0; x<outWidth; x++) {
+        for (int k=0; k<4; k++) {
+            int sum = area / 2;
+            for (int dy=0; dy<factor; dy++) {
+                const uint8_t* in = pixels + 4 * ((y * factor + dy) * inWidth + x * factor) + k;
+                for (int dx=0; dx<factor; dx++) {
+                    sum += in[4 * dx];
+                }
+            }
+            out[4 * x + k] = sum / area;
+        }
+    }
+}
+
+#ifdef __SSE2__
+/* Add adjacent pairs of 32-bit integers of a and b */
+static inline __m128i addPairs(__m128i a, __m128i b)
+{
+    __m128 fa = _mm_castsi128_ps(a);
+    __m128 fb = _mm_castsi128_ps(b);
+    __m128i even = _mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i odd = _mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(3, 1, 3, 1)));
+    return _mm_add_epi32(even, odd);
+}
+
+/* Compute the luma of 8 pixels */
+static inline void lumaSSE2(const uint8_t* row, __m128i coeff, uint8_t* out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(128);
+    const __m128i offset = _mm_set1_epi32(16);
+
+    __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row));
+    __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + 16));
+
+    __m128i s0 = addPairs(_mm_madd_epi16(_mm_unpacklo_epi8(p0, zero), coeff),
+                          _mm_madd_epi16(_mm_unpackhi_epi8(p0, zero), coeff));
+    __m128i s1 = addPairs(_mm_madd_epi16(_mm_unpacklo_epi8(p1, zero), coeff),
+                          _mm_madd_epi16(_mm_unpackhi_epi8(p1, zero), coeff));
+
+    s0 = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(s0, round), 8), offset);
+    s1 = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(s1, round), 8), offset);
+
+    __m128i y16 = _mm_packs_epi32(s0, s1);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(y16, y16));
+}
+
+/* Sum the components of two horizontal pairs of pixels over two rows */
+static inline __m128i sumBlocksSSE2(__m128i p0, __m128i p1)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(p0, zero), _mm_unpacklo_epi8(p1, zero));
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(p0, zero), _mm_unpackhi_epi8(p1, zero));
+    lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+    hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+    return _mm_unpacklo_epi64(lo, hi);
+}
+
+/* Compute 4 chroma samples from 4 summed blocks of pixels */
+static inline void chromaSSE2(__m128i b0, __m128i b1, __m128i coeff, uint8_t* out)
+{
+    const __m128i round = _mm_set1_epi32(512);
+    const __m128i offset = _mm_set1_epi32(128);
+
+    __m128i s = addPairs(_mm_madd_epi16(b0, coeff), _mm_madd_epi16(b1, coeff));
+    s = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(s, round), 10), offset);
+
+    __m128i c16 = _mm_packs_epi32(s, s);
+    int c = _mm_cvtsi128_si32(_mm_packus_epi16(c16, c16));
+    memcpy(out, &c, 4);
+}
+#endif
+
+void VideoConverter::convertRows(const uint8_t* row0, const uint8_t* row1, uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v)
+{
+    int x = 0;
+
+#ifdef __SSE2__
+    const __m128i cy = _mm_setr_epi16(coeffY[0], coeffY[1], coeffY[2], coeffY[3], coeffY[0], coeffY[1], coeffY[2], coeffY[3]);
+    const __m128i cu = _mm_setr_epi16(coeffU[0], coeffU[1], coeffU[2], coeffU[3], coeffU[0], coeffU[1], coeffU[2], coeffU[3]);
+    const __m128i cv = _mm_setr_epi16(coeffV[0], coeffV[1], coeffV[2], coeffV[3], coeffV[0], coeffV[1], coeffV[2], coeffV[3]);
+
+    for (; x + 8 <= outWidth; x += 8) {
+        const uint8_t* p0 = row0 + 4 * x;
+        const uint8_t* p1 = row1 + 4 * x;
+
+        lumaSSE2(p0, cy, y0 + x);
+        if (y1)
+            lumaSSE2(p1, cy, y1 + x);
+
+        __m128i b0 = sumBlocksSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p0)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(p1)));
+        __m128i b1 = sumBlocksSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p0 + 16)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(p1 + 16)));
+
+        chromaSSE2(b0, b1, cu, u + x / 2);
+        chromaSSE2(b0, b1, cv, v + x / 2);
+    }
+#endif
+
+    for (; x < outWidth; x += 2) {
+        /* Duplicate the last column on odd widths */
+        int nx = (x + 1 < outWidth) ? (x + 1) : x;
+
+        int sy0 = 0, sy1 = 0, sy2 = 0, sy3 = 0, su = 0, sv = 0;
+        for (int k=0; k<4; k++) {
+            sy0 += coeffY[k] * row0[4 * x + k];
+            sy1 += coeffY[k] * row0[4 * nx + k];
+            sy2 += coeffY[k] * row1[4 * x + k];
+            sy3 += coeffY[k] * row1[4 * nx + k];
+            int block = row0[4 * x + k] + row0[4 * nx + k] + row1[4 * x + k] + row1[4 * nx + k];
+            su += coeffU[k] * block;
+            sv += coeffV[k] * block;
+        }
+
+        y0[x] = ((sy0 + 128) >> 8) + 16;
+        if (nx != x)
+            y0[nx] = ((sy1 + 128) >> 8) + 16;
+        if (y1) {
+            y1[x] = ((sy2 + 128) >> 8) + 16;
+            if (nx != x)
+                y1[nx] = ((sy3 + 128) >> 8) + 16;
+        }
+        u[x / 2] = ((su + 512) >> 10) + 128;
+        v[x / 2] = ((sv + 512) >> 10) + 128;
+    }
+}
+
+}
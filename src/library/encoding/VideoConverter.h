@@ -0,0 +1,85 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_VIDEOCONVERTER_H_INCL
+#define LIBTAS_VIDEOCONVERTER_H_INCL
+
+#include <vector>
+#include <cstdint>
+
+namespace libtas {
+
+/* Convert captured frames to planar YUV 4:2:0 (BT.601, limited range) with
+ * an optional box downscale, before sending them to ffmpeg. This divides the
+ * amount of data going through the pipe by about 2.7 and removes the
+ * colorspace conversion from the ffmpeg side. The frame is split into bands
+ * of rows which are converted in parallel.
+ */
+class VideoConverter {
+    public:
+        /* Setup the conversion of frames of the given dimensions and pixel
+         * format, dividing both dimensions by `downscale`.
+         * Returns false if the pixel format is not supported. */
+        bool init(int width, int height, const char* pixfmt, int downscale);
+
+        /* Dimensions of the converted frame */
+        int outWidth = 0;
+        int outHeight = 0;
+
+        /* Size of a converted frame in bytes */
+        int getSize();
+
+        /* NUT fourcc of the converted frame */
+        const char* getPixelFormat();
+
+        /* Convert a frame. The returned pointer is valid until the next call */
+        const uint8_t* convert(const uint8_t* pixels);
+
+    private:
+        int inWidth = 0;
+        int inHeight = 0;
+        int factor = 1;
+
+        /* Luma and chroma coefficients for each byte of a pixel, which
+         * depends on the order of color components */
+        int16_t coeffY[4];
+        int16_t coeffU[4];
+        int16_t coeffV[4];
+
+        /* Converted frame */
+        std::vector<uint8_t> frame;
+
+        /* Downscaled pair of rows for each band */
+        std::vector<std::vector<uint8_t>> scaledRows;
+
+        /* Convert chroma rows [start, end) using row buffer `band` */
+        void convertBand(const uint8_t* pixels, int start, int end, int band);
+
+        /* Average the pixels of an output row from the input frame */
+        void downscaleRow(const uint8_t* pixels, int y, uint8_t* out);
+
+        /* Convert two rows of pixels into two luma rows and one row of each
+         * chroma plane. `y1` is null when the second row is past the end
+         * of the frame, and `row1` is then equal to `row0` */
+        void convertRows(const uint8_t* row0, const uint8_t* row1, uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v);
+};
+
+}
+
+#endif
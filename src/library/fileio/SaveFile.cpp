@@ -27,12 +27,14 @@
 #include <cstring>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <errno.h>
 #include <vector>
 #include <unistd.h>
 #include <limits.h> //PATH_MAX
 #ifdef __linux__
 #include <sys/syscall.h>
+#include <sys/sendfile.h>
 #endif
 
 namespace libtas {
@@ -46,10 +48,6 @@ SaveFile::SaveFile(const char *file) {
     }
     filename = std::string(canonfile);
     free(canonfile);
-    removed = false;
-    closed = true;
-    stream = nullptr;
-    fd = 0;
 }
 
 SaveFile::~SaveFile() {
@@ -70,6 +68,8 @@ SaveFile::~SaveFile() {
         }
     }
 
+    unmap();
+
     if (stream) {
         NATIVECALL(fclose(stream));
     }
@@ -315,19 +315,20 @@ int SaveFile::open(int flags)
             struct stat filestat;
             int rv = stat(filename.c_str(), &filestat);
 
-            if (rv == 0) {
-                /* The file exists, copying the content to the stream */
-                FILE* f = fopen(filename.c_str(), "rb");
+            if ((rv == 0) && (filestat.st_size > 0)) {
+                /* The file exists, copying the content to the memfile inside
+                 * the kernel, without going through a user buffer */
+                int file_fd = ::open(filename.c_str(), O_RDONLY);
 
-                if (f != nullptr) {
-                    char tmp_buf[4096];
-                    size_t s;
-                    do {
-                        s = fread(tmp_buf, 1, 4096, f);
-                        write(fd, tmp_buf, s);
-                    } while(s != 0);
+                if (file_fd >= 0) {
+                    off_t offset = 0;
+                    while (offset < filestat.st_size) {
+                        ssize_t s = sendfile(fd, file_fd, &offset, filestat.st_size - offset);
+                        if (s <= 0)
+                            break;
+                    }
 
-                    fclose(f);
+                    ::close(file_fd);
                 }
             }
         }
@@ -362,6 +363,8 @@ int SaveFile::closeFile()
     if (!removed)
         return 0;
 
+    unmap();
+
     if (stream) {
         NATIVECALL(fclose(stream)); // closes both the stream and fd
         stream = nullptr;
@@ -388,6 +391,8 @@ int SaveFile::remove()
     if (!closed)
         return 0;
 
+    unmap();
+
     if (stream) {
         NATIVECALL(fclose(stream)); // closes both the stream and fd
         stream = nullptr;
@@ -401,4 +406,144 @@ int SaveFile::remove()
     return 0;
 }
 
+void SaveFile::sync()
+{
+#ifdef __linux__
+    if (fd == 0) {
+        unmap();
+        return;
+    }
+
+    struct stat filestat;
+    int rv;
+    NATIVECALL(rv = fstat(fd, &filestat));
+    if (rv != 0)
+        return;
+
+    size_t new_map_size = (static_cast<size_t>(filestat.st_size) + 4095) & ~static_cast<size_t>(4095);
+
+    bool modified = sync_racy ||
+        (filestat.st_size != sync_size) ||
+        (filestat.st_mtim.tv_sec != sync_mtime.tv_sec) ||
+        (filestat.st_mtim.tv_nsec != sync_mtime.tv_nsec);
+
+    if (modified || (new_map_size != map_size)) {
+        /* We don't track which pages the game wrote into using write(), so
+         * we map the file again. A new mapping is entirely flagged as
+         * soft-dirty, so all pages of this file will be saved. */
+        if (map_addr && (new_map_size != map_size)) {
+            unmap();
+        }
+
+        if (new_map_size > 0) {
+            void* addr;
+            if (map_addr) {
+                /* Keep the same address, so that the mapping is not moved
+                 * between savestates */
+                addr = mmap(map_addr, new_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+            }
+            else {
+                addr = mmap(nullptr, new_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            }
+
+            if (addr == MAP_FAILED) {
+                debuglogstdio(LCF_FILEIO | LCF_ERROR, "Could not map savefile %s", filename.c_str());
+                map_addr = nullptr;
+                map_size = 0;
+            }
+            else {
+                map_addr = addr;
+                map_size = new_map_size;
+            }
+        }
+    }
+
+    storeSync(filestat);
+#endif
+}
+
+void SaveFile::refreshSync()
+{
+#ifdef __linux__
+    if (fd == 0)
+        return;
+
+    struct stat filestat;
+    int rv;
+    NATIVECALL(rv = fstat(fd, &filestat));
+    if (rv != 0)
+        return;
+
+    storeSync(filestat);
+#endif
+}
+
+bool SaveFile::restoreMap(void* addr, off_t size)
+{
+#ifdef __linux__
+    size_t new_map_size = (static_cast<size_t>(size) + 4095) & ~static_cast<size_t>(4095);
+
+    /* If the file is already mapped identically, keep the mapping so that
+     * only the soft-dirty pages are loaded. Otherwise, remove the current
+     * mapping before resizing the file, so that no page of a larger mapping
+     * is left past the end of the file. */
+    if ((map_addr != addr) || (map_size != new_map_size)) {
+        unmap();
+    }
+
+    struct stat filestat;
+    int rv;
+    NATIVECALL(rv = fstat(fd, &filestat));
+    if (rv != 0)
+        return false;
+
+    if (filestat.st_size != size) {
+        NATIVECALL(rv = ftruncate(fd, size));
+        if (rv != 0)
+            return false;
+    }
+
+    if (map_addr || (new_map_size == 0))
+        return true;
+
+    debuglogstdio(LCF_FILEIO | LCF_CHECKPOINT, "Mapping savefile %s at %p with size %zu", filename.c_str(), addr, new_map_size);
+    void* new_addr = mmap(addr, new_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    if (new_addr == MAP_FAILED) {
+        debuglogstdio(LCF_FILEIO | LCF_CHECKPOINT | LCF_ERROR, "Mapping savefile %s failed: errno %d", filename.c_str(), errno);
+        return false;
+    }
+
+    map_addr = new_addr;
+    map_size = new_map_size;
+#endif
+    return true;
+}
+
+void SaveFile::storeSync(const struct stat& filestat)
+{
+#ifdef __linux__
+    sync_size = filestat.st_size;
+    sync_mtime = filestat.st_mtim;
+
+    /* Same as git "racily clean" entries: if the file was modified during the
+     * current coarse clock tick, a following write may not update its
+     * modification time, so we must consider the file as modified on the
+     * next sync. */
+    struct timespec now;
+    NATIVECALL(clock_gettime(CLOCK_REALTIME_COARSE, &now));
+    sync_racy = (sync_mtime.tv_sec > now.tv_sec) ||
+        ((sync_mtime.tv_sec == now.tv_sec) && (sync_mtime.tv_nsec >= now.tv_nsec));
+#endif
+}
+
+void SaveFile::unmap()
+{
+    if (map_addr) {
+        munmap(map_addr, map_size);
+        map_addr = nullptr;
+        map_size = 0;
+    }
+    sync_size = -1;
+}
+
 }
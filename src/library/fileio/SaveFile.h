@@ -22,6 +22,8 @@
 
 #include <string>
 #include <cstdio> // FILE
+#include <sys/stat.h> // struct stat
+#include <time.h> // struct timespec
 
 namespace libtas {
 
@@ -33,13 +35,27 @@ public:
 
     std::string filename;
 
-    FILE* stream;
+    FILE* stream = nullptr;
 
-    int fd;
+    int fd = 0;
 
     bool removed = false;
     bool closed = true;
 
+    /* Shared memory mapping of the savefile content. Savefiles are mapped in
+     * the game address space, so that their content is saved and restored by
+     * the checkpoint code as any other memory area. */
+    void* map_addr = nullptr;
+    size_t map_size = 0;
+
+    /* Size and modification time of the file when it was last synced with
+     * the checkpoint code */
+    off_t sync_size = -1;
+    struct timespec sync_mtime = {0, 0};
+
+    /* The file was modified during the same clock tick as the last sync, so
+     * a later modification may not have changed its modification time */
+    bool sync_racy = false;
 
     /* Remove duplicate /, /./ and /../ from a path */
     static char* canonicalizeFile(const char *file);
@@ -59,6 +75,26 @@ public:
     /* Remove a savefile and return 0 for success and -1 for error (+ errno set) */
     int remove();
 
+    /* Map the savefile content in memory. If the file was modified since the
+     * last sync, remap it so that all its pages are flagged as soft-dirty and
+     * are saved in the next incremental savestate. */
+    void sync();
+
+    /* Register the current file size and modification time without flagging
+     * pages as dirty, after its content was restored from a savestate. */
+    void refreshSync();
+
+    /* Restore the file size and the content mapping stored in a savestate,
+     * before the memory areas are restored. Returns false on failure. */
+    bool restoreMap(void* addr, off_t size);
+
+private:
+    /* Unmap the savefile content */
+    void unmap();
+
+    /* Store the file size and modification time */
+    void storeSync(const struct stat& filestat);
+
 };
 
 }
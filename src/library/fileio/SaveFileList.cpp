@@ -28,11 +28,12 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include <forward_list>
+#include <unordered_map>
+#include <unordered_set>
 #include <memory>
-#include <mutex>
 #include <cstring>
 #include <unistd.h>
-#include <algorithm> // remove_if
+#include <pthread.h> // pthread_rwlock_t
 
 namespace libtas {
 
@@ -43,58 +44,86 @@ static std::forward_list<std::unique_ptr<SaveFile>>& getSaveFileList() {
     return savefiles;
 }
 
-/* Mutex to protect the savefile list */
-static std::mutex& getSaveFileListMutex() {
-    static std::mutex mutex;
-    return mutex;
+/* Index of the savefile list, keyed by canonicalized path, so that
+ * looking for a savefile only needs one path canonicalization and one hash
+ * lookup instead of one canonicalization per registered savefile. */
+static std::unordered_map<std::string, SaveFile*>& getSaveFileIndex() {
+    static std::unordered_map<std::string, SaveFile*> index;
+    return index;
 }
 
-/* Check if the file open permission allows for write operation */
-bool isSaveFile(const char *file, const char *modes)
-{
-    std::lock_guard<std::mutex> lock(getSaveFileListMutex());
+/* Cache of canonicalized paths that were checked and are not savefiles
+ * (device files, shared memory, etc.), to avoid calling stat() each time the
+ * game opens them in write mode. Games opening many different such paths
+ * would make it grow forever, so it is cleared when full. */
+static std::unordered_set<std::string>& getNotSaveFileCache() {
+    static std::unordered_set<std::string> cache;
+    return cache;
+}
 
-    const auto& savefiles = getSaveFileList();
-    for (const auto& savefile : savefiles) {
-        if (savefile->isSameFile(file)) {
-            return true;
-        }
-    }
+static const size_t NOT_SAVEFILE_CACHE_SIZE = 1024;
 
-    if (!(strstr(modes, "w") || strstr(modes, "a") || strstr(modes, "+")))
-        return false;
+/* Lock to protect the savefile list, its index and the stat cache. Lookups
+ * are far more frequent than insertions, so we use a read-write lock so that
+ * threads loading assets concurrently don't serialize on it. */
+static pthread_rwlock_t savefileLock = PTHREAD_RWLOCK_INITIALIZER;
 
-    return isSaveFile(file);
+class ReadLock {
+public:
+    ReadLock() {pthread_rwlock_rdlock(&savefileLock);}
+    ~ReadLock() {pthread_rwlock_unlock(&savefileLock);}
+};
+
+class WriteLock {
+public:
+    WriteLock() {pthread_rwlock_wrlock(&savefileLock);}
+    ~WriteLock() {pthread_rwlock_unlock(&savefileLock);}
+};
+
+/* Returns the canonicalized path of a file, or an empty string on error */
+static std::string canonicalPath(const char *file)
+{
+    char* canonfile = SaveFile::canonicalizeFile(file);
+    if (!canonfile)
+        return std::string();
+
+    std::string canonstr(canonfile);
+    free(canonfile);
+    return canonstr;
 }
 
-bool isSaveFile(const char *file, int oflag)
+/* Look for a registered savefile. Lock must be held */
+static SaveFile* findSaveFile(const std::string& canonfile)
 {
-    std::lock_guard<std::mutex> lock(getSaveFileListMutex());
+    if (canonfile.empty())
+        return nullptr;
 
-    const auto& savefiles = getSaveFileList();
-    for (const auto& savefile : savefiles) {
-        if (savefile->isSameFile(file)) {
-            return true;
-        }
-    }
+    const auto& index = getSaveFileIndex();
+    auto it = index.find(canonfile);
+    if (it == index.end())
+        return nullptr;
 
-    if ((oflag & 0x3) == O_RDONLY)
-        return false;
+    return it->second;
+}
 
-    /*
-     * This is a sort of hack to prevent considering new shared
-     * memory files as a savefile, which are opened using O_CLOEXEC
-     *
-     * Remove this because ruffle opens savefiles with O_CLOEXEC.
-     */
-    // if (oflag & O_CLOEXEC)
-    //     return false;
+/* Register a new savefile in both the list and the index. Write lock must be held */
+static SaveFile* addSaveFile(const char *file)
+{
+    auto& savefiles = getSaveFileList();
+    savefiles.emplace_front(new SaveFile(file));
+    SaveFile* savefile = savefiles.front().get();
 
-    return isSaveFile(file);
+    if (!savefile->filename.empty()) {
+        getSaveFileIndex()[savefile->filename] = savefile;
+        getNotSaveFileCache().erase(savefile->filename);
+    }
+
+    return savefile;
 }
 
-/* Detect save files (excluding the writeable flag), basically if the file is regular */
-bool isSaveFile(const char *file)
+/* Detect save files from its canonicalized path (excluding the writeable flag),
+ * basically if the file is regular. Lock must not be held */
+static bool isSaveFileCanon(const char *file, const std::string& canonfile)
 {
     if (!Global::shared_config.prevent_savefiles)
         return false;
@@ -102,6 +131,13 @@ bool isSaveFile(const char *file)
     if (!file)
         return false;
 
+    if (!canonfile.empty()) {
+        ReadLock lock;
+        const auto& cache = getNotSaveFileCache();
+        if (cache.find(canonfile) != cache.end())
+            return false;
+    }
+
     /* Check if file is a dev file */
     GlobalNative gn;
     struct stat filestat;
@@ -120,53 +156,124 @@ bool isSaveFile(const char *file)
         return false;
     }
 
+    bool is_savefile = true;
+
     /* Check if the file is a regular file */
     if (! S_ISREG(filestat.st_mode))
-        return false;
+        is_savefile = false;
 
     /* Check if the file is a message queue, semaphore or shared memory object */
-    if (S_TYPEISMQ(&filestat) || S_TYPEISSEM(&filestat) || S_TYPEISSHM(&filestat))
-        return false;
+    else if (S_TYPEISMQ(&filestat) || S_TYPEISSEM(&filestat) || S_TYPEISSHM(&filestat))
+        is_savefile = false;
 
     /* Check if the file lies in shared memory */
-    if (strstr(file, "/dev/shm"))
-        return false;
+    else if (strstr(file, "/dev/shm"))
+        is_savefile = false;
 
     /* We don't need to keep mesa shader cache files */
-    if (strstr(file, "/.cache/mesa_shader_cache/"))
-        return false;
+    else if (strstr(file, "/.cache/mesa_shader_cache/"))
+        is_savefile = false;
+
+    /* Only cache negative results, positive results will be registered
+     * in the savefile list when the game opens the file */
+    if (!is_savefile && !canonfile.empty()) {
+        WriteLock lock;
+        auto& cache = getNotSaveFileCache();
+        if (cache.size() >= NOT_SAVEFILE_CACHE_SIZE)
+            cache.clear();
+        cache.insert(canonfile);
+    }
 
-    return true;
+    return is_savefile;
 }
 
-FILE *openSaveFile(const char *file, const char *modes)
+/* Check if the file open permission allows for write operation */
+bool isSaveFile(const char *file, const char *modes)
 {
-    std::lock_guard<std::mutex> lock(getSaveFileListMutex());
+    std::string canonfile;
+    {
+        ReadLock lock;
+        /* Skip the path canonicalization when there is no savefile yet */
+        if (!getSaveFileIndex().empty()) {
+            canonfile = canonicalPath(file);
+            if (findSaveFile(canonfile))
+                return true;
+        }
+    }
 
-    auto& savefiles = getSaveFileList();
-    for (const auto& savefile : savefiles) {
-        if (savefile->isSameFile(file)) {
-            return savefile->open(modes);
+    if (!(strstr(modes, "w") || strstr(modes, "a") || strstr(modes, "+")))
+        return false;
+
+    if (canonfile.empty())
+        canonfile = canonicalPath(file);
+
+    return isSaveFileCanon(file, canonfile);
+}
+
+bool isSaveFile(const char *file, int oflag)
+{
+    std::string canonfile;
+    {
+        ReadLock lock;
+        /* Skip the path canonicalization when there is no savefile yet */
+        if (!getSaveFileIndex().empty()) {
+            canonfile = canonicalPath(file);
+            if (findSaveFile(canonfile))
+                return true;
         }
     }
 
-    savefiles.emplace_front(new SaveFile(file));
-    return savefiles.front()->open(modes);
+    if ((oflag & 0x3) == O_RDONLY)
+        return false;
+
+    /*
+     * This is a sort of hack to prevent considering new shared
+     * memory files as a savefile, which are opened using O_CLOEXEC
+     *
+     * Remove this because ruffle opens savefiles with O_CLOEXEC.
+     */
+    // if (oflag & O_CLOEXEC)
+    //     return false;
+
+    if (canonfile.empty())
+        canonfile = canonicalPath(file);
+
+    return isSaveFileCanon(file, canonfile);
+}
+
+/* Detect save files (excluding the writeable flag), basically if the file is regular */
+bool isSaveFile(const char *file)
+{
+    if (!Global::shared_config.prevent_savefiles)
+        return false;
+
+    return isSaveFileCanon(file, canonicalPath(file));
+}
+
+FILE *openSaveFile(const char *file, const char *modes)
+{
+    std::string canonfile = canonicalPath(file);
+
+    WriteLock lock;
+
+    SaveFile* savefile = findSaveFile(canonfile);
+    if (savefile)
+        return savefile->open(modes);
+
+    return addSaveFile(file)->open(modes);
 }
 
 int openSaveFile(const char *file, int oflag)
 {
-    std::lock_guard<std::mutex> lock(getSaveFileListMutex());
+    std::string canonfile = canonicalPath(file);
 
-    auto& savefiles = getSaveFileList();
-    for (const auto& savefile : savefiles) {
-        if (savefile->isSameFile(file)) {
-            return savefile->open(oflag);
-        }
-    }
+    WriteLock lock;
 
-    savefiles.emplace_front(new SaveFile(file));
-    return savefiles.front()->open(oflag);
+    SaveFile* savefile = findSaveFile(canonfile);
+    if (savefile)
+        return savefile->open(oflag);
+
+    return addSaveFile(file)->open(oflag);
 }
 
 int closeSaveFile(int fd)
@@ -180,7 +287,7 @@ int closeSaveFile(int fd)
     if (Global::is_exiting)
         return 0;
 
-    std::lock_guard<std::mutex> lock(getSaveFileListMutex());
+    WriteLock lock;
 
     auto& savefiles = getSaveFileList();
     for (const auto& savefile : savefiles) {
@@ -197,7 +304,7 @@ int closeSaveFile(FILE *stream)
     if (Global::is_exiting)
         return 0;    
 
-    std::lock_guard<std::mutex> lock(getSaveFileListMutex());
+    WriteLock lock;
 
     auto& savefiles = getSaveFileList();
     for (const auto& savefile : savefiles) {
@@ -211,19 +318,17 @@ int closeSaveFile(FILE *stream)
 
 int removeSaveFile(const char *file)
 {
-    std::lock_guard<std::mutex> lock(getSaveFileListMutex());
+    std::string canonfile = canonicalPath(file);
 
-    auto& savefiles = getSaveFileList();
-    for (const auto& savefile : savefiles) {
-        if (savefile->isSameFile(file)) {
-            return savefile->remove();
-        }
-    }
+    WriteLock lock;
+
+    SaveFile* savefile = findSaveFile(canonfile);
+    if (savefile)
+        return savefile->remove();
 
     /* If the file is not registered, create a removed savefile */
     if (Global::shared_config.prevent_savefiles) {
-        savefiles.emplace_front(new SaveFile(file));
-        savefiles.front()->remove();
+        addSaveFile(file)->remove();
 
         GlobalNative gn;
         return access(file, W_OK);
@@ -234,30 +339,48 @@ int removeSaveFile(const char *file)
 
 int renameSaveFile(const char *oldfile, const char *newfile)
 {
-    std::lock_guard<std::mutex> lock(getSaveFileListMutex());
-
-    char* canonnewfile = SaveFile::canonicalizeFile(newfile);
-    if (!canonnewfile)
+    std::string newfilestr = canonicalPath(newfile);
+    if (newfilestr.empty())
         return -1;
-    std::string newfilestr(canonnewfile);
-    free(canonnewfile);
 
-    /* Remove the newfile if present */
-    auto& savefiles = getSaveFileList();
-    savefiles.remove_if([newfile](const std::unique_ptr<SaveFile>& s) { return (s->isSameFile(newfile));});
+    std::string oldfilestr = canonicalPath(oldfile);
 
-    for (const auto& savefile : savefiles) {
-        if (savefile->isSameFile(oldfile)) {
+    {
+        WriteLock lock;
+
+        auto& savefiles = getSaveFileList();
+        auto& index = getSaveFileIndex();
+
+        /* The renamed path may not be a savefile anymore */
+        getNotSaveFileCache().erase(oldfilestr);
+        getNotSaveFileCache().erase(newfilestr);
+
+        /* Remove the newfile if present */
+        SaveFile* newsavefile = findSaveFile(newfilestr);
+        if (newsavefile) {
+            index.erase(newfilestr);
+            savefiles.remove_if([newsavefile](const std::unique_ptr<SaveFile>& s) { return (s.get() == newsavefile);});
+        }
+
+        SaveFile* savefile = findSaveFile(oldfilestr);
+        if (savefile) {
+            index.erase(oldfilestr);
             savefile->filename = newfilestr;
+            index[newfilestr] = savefile;
             return 0;
         }
     }
 
     /* If the file is not registered, create a savefile */
-    if (isSaveFile(newfile)) {
-        savefiles.emplace_front(new SaveFile(oldfile));
-        savefiles.front()->open("rb");
-        savefiles.front()->filename = newfilestr;
+    if (isSaveFileCanon(newfile, newfilestr)) {
+        WriteLock lock;
+
+        SaveFile* savefile = addSaveFile(oldfile);
+        savefile->open("rb");
+
+        getSaveFileIndex().erase(savefile->filename);
+        savefile->filename = newfilestr;
+        getSaveFileIndex()[newfilestr] = savefile;
 
         GlobalNative gn;
         return access(oldfile, W_OK);
@@ -268,35 +391,35 @@ int renameSaveFile(const char *oldfile, const char *newfile)
 
 int getSaveFileFd(const char *file)
 {
-    std::lock_guard<std::mutex> lock(getSaveFileListMutex());
+    ReadLock lock;
 
-    auto& savefiles = getSaveFileList();
-    for (const auto& savefile : savefiles) {
-        if (savefile->isSameFile(file)) {
-            return savefile->fd;
-        }
-    }
+    if (getSaveFileIndex().empty())
+        return 0;
+
+    std::string canonfile = canonicalPath(file);
+    SaveFile* savefile = findSaveFile(canonfile);
+    if (savefile)
+        return savefile->fd;
 
     return 0;
 }
 
 bool isSaveFileRemoved(const char *file)
 {
-    std::lock_guard<std::mutex> lock(getSaveFileListMutex());
+    std::string canonfile = canonicalPath(file);
 
-    auto& savefiles = getSaveFileList();
-    for (const auto& savefile : savefiles) {
-        if (savefile->isSameFile(file)) {
-            return savefile->removed;
-        }
-    }
+    ReadLock lock;
+
+    SaveFile* savefile = findSaveFile(canonfile);
+    if (savefile)
+        return savefile->removed;
 
     return true;
 }
 
 std::string getSaveFileInsideDir(std::string dir, int n)
 {
-    std::lock_guard<std::mutex> lock(getSaveFileListMutex());
+    ReadLock lock;
 
     auto& savefiles = getSaveFileList();
     
@@ -321,6 +444,69 @@ std::string getSaveFileInsideDir(std::string dir, int n)
     return "";
 }
 
+void syncAllFiles()
+{
+    WriteLock lock;
+
+    for (const auto& savefile : getSaveFileList()) {
+        savefile->sync();
+    }
+}
+
+void refreshAllFiles()
+{
+    WriteLock lock;
+
+    for (const auto& savefile : getSaveFileList()) {
+        savefile->refreshSync();
+    }
+}
+
+int getMappedFiles(int* fds, ino_t* inodes, void** addrs, off_t* sizes, int max)
+{
+    int n = 0;
+    for (const auto& savefile : getSaveFileList()) {
+        if (!savefile->map_addr)
+            continue;
+
+        if (n >= max) {
+            debuglogstdio(LCF_FILEIO | LCF_CHECKPOINT | LCF_ERROR, "Too many savefiles to store in savestate");
+            break;
+        }
+
+        struct stat filestat;
+        int rv;
+        NATIVECALL(rv = fstat(savefile->fd, &filestat));
+        if (rv != 0)
+            continue;
+
+        fds[n] = savefile->fd;
+        inodes[n] = filestat.st_ino;
+        addrs[n] = savefile->map_addr;
+        sizes[n] = filestat.st_size;
+        n++;
+    }
+    return n;
+}
+
+bool restoreMappedFile(int fd, ino_t inode, void* addr, off_t size)
+{
+    for (const auto& savefile : getSaveFileList()) {
+        if (savefile->fd != fd)
+            continue;
+
+        /* Check that the file descriptor still refers to the same file */
+        struct stat filestat;
+        int rv;
+        NATIVECALL(rv = fstat(fd, &filestat));
+        if ((rv != 0) || (filestat.st_ino != inode))
+            return false;
+
+        return savefile->restoreMap(addr, size);
+    }
+    return false;
+}
+
 }
 
 }
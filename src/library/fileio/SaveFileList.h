@@ -22,6 +22,7 @@
 
 #include <cstdio> // FILE
 #include <string>
+#include <sys/types.h> // off_t, ino_t
 
 namespace libtas {
 
@@ -64,6 +65,24 @@ bool isSaveFileRemoved(const char *file);
 /* Get the n-th save file inside directory `dir`. Returns empty string if not present */
 std::string getSaveFileInsideDir(std::string dir, int n);
 
+/* Map the content of all savefiles in memory so that they are stored in
+ * savestates, and flag the modified ones as dirty. Must be called after
+ * all threads are suspended. */
+void syncAllFiles();
+
+/* Register the current state of all savefiles after a savestate was loaded */
+void refreshAllFiles();
+
+/* Fill the file descriptor, inode, mapping address and file size of each
+ * mapped savefile, and returns the number of savefiles. This is called from
+ * the checkpoint code, so it does not lock nor allocate memory. */
+int getMappedFiles(int* fds, ino_t* inodes, void** addrs, off_t* sizes, int max);
+
+/* Restore the size and mapping of the savefile with the given file descriptor
+ * and inode, as stored in a savestate. Returns false if the savefile could
+ * not be restored. Does not lock nor allocate memory. */
+bool restoreMappedFile(int fd, ino_t inode, void* addr, off_t size);
+
 }
 
 }
@@ -34,6 +34,7 @@
 #include "screencapture/ScreenCapture.h"
 #include "WindowTitle.h"
 #include "BusyLoopDetection.h"
+#include "StateHash.h"
 #include "FPSMonitor.h"
 #include "hook.h"
 #include "GameHacks.h"
@@ -135,11 +136,8 @@ static bool skipDraw(float fps)
 
 static void sendFrameCountTime()
 {
-    /* Detect an error on the first send, and exit the game if so */
-    int ret = sendMessage(MSGB_FRAMECOUNT_TIME);
-    if (ret == -1)
-        exit(1);
-        
+    /* Send errors are detected when flushing the frame boundary batch */
+    sendMessage(MSGB_FRAMECOUNT_TIME);
     sendData(&framecount, sizeof(uint64_t));
     struct timespec ticks = DeterministicTimer::get().getTicks(SharedConfig::TIMETYPE_UNTRACKED_MONOTONIC);
     uint64_t ticks_val = ticks.tv_sec;
@@ -241,9 +239,33 @@ void frameBoundary(std::function<void()> draw, RenderHUD& hud)
     /* Other threads may send socket messages, so we lock the socket */
     lockSocket();
 
+    unsigned int socket_syscalls = fetchSocketSyscallCount();
+    debuglogstdio(LCF_SOCKET, "Socket syscalls during the last frame: %u", socket_syscalls);
+    perfTimer.addCalls(PerfCounters::SOCKET_SYSCALLS, socket_syscalls);
+
+    /* Publish the performance counters before the program reads them */
+    perfTimer.endFrame(framecount);
+
+    /* All messages until the frame boundary are sent in a single write */
+    beginMessageBatch();
+
     /* Send framecount and internal time */    
     sendFrameCountTime();
 
+    /* Send the hash of the selected memory ranges, for desync detection */
+    if (StateHash::isEnabled()) {
+        uint64_t hash = StateHash::compute();
+        sendMessage(MSGB_STATE_HASH);
+        sendData(&hash, sizeof(uint64_t));
+    }
+
+    /* Send the fingerprint of the audio mixed during the frame */
+    if (Global::shared_config.fastforward_mode & SharedConfig::FF_AUDIO_FINGERPRINT) {
+        uint64_t hash = AudioContext::get().takeFingerprint();
+        sendMessage(MSGB_AUDIO_HASH);
+        sendData(&hash, sizeof(uint64_t));
+    }
+
     /* Send GameInfo struct if needed */
     if (Global::game_info.tosend) {
         sendMessage(MSGB_GAMEINFO);
@@ -271,9 +293,13 @@ void frameBoundary(std::function<void()> draw, RenderHUD& hud)
     /* Last message to send */
     sendMessage(MSGB_START_FRAMEBOUNDARY);
 
-    /* Reset ramwatches and lua drawings */
+    /* Detect an error when sending, and exit the game if so */
+    if (flushMessageBatch() == -1)
+        exit(1);
+
+    /* Reset ramwatches. Lua drawings are kept until the program sends
+     * changes */
     WatchesWindow::reset();
-    LuaDraw::reset();
 
     /* Receive messages from the program */
     perfTimer.switchTimer(PerfTimer::WaitTimer);                
@@ -297,74 +323,10 @@ void frameBoundary(std::function<void()> draw, RenderHUD& hud)
             sendData(&h, sizeof(int));
             break;
         }
-        case MSGN_LUA_TEXT:
-        {
-            int x, y;
-            uint32_t color;
-            float anchor_x, anchor_y;
-            float font_size;
-            bool monospace;
-            
-            receiveData(&x, sizeof(int));
-            receiveData(&y, sizeof(int));
-            std::string text = receiveString();
-            receiveData(&color, sizeof(uint32_t));
-            receiveData(&anchor_x, sizeof(float));
-            receiveData(&anchor_y, sizeof(float));
-            receiveData(&font_size, sizeof(float));
-            receiveData(&monospace, sizeof(bool));
-            LuaDraw::insertText(x, y, text, color, anchor_x, anchor_y, font_size, monospace);
-            break;
-        }
-        case MSGN_LUA_PIXEL:
-        {
-            int x, y;
-            receiveData(&x, sizeof(int));
-            receiveData(&y, sizeof(int));
-            uint32_t color;
-            receiveData(&color, sizeof(uint32_t));
-            LuaDraw::insertPixel(x, y, color);
-            break;
-        }
-        case MSGN_LUA_RECT:
-        {
-            int x, y, w, h, thickness, filled;
-            receiveData(&x, sizeof(int));
-            receiveData(&y, sizeof(int));
-            receiveData(&w, sizeof(int));
-            receiveData(&h, sizeof(int));
-            receiveData(&thickness, sizeof(int));
-            uint32_t color;
-            receiveData(&color, sizeof(uint32_t));
-            receiveData(&filled, sizeof(int));
-            LuaDraw::insertRect(x, y, w, h, thickness, color, filled);
-            break;
-        }
-        case MSGN_LUA_LINE:
-        {
-            int x0, y0, x1, y1;
-            receiveData(&x0, sizeof(int));
-            receiveData(&y0, sizeof(int));
-            receiveData(&x1, sizeof(int));
-            receiveData(&y1, sizeof(int));
-            uint32_t color;
-            receiveData(&color, sizeof(uint32_t));
-            LuaDraw::insertLine(x0, y0, x1, y1, color);
-            break;
-        }
-        case MSGN_LUA_ELLIPSE:
-        {
-            int center_x, center_y, radius_x, radius_y;
-            receiveData(&center_x, sizeof(int));
-            receiveData(&center_y, sizeof(int));
-            receiveData(&radius_x, sizeof(int));
-            receiveData(&radius_y, sizeof(int));
-            uint32_t color;
-            receiveData(&color, sizeof(uint32_t));
-            LuaDraw::insertEllipse(center_x, center_y, radius_x, radius_y, color);
+        case MSGN_LUA_DRAW_LIST:
+            LuaDraw::receive();
             break;
         }
-        }
         message = receiveMessage();
     }
     perfTimer.switchTimer(PerfTimer::FrameTimer);
@@ -740,6 +702,10 @@ static void receive_messages(std::function<void()> draw, RenderHUD& hud)
                 Checkpoint::setSavestateIndex(slot);
                 break;
 
+            case MSGN_FREE_SAVESTATE:
+                Checkpoint::freeSavestate();
+                break;
+
             case MSGN_SAVESTATE:
                 {
                     std::string saving_msg = "Saving state ";
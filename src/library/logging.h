@@ -21,7 +21,7 @@
 #define LIBTAS_LOGGING_H_INCL
 
 #include "../shared/lcf.h"
-//#include "PerfTimer.h"
+#include "PerfTimer.h"
 
 #include <string>
 #include <iostream>
@@ -41,8 +41,12 @@ void debuglogfull(LogCategoryFlag lcf, const char* file, int line, ...);
     debuglogfull(lcf, __FILE__, __LINE__, __VA_ARGS__);\
     } while (0)
 
-/* If we only want to print the function name... */
-#define DEBUGLOGCALL(lcf) debuglogstdio(lcf, "%s call.", __func__)
+/* If we only want to print the function name... This is used by hooked
+ * functions, so we also count the calls for performance counters. */
+#define DEBUGLOGCALL(lcf) do {\
+    perfTimer.countHookCall();\
+    debuglogstdio(lcf, "%s call.", __func__);\
+    } while (0)
 
 /* Macro of an assert */
 #define MYASSERT(term) if ((term)) {} \
@@ -25,6 +25,7 @@
 #include "frame.h" // framecount
 #include "Stack.h"
 #include "GlobalState.h"
+#include "StateHash.h"
 #include "audio/AudioContext.h"
 #include "encoding/AVEncoder.h"
 #include "steam/isteamuser.h" // SteamSetUserDataFolder
@@ -36,6 +37,8 @@
 #include "checkpoint/SaveStateManager.h"
 #include "checkpoint/Checkpoint.h"
 #include "sdl/sdldynapi.h"
+#include "renderhud/LogWindow.h"
+#include "renderhud/LuaDraw.h"
 #include "../shared/sockethelpers.h"
 #include "../shared/messages.h"
 #include "../shared/SharedConfig.h"
@@ -85,6 +88,8 @@ void __attribute__((constructor)) init(void)
 
     ThreadManager::init();
     SaveStateManager::init();
+    LogWindow::init();
+    LuaDraw::init();
     Stack::grow();
 
     initSocketGame();
@@ -174,6 +179,13 @@ void __attribute__((constructor)) init(void)
                 setDynapiAddr(addr);
                 break;
             }
+            case MSGN_STATE_HASH_RANGE: {
+                uint64_t addr, size;
+                receiveData(&addr, sizeof(uint64_t));
+                receiveData(&size, sizeof(uint64_t));
+                StateHash::addRange(static_cast<uintptr_t>(addr), static_cast<size_t>(size));
+                break;
+            }
             default:
                 debuglogstdio(LCF_ERROR | LCF_SOCKET, "Unknown socket message %d", message);
                 exit(1);
@@ -22,30 +22,96 @@
 #include "../external/imgui/imgui.h"
 
 #include <mutex>
+#include <cstring>
+#include <stdint.h>
+#include <sys/mman.h>
+
+/* Maximum number of lines kept, older lines are dropped */
+#define LOG_LINES 4096
+/* Maximum length of a line, longer lines are truncated */
+#define LOG_LINE_SIZE 256
 
 namespace libtas {
 
-static ImGuiTextBuffer buffer;
+/* Storage for the log lines, as a ring of fixed-size lines. It is allocated
+ * in its own mapping which is skipped by savestates, so that its size does
+ * not depend on the session length, and logs are not rolled back on state
+ * loading. */
+struct LogStorage {
+    int head; // index of the oldest line
+    int count; // number of complete lines
+    uint16_t lengths[LOG_LINES];
+    char lines[LOG_LINES][LOG_LINE_SIZE];
+};
+
+static LogStorage* storage = nullptr;
 static ImGuiTextFilter filter;
-static ImVector<int> lineOffsets; // Index to lines offset. We maintain this with AddLog() calls.
+static ImVector<int> filteredLines; // Lines passing the filter, rebuilt when drawing
 static bool autoScroll;  // Keep scrolling if already at the bottom.
 static std::mutex mutex;
 
+void LogWindow::init()
+{
+    if (storage)
+        return;
+
+    /* Use a shared mapping, so that it is not merged with adjacent areas */
+    void* addr = mmap(nullptr, sizeof(LogStorage), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED)
+        return;
+
+    storage = static_cast<LogStorage*>(addr);
+    clear();
+}
+
+bool LogWindow::isLogArea(const void* addr, size_t size)
+{
+    return storage && (addr == storage) && (size >= sizeof(LogStorage));
+}
+
 void LogWindow::clear()
 {
-    buffer.clear();
-    lineOffsets.clear();
-    lineOffsets.push_back(0);
+    if (!storage)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    storage->head = 0;
+    storage->count = 0;
+    storage->lengths[0] = 0;
 }
 
 void LogWindow::addLog(const char* beg, const char* end, bool newline)
 {
+    if (!storage)
+        return;
+
     /* Logs can be added from multiple threads */
     std::lock_guard<std::mutex> lock(mutex);
-    buffer.append(beg, end);
-    /* We always push a string with at most one `\n` character at the end */
-    if (newline)
-        lineOffsets.push_back(buffer.size());
+
+    /* Append to the line being built, after the last complete line */
+    int cur = (storage->head + storage->count) % LOG_LINES;
+    int len = storage->lengths[cur];
+    int size = end - beg;
+
+    /* We always push a string with at most one `\n` character at the end,
+     * which we don't store */
+    if (newline && (size > 0) && (end[-1] == '\n'))
+        size--;
+    if (size > (LOG_LINE_SIZE - len))
+        size = LOG_LINE_SIZE - len;
+    memcpy(storage->lines[cur] + len, beg, size);
+    storage->lengths[cur] = len + size;
+
+    if (newline) {
+        if (storage->count == (LOG_LINES - 1)) {
+            /* Drop the oldest line, keeping one slot for the line being built */
+            storage->head = (storage->head + 1) % LOG_LINES;
+        }
+        else {
+            storage->count++;
+        }
+        storage->lengths[(storage->head + storage->count) % LOG_LINES] = 0;
+    }
 }
 
 void LogWindow::draw(bool* p_open = nullptr)
@@ -83,50 +149,35 @@ void LogWindow::draw(bool* p_open = nullptr)
             ImGui::LogToClipboard();
 
         ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 0));
-        const char* buf = buffer.begin();
-        const char* buf_end = buffer.end();
-        if (filter.IsActive())
-        {
-            // In this example we don't use the clipper when filter is enabled.
-            // This is because we don't have random access to the result of our filter.
-            // A real application processing logs with ten of thousands of entries may want to store the result of
-            // search/filter.. especially if the filtering function is not trivial (e.g. reg-exp).
-            for (int line_no = 0; line_no < lineOffsets.Size; line_no++)
-            {
-                const char* line_start = buf + lineOffsets[line_no];
-                const char* line_end = (line_no + 1 < lineOffsets.Size) ? (buf + lineOffsets[line_no + 1] - 1) : buf_end;
-                if (filter.PassFilter(line_start, line_end))
-                    ImGui::TextUnformatted(line_start, line_end);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        int count = storage ? storage->count : 0;
+
+        /* With a filter, we gather the matching lines first, so that we can
+         * still use the clipper to only process visible lines */
+        bool filtering = filter.IsActive();
+        if (filtering) {
+            filteredLines.resize(0);
+            for (int l = 0; l < count; l++) {
+                int i = (storage->head + l) % LOG_LINES;
+                const char* line_start = storage->lines[i];
+                if (filter.PassFilter(line_start, line_start + storage->lengths[i]))
+                    filteredLines.push_back(i);
             }
         }
-        else
+
+        ImGuiListClipper clipper;
+        clipper.Begin(filtering ? filteredLines.Size : count);
+        while (clipper.Step())
         {
-            // The simplest and easy way to display the entire buffer:
-            //   ImGui::TextUnformatted(buf_begin, buf_end);
-            // And it'll just work. TextUnformatted() has specialization for large blob of text and will fast-forward
-            // to skip non-visible lines. Here we instead demonstrate using the clipper to only process lines that are
-            // within the visible area.
-            // If you have tens of thousands of items and their processing cost is non-negligible, coarse clipping them
-            // on your side is recommended. Using ImGuiListClipper requires
-            // - A) random access into your data
-            // - B) items all being the  same height,
-            // both of which we can handle since we have an array pointing to the beginning of each line of text.
-            // When using the filter (in the block of code above) we don't have random access into the data to display
-            // anymore, which is why we don't use the clipper. Storing or skimming through the search result would make
-            // it possible (and would be recommended if you want to search through tens of thousands of entries).
-            ImGuiListClipper clipper;
-            clipper.Begin(lineOffsets.Size);
-            while (clipper.Step())
+            for (int line_no = clipper.DisplayStart; line_no < clipper.DisplayEnd; line_no++)
             {
-                for (int line_no = clipper.DisplayStart; line_no < clipper.DisplayEnd; line_no++)
-                {
-                    const char* line_start = buf + lineOffsets[line_no];
-                    const char* line_end = (line_no + 1 < lineOffsets.Size) ? (buf + lineOffsets[line_no + 1] - 1) : buf_end;
-                    ImGui::TextUnformatted(line_start, line_end);
-                }
+                int i = filtering ? filteredLines[line_no] : ((storage->head + line_no) % LOG_LINES);
+                const char* line_start = storage->lines[i];
+                ImGui::TextUnformatted(line_start, line_start + storage->lengths[i]);
             }
-            clipper.End();
         }
+        clipper.End();
         ImGui::PopStyleVar();
 
         // Keep up at the bottom of the scroll region if we were already at the bottom at the beginning of the frame.
@@ -20,10 +20,19 @@
 #ifndef LIBTAS_IMGUI_LOGWINDOW_H_INCL
 #define LIBTAS_IMGUI_LOGWINDOW_H_INCL
 
+#include <cstddef>
+
 namespace libtas {
 
 namespace LogWindow
 {
+    /* Allocate the log storage. It must be done before any savestate, because
+     * the storage is not saved */
+    void init();
+
+    /* Returns if the memory area is the log storage */
+    bool isLogArea(const void* addr, size_t size);
+
     void clear();
 
     void addLog(const char* beg, const char* end, bool newline);
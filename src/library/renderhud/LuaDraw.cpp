@@ -19,158 +19,209 @@
 
 #include "LuaDraw.h"
 
-#include "global.h" // Global::shared_config
 #include "../external/imgui/imgui.h"
-#include "TimeHolder.h"
+#include "../shared/sockethelpers.h"
+#include "../shared/LuaDrawRecord.h"
 #include "logging.h"
 
-#include <list>
-#include <utility>
-#include <string>
-#include <memory>
 #include <cmath>
+#include <cstring>
+#include <stdint.h>
+#include <sys/mman.h>
+
+/* Maximum number of quads reserved at once when batching pixels and filled
+ * rectangles, so that the vertex indices of a batch fit in 16 bits */
+#define QUAD_BATCH_SIZE 8192
 
 namespace libtas {
-    
-static std::list<std::unique_ptr<LuaDraw::LuaShape>> lua_shapes;
-ImFont* LuaDraw::LuaText::regular_font;
-ImFont* LuaDraw::LuaText::monospace_font;
 
-void LuaDraw::LuaText::render()
+/* Storage for the lua draw list. It is retained between frames, and the
+ * program only sends the records that changed. It is allocated in its own
+ * mapping which is skipped by savestates, so that it always matches what the
+ * program has sent. Colors are stored as ImGui colors. */
+struct LuaDrawStorage {
+    uint32_t record_count;
+    uint32_t text_size;
+    LuaDrawRecord records[LUA_DRAW_MAX_RECORDS];
+    char texts[LUA_DRAW_MAX_TEXT];
+};
+
+static LuaDrawStorage* storage = nullptr;
+ImFont* LuaDraw::regular_font;
+ImFont* LuaDraw::monospace_font;
+
+void LuaDraw::init()
 {
-    ImFont* font = regular_font;
-    
-    if (monospace)
-        font = monospace_font;
-    
-    /* Sanitize and process anchor values */
-    if (anchor_x < 0.0f)
-        anchor_x = 0.0f;
-    if (anchor_x > 1.0f)
-        anchor_x = 1.0f;
-    if (anchor_y < 0.0f)
-        anchor_y = 0.0f;
-    if (anchor_y > 1.0f)
-        anchor_y = 1.0f;
-    
-    /* Try avoiding computing the text length */
-    if (anchor_x == 0.0f && anchor_y == 0.0f) {
-        ImGui::GetBackgroundDrawList()->AddText(font, font_size, ImVec2(x, y), color, text.c_str());
+    if (storage)
+        return;
+
+    /* Use a shared mapping, so that it is not merged with adjacent areas */
+    void* addr = mmap(nullptr, sizeof(LuaDrawStorage), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        debuglogstdio(LCF_ERROR, "Could not allocate the lua draw list");
+        return;
     }
-    else {
-        const ImVec2 size = font->CalcTextSizeA(font_size, FLT_MAX, -1.0f, text.c_str(), NULL, NULL);
-        int new_x = std::round((float)x - size.x * anchor_x);
-        int new_y = std::round((float)y - size.y * anchor_y);
-        ImGui::GetBackgroundDrawList()->AddText(font, font_size, ImVec2(new_x, new_y), color, text.c_str());
-    }    
-}
 
-void LuaDraw::LuaPixel::render()
-{
-    ImGui::GetBackgroundDrawList()->AddLine(ImVec2(x, y), ImVec2(x, y), color);
+    storage = static_cast<LuaDrawStorage*>(addr);
+    storage->record_count = 0;
+    storage->text_size = 0;
 }
 
-void LuaDraw::LuaRect::render()
+bool LuaDraw::isLuaDrawArea(const void* addr, size_t size)
 {
-    if (filled)
-        ImGui::GetBackgroundDrawList()->AddRectFilled(ImVec2(x, y), ImVec2(x+w, y+h), color);
-    else
-        ImGui::GetBackgroundDrawList()->AddRect(ImVec2(x, y), ImVec2(x+w, y+h), color, 0.0f, 0, thickness);
+    return storage && (addr == storage) && (size >= sizeof(LuaDrawStorage));
 }
 
-void LuaDraw::LuaLine::render()
+/* Receive data into the storage, or discard it if the storage is missing or
+ * the data does not fit */
+static void receiveInto(void* dest, size_t size, size_t capacity)
 {
-    ImGui::GetBackgroundDrawList()->AddLine(ImVec2(x0, y0), ImVec2(x1, y1), color);
-}
+    if (dest && (size <= capacity)) {
+        receiveData(dest, size);
+        return;
+    }
 
-void LuaDraw::LuaEllipse::render()
-{
-    ImGui::GetBackgroundDrawList()->AddEllipse(ImVec2(center_x, center_y), radius_x, radius_y, color);
+    char buf[4096];
+    while (size > 0) {
+        size_t chunk = (size < sizeof(buf)) ? size : sizeof(buf);
+        receiveData(buf, chunk);
+        size -= chunk;
+    }
 }
 
-void LuaDraw::insertText(int x, int y, std::string text, uint32_t color, float anchor_x, float anchor_y, float font_size, bool monospace)
+void LuaDraw::receive()
 {
-    auto lt = new LuaText();
-    lt->x = x;
-    lt->y = y;
-    lt->text = text;
-    lt->color = IM_COL32(static_cast<uint8_t>((color >> 16) & 0xff),
-                 static_cast<uint8_t>((color >> 8) & 0xff),
-                 static_cast<uint8_t>(color & 0xff),
-                 static_cast<uint8_t>((color >> 24) & 0xff));
-    lt->anchor_x = anchor_x;
-    lt->anchor_y = anchor_y;
-    lt->font_size = font_size;
-    lt->monospace = monospace;
-    lua_shapes.emplace_back(lt);
-}
+    uint32_t record_count;
+    receiveData(&record_count, sizeof(uint32_t));
+
+    bool text_changed;
+    receiveData(&text_changed, sizeof(bool));
+    if (text_changed) {
+        uint32_t text_size;
+        receiveData(&text_size, sizeof(uint32_t));
+        receiveInto(storage ? storage->texts : nullptr, text_size, LUA_DRAW_MAX_TEXT);
+        if (storage)
+            storage->text_size = (text_size <= LUA_DRAW_MAX_TEXT) ? text_size : 0;
+    }
 
-void LuaDraw::insertPixel(int x, int y, uint32_t color)
-{
-    auto lp = new LuaPixel;
-    lp->x = x;
-    lp->y = y;
-    lp->color = IM_COL32(static_cast<uint8_t>((color >> 16) & 0xff),
-                 static_cast<uint8_t>((color >> 8) & 0xff),
-                 static_cast<uint8_t>(color & 0xff),
-                 static_cast<uint8_t>((color >> 24) & 0xff));
-    lua_shapes.emplace_back(lp);
-}
+    uint32_t run_count;
+    receiveData(&run_count, sizeof(uint32_t));
+    for (uint32_t r = 0; r < run_count; r++) {
+        uint32_t first, count;
+        receiveData(&first, sizeof(uint32_t));
+        receiveData(&count, sizeof(uint32_t));
+
+        bool fits = (first <= LUA_DRAW_MAX_RECORDS) && (count <= LUA_DRAW_MAX_RECORDS - first);
+        LuaDrawRecord* records = (storage && fits) ? &storage->records[first] : nullptr;
+        receiveInto(records, count * sizeof(LuaDrawRecord), count * sizeof(LuaDrawRecord));
+
+        if (!records)
+            continue;
+
+        /* Convert colors once, instead of at each draw */
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t color = records[i].color;
+            records[i].color = IM_COL32(static_cast<uint8_t>((color >> 16) & 0xff),
+                         static_cast<uint8_t>((color >> 8) & 0xff),
+                         static_cast<uint8_t>(color & 0xff),
+                         static_cast<uint8_t>((color >> 24) & 0xff));
+        }
+    }
 
-void LuaDraw::insertRect(int x, int y, int w, int h, int thickness, uint32_t color, int filled)
-{
-    auto lr = new LuaRect();
-    lr->x = x;
-    lr->y = y;
-    lr->w = w;
-    lr->h = h;
-    lr->thickness = thickness;
-    lr->color = IM_COL32(static_cast<uint8_t>((color >> 16) & 0xff),
-                   static_cast<uint8_t>((color >> 8) & 0xff),
-                   static_cast<uint8_t>(color & 0xff),
-                   static_cast<uint8_t>((color >> 24) & 0xff));
-    lr->filled = filled;
-    lua_shapes.emplace_back(lr);
+    if (storage) {
+        if (record_count > LUA_DRAW_MAX_RECORDS)
+            record_count = LUA_DRAW_MAX_RECORDS;
+        storage->record_count = record_count;
+    }
 }
 
-void LuaDraw::insertLine(int x0, int y0, int x1, int y1, uint32_t color)
+static inline bool isQuad(const LuaDrawRecord& record)
 {
-    auto ll = new LuaLine();
-    ll->x0 = x0;
-    ll->y0 = y0;
-    ll->x1 = x1;
-    ll->y1 = y1;
-    ll->color = IM_COL32(static_cast<uint8_t>((color >> 16) & 0xff),
-                 static_cast<uint8_t>((color >> 8) & 0xff),
-                 static_cast<uint8_t>(color & 0xff),
-                 static_cast<uint8_t>((color >> 24) & 0xff));
-    lua_shapes.emplace_back(ll);
+    return (record.type == LuaDrawRecord::LUA_DRAW_PIXEL) ||
+        ((record.type == LuaDrawRecord::LUA_DRAW_RECT) && record.flag);
 }
 
-void LuaDraw::insertEllipse(int center_x, int center_y, int radius_x, int radius_y, uint32_t color)
+static void renderText(ImDrawList* draw_list, const LuaDrawRecord& record)
 {
-    auto le = new LuaEllipse();
-    le->center_x = center_x;
-    le->center_y = center_y;
-    le->radius_x = radius_x;
-    le->radius_y = radius_y;
-    le->color = IM_COL32(static_cast<uint8_t>((color >> 16) & 0xff),
-                 static_cast<uint8_t>((color >> 8) & 0xff),
-                 static_cast<uint8_t>(color & 0xff),
-                 static_cast<uint8_t>((color >> 24) & 0xff));
-    lua_shapes.emplace_back(le);
-}
+    /* Ignore texts that are not inside the text buffer */
+    if ((record.text_offset > storage->text_size) ||
+        (record.text_size > storage->text_size - record.text_offset))
+        return;
 
-void LuaDraw::draw()
-{
-    for (auto &shape : lua_shapes) {
-        shape->render();
+    const char* text_begin = storage->texts + record.text_offset;
+    const char* text_end = text_begin + record.text_size;
+    ImFont* font = record.flag ? LuaDraw::monospace_font : LuaDraw::regular_font;
+
+    /* Sanitize and process anchor values */
+    float anchor_x = record.anchor_x;
+    float anchor_y = record.anchor_y;
+    if (anchor_x < 0.0f)
+        anchor_x = 0.0f;
+    if (anchor_x > 1.0f)
+        anchor_x = 1.0f;
+    if (anchor_y < 0.0f)
+        anchor_y = 0.0f;
+    if (anchor_y > 1.0f)
+        anchor_y = 1.0f;
+
+    /* Try avoiding computing the text length */
+    if (anchor_x == 0.0f && anchor_y == 0.0f) {
+        draw_list->AddText(font, record.font_size, ImVec2(record.x0, record.y0), record.color, text_begin, text_end);
+    }
+    else {
+        const ImVec2 size = font->CalcTextSizeA(record.font_size, FLT_MAX, -1.0f, text_begin, text_end, NULL);
+        int new_x = std::round((float)record.x0 - size.x * anchor_x);
+        int new_y = std::round((float)record.y0 - size.y * anchor_y);
+        draw_list->AddText(font, record.font_size, ImVec2(new_x, new_y), record.color, text_begin, text_end);
     }
 }
 
-void LuaDraw::reset()
+void LuaDraw::draw()
 {
-    lua_shapes.clear();
+    if (!storage || (storage->record_count == 0))
+        return;
+
+    ImDrawList* draw_list = ImGui::GetBackgroundDrawList();
+    const LuaDrawRecord* records = storage->records;
+    uint32_t record_count = storage->record_count;
+
+    for (uint32_t i = 0; i < record_count; ) {
+        /* Pixels and filled rectangles are written directly into reserved
+         * vertices, instead of growing the draw list buffers for each one.
+         * Consecutive ones are batched, so that the drawing order is kept. */
+        if (isQuad(records[i])) {
+            uint32_t end = i + 1;
+            while ((end < record_count) && (end - i < QUAD_BATCH_SIZE) && isQuad(records[end]))
+                end++;
+
+            draw_list->PrimReserve(6 * (end - i), 4 * (end - i));
+            for (; i < end; i++) {
+                const LuaDrawRecord& record = records[i];
+                if (record.type == LuaDrawRecord::LUA_DRAW_PIXEL)
+                    draw_list->PrimRect(ImVec2(record.x0, record.y0), ImVec2(record.x0+1, record.y0+1), record.color);
+                else
+                    draw_list->PrimRect(ImVec2(record.x0, record.y0), ImVec2(record.x0+record.x1, record.y0+record.y1), record.color);
+            }
+            continue;
+        }
+
+        const LuaDrawRecord& record = records[i];
+        switch (record.type) {
+            case LuaDrawRecord::LUA_DRAW_TEXT:
+                renderText(draw_list, record);
+                break;
+            case LuaDrawRecord::LUA_DRAW_RECT:
+                draw_list->AddRect(ImVec2(record.x0, record.y0), ImVec2(record.x0+record.x1, record.y0+record.y1), record.color, 0.0f, 0, record.thickness);
+                break;
+            case LuaDrawRecord::LUA_DRAW_LINE:
+                draw_list->AddLine(ImVec2(record.x0, record.y0), ImVec2(record.x1, record.y1), record.color);
+                break;
+            case LuaDrawRecord::LUA_DRAW_ELLIPSE:
+                draw_list->AddEllipse(ImVec2(record.x0, record.y0), record.x1, record.y1, record.color);
+                break;
+        }
+        i++;
+    }
 }
 
 }
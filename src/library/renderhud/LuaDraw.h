@@ -22,92 +22,29 @@
 
 #include "../external/imgui/imgui.h"
 
-#include <string>
-#include <cstdint>
+#include <cstddef>
 
 namespace libtas {
 
 namespace LuaDraw
 {
 
-struct LuaShape
-{
-    virtual void render() = 0;
-};
-
-struct LuaText : public LuaShape
-{
-    std::string text;
-    uint32_t color;
-    int x;
-    int y;
-    float anchor_x;
-    float anchor_y;
-    float font_size;
-    bool monospace;
-    static ImFont* regular_font;
-    static ImFont* monospace_font;
-    void render() override;
-};
-
-struct LuaPixel : public LuaShape
-{
-    int x;
-    int y;
-    uint32_t color;
-    void render() override;
-};
-
-struct LuaRect : public LuaShape
-{
-    int x;
-    int y;
-    int w;
-    int h;
-    int thickness;
-    uint32_t color;
-    int filled;
-    void render() override;
-};
-
-struct LuaLine : public LuaShape
-{
-    int x0;
-    int y0;
-    int x1;
-    int y1;
-    uint32_t color;
-    void render() override;
-};
-
-struct LuaEllipse : public LuaShape
-{
-    int center_x;
-    int center_y;
-    int radius_x;
-    int radius_y;
-    uint32_t color;
-    void render() override;
-};
-
-/* Insert a lua text to be displayed */
-void insertText(int x, int y, std::string text, uint32_t color, float anchor_x, float anchor_y, float font_size, bool monospace);
-
-/* Insert a lua pixel to be displayed */
-void insertPixel(int x, int y, uint32_t color);
-
-/* Insert a lua rect to be displayed */
-void insertRect(int x, int y, int w, int h, int thickness, uint32_t color, int filled);
+/* Fonts used to draw lua texts */
+extern ImFont* regular_font;
+extern ImFont* monospace_font;
 
-/* Insert a lua line to be displayed */
-void insertLine(int x0, int y0, int x1, int y1, uint32_t color);
+/* Allocate the draw list storage. It must be done before any savestate,
+ * because the storage is not saved */
+void init();
 
-/* Insert a lua line to be displayed */
-void insertEllipse(int center_x, int center_y, int radius_x, int radius_y, uint32_t color);
+/* Returns if the memory area is the draw list storage */
+bool isLuaDrawArea(const void* addr, size_t size);
 
-/* Clear all lua drawings */
-void reset();
+/* Receive the changes of the draw list from the program, after a
+ * MSGN_LUA_DRAW_LIST message */
+void receive();
 
+/* Draw all lua primitives */
 void draw();
 
 }
@@ -134,6 +134,13 @@ DEFINE_ORIG_POINTER(vkDestroySampler)
 DEFINE_ORIG_POINTER(vkDestroyFramebuffer)
 DEFINE_ORIG_POINTER(vkDestroySwapchainKHR)
 DEFINE_ORIG_POINTER(vkCmdClearColorImage)
+DEFINE_ORIG_POINTER(vkCreateBuffer)
+DEFINE_ORIG_POINTER(vkDestroyBuffer)
+DEFINE_ORIG_POINTER(vkGetBufferMemoryRequirements)
+DEFINE_ORIG_POINTER(vkBindBufferMemory)
+DEFINE_ORIG_POINTER(vkCmdCopyImageToBuffer)
+DEFINE_ORIG_POINTER(vkWaitForFences)
+DEFINE_ORIG_POINTER(vkResetFences)
 
 
 #define VKFUNCSKIPDRAW(NAME, DECL, ARGS) \
@@ -331,6 +338,13 @@ VkResult myvkCreateDevice(VkPhysicalDevice physicalDevice, const VkDeviceCreateI
         GETPROCADDR(vkDestroySampler)
         GETPROCADDR(vkDestroyFramebuffer)
         GETPROCADDR(vkCmdClearColorImage)
+        GETPROCADDR(vkCreateBuffer)
+        GETPROCADDR(vkDestroyBuffer)
+        GETPROCADDR(vkGetBufferMemoryRequirements)
+        GETPROCADDR(vkBindBufferMemory)
+        GETPROCADDR(vkCmdCopyImageToBuffer)
+        GETPROCADDR(vkWaitForFences)
+        GETPROCADDR(vkResetFences)
         
         /* Create the descriptor pool that will create descriptor sets for the
          * font texture and game window texture */
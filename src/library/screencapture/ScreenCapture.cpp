@@ -26,7 +26,9 @@
 #include "ScreenCapture_Vulkan.h"
 #include "ScreenCapture_XShm.h"
 #include "logging.h"
+#include "PerfTimer.h"
 #include "global.h"
+#include "encoding/AVEncoder.h"
 
 namespace libtas {
 
@@ -76,6 +78,11 @@ void ScreenCapture::fini()
 {
     if (!inited) return;
 
+    /* Frames waiting for their pixels must be encoded while we can still
+     * read them */
+    if (avencoder)
+        avencoder->flushDelayedFrames();
+
     inited = false;
 
     if (impl) {
@@ -130,6 +137,8 @@ int ScreenCapture::copyScreenToSurface()
     if (!inited)
         return 0;
 
+    PerfScope ps(PerfCounters::CAPTURE);
+
     if (impl) {
         return impl->copyScreenToSurface();
     }
@@ -141,12 +150,38 @@ int ScreenCapture::getPixelsFromSurface(uint8_t **pixels, bool draw)
     if (!inited)
         return 0;
 
+    PerfScope ps(PerfCounters::CAPTURE);
+
     if (impl) {
         return impl->getPixelsFromSurface(pixels, draw);
     }
     return 0;
 }
 
+int ScreenCapture::getCurrentPixels(uint8_t **pixels, bool draw)
+{
+    if (!inited)
+        return 0;
+
+    PerfScope ps(PerfCounters::CAPTURE);
+
+    if (impl) {
+        return impl->getCurrentPixels(pixels, draw);
+    }
+    return 0;
+}
+
+int ScreenCapture::getReadbackDelay()
+{
+    if (!inited)
+        return 0;
+
+    if (impl) {
+        return impl->getReadbackDelay();
+    }
+    return 0;
+}
+
 int ScreenCapture::copySurfaceToScreen()
 {
     if (!inited)
@@ -66,6 +66,15 @@ public:
      * Returns the size of the array. */
     static int getPixelsFromSurface(uint8_t **pixels, bool draw);
 
+    /* Number of frames between a copy of the screen and the moment its
+     * pixels are returned by `getPixelsFromSurface()`. The encoder must delay
+     * its frames by that amount. */
+    static int getReadbackDelay();
+
+    /* Transfer the pixels of the last copy of the screen, without delay and
+     * without disturbing the encoder. Used for screenshots. */
+    static int getCurrentPixels(uint8_t **pixels, bool draw);
+
     /* Copy back the stored screen buffer/surface/texture into the screen. */
     static int copySurfaceToScreen();
 
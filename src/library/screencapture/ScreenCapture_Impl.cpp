@@ -105,6 +105,10 @@ void ScreenCapture_Impl::resize(int w, int h)
     }
 #endif
 
+    /* Frames waiting for the pixels of the old surface must be encoded first */
+    if (avencoder)
+        avencoder->flushDelayedFrames();
+
     destroyScreenSurface();
 
     width = w;
@@ -66,6 +66,15 @@ public:
      * Returns the size of the array. */
     virtual int getPixelsFromSurface(uint8_t **pixels, bool draw) = 0;
 
+    /* Number of frames between a copy of the screen and the moment its
+     * pixels are returned by `getPixelsFromSurface()` */
+    virtual int getReadbackDelay() {return 0;}
+
+    /* Same as `getPixelsFromSurface()`, but returns the pixels of the last
+     * copy of the screen without any readback delay. It must not consume the
+     * copies that are waiting to be read by the encoder. */
+    virtual int getCurrentPixels(uint8_t **pixels, bool draw) {return getPixelsFromSurface(pixels, draw);}
+
     /* Copy back the stored screen buffer/surface/texture into the screen. */
     virtual int copySurfaceToScreen() = 0;
 
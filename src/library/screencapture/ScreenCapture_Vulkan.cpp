@@ -22,6 +22,7 @@
 #include "logging.h"
 #include "global.h"
 #include "GlobalState.h"
+#include "PerfTimer.h"
 #include "rendering/vulkanwrappers.h"
 #include "../external/imgui/imgui.h"
 #include "../external/imgui/imgui_impl_vulkan.h" // ImGui_ImplVulkan_AddTexture
@@ -51,6 +52,19 @@ DECLARE_ORIG_POINTER(vkCreateSampler)
 DECLARE_ORIG_POINTER(vkDestroyImageView)
 DECLARE_ORIG_POINTER(vkDestroySampler)
 DECLARE_ORIG_POINTER(vkCmdClearColorImage)
+DECLARE_ORIG_POINTER(vkCreateBuffer)
+DECLARE_ORIG_POINTER(vkDestroyBuffer)
+DECLARE_ORIG_POINTER(vkGetBufferMemoryRequirements)
+DECLARE_ORIG_POINTER(vkBindBufferMemory)
+DECLARE_ORIG_POINTER(vkCmdCopyImageToBuffer)
+DECLARE_ORIG_POINTER(vkCreateFence)
+DECLARE_ORIG_POINTER(vkDestroyFence)
+DECLARE_ORIG_POINTER(vkWaitForFences)
+DECLARE_ORIG_POINTER(vkResetFences)
+DECLARE_ORIG_POINTER(vkQueueWaitIdle)
+
+/* Maximum time to wait for a readback copy, in nanoseconds */
+#define READBACK_TIMEOUT 1000000000ULL
 
 int ScreenCapture_Vulkan::init()
 {
@@ -186,8 +200,110 @@ void ScreenCapture_Vulkan::initScreenSurface()
     // vkScreenDescriptorSet = ImGui_ImplVulkan_AddTexture(vkScreenSampler, vkScreenImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 }
 
+/* Get the memory type of readback buffers. Cached memory is preferred,
+ * because the pixels are read by the CPU */
+static uint32_t getReadbackMemoryType(uint32_t typeBits)
+{
+    const VkMemoryPropertyFlags cached = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    for (uint32_t i = 0; i < vk::context.deviceMemoryProperties.memoryTypeCount; i++) {
+        if ((typeBits & (1u << i)) && ((vk::context.deviceMemoryProperties.memoryTypes[i].propertyFlags & cached) == cached))
+            return i;
+    }
+
+    return vk::getMemoryTypeIndex(typeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+bool ScreenCapture_Vulkan::initReadbackRing()
+{
+    VkResult res;
+
+    for (int i = 0; i < READBACK_SLOTS; i++) {
+        ReadbackSlot& slot = readbackSlots[i];
+
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if ((res = orig::vkCreateBuffer(vk::context.device, &bufferInfo, vk::context.allocator, &slot.buffer)) != VK_SUCCESS) {
+            debuglogstdio(LCF_VULKAN | LCF_ERROR, "vkCreateBuffer failed with error %d", res);
+            destroyReadbackRing();
+            return false;
+        }
+
+        VkMemoryRequirements memRequirements;
+        orig::vkGetBufferMemoryRequirements(vk::context.device, slot.buffer, &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = getReadbackMemoryType(memRequirements.memoryTypeBits);
+
+        if ((res = orig::vkAllocateMemory(vk::context.device, &allocInfo, vk::context.allocator, &slot.memory)) != VK_SUCCESS) {
+            debuglogstdio(LCF_VULKAN | LCF_ERROR, "vkAllocateMemory failed with error %d", res);
+            destroyReadbackRing();
+            return false;
+        }
+
+        orig::vkBindBufferMemory(vk::context.device, slot.buffer, slot.memory, 0);
+
+        /* The buffer stays mapped until it is destroyed */
+        void* data;
+        if ((res = orig::vkMapMemory(vk::context.device, slot.memory, 0, VK_WHOLE_SIZE, 0, &data)) != VK_SUCCESS) {
+            debuglogstdio(LCF_VULKAN | LCF_ERROR, "vkMapMemory failed with error %d", res);
+            destroyReadbackRing();
+            return false;
+        }
+        slot.data = static_cast<const uint8_t*>(data);
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if ((res = orig::vkCreateFence(vk::context.device, &fenceInfo, vk::context.allocator, &slot.fence)) != VK_SUCCESS) {
+            debuglogstdio(LCF_VULKAN | LCF_ERROR, "vkCreateFence failed with error %d", res);
+            destroyReadbackRing();
+            return false;
+        }
+
+        slot.pending = false;
+    }
+
+    readbackWrite = 0;
+    readbackRead = 0;
+    return true;
+}
+
+void ScreenCapture_Vulkan::destroyReadbackRing()
+{
+    for (int i = 0; i < READBACK_SLOTS; i++) {
+        ReadbackSlot& slot = readbackSlots[i];
+
+        if (slot.pending) {
+            orig::vkWaitForFences(vk::context.device, 1, &slot.fence, VK_TRUE, READBACK_TIMEOUT);
+            slot.pending = false;
+        }
+        if (slot.fence != VK_NULL_HANDLE) {
+            orig::vkDestroyFence(vk::context.device, slot.fence, nullptr);
+            slot.fence = VK_NULL_HANDLE;
+        }
+        if (slot.memory != VK_NULL_HANDLE) {
+            if (slot.data)
+                orig::vkUnmapMemory(vk::context.device, slot.memory);
+            orig::vkFreeMemory(vk::context.device, slot.memory, nullptr);
+            slot.memory = VK_NULL_HANDLE;
+            slot.data = nullptr;
+        }
+        if (slot.buffer != VK_NULL_HANDLE) {
+            orig::vkDestroyBuffer(vk::context.device, slot.buffer, nullptr);
+            slot.buffer = VK_NULL_HANDLE;
+        }
+    }
+}
+
 void ScreenCapture_Vulkan::destroyScreenSurface()
 {
+    destroyReadbackRing();
+
     /* Delete the Vulkan image and all associated objects */
     if (vkScreenDescriptorSet != VK_NULL_HANDLE) {
         ImGui_ImplVulkan_RemoveTexture(vkScreenDescriptorSet);
@@ -334,6 +450,55 @@ int ScreenCapture_Vulkan::copyScreenToSurface()
 		1,
 		&imageCopyRegion);
 
+    /* When encoding, also copy the screen into the next slot of the
+     * readback ring. Its pixels will be read a few frames later. */
+    ReadbackSlot* slot = nullptr;
+    if (Global::shared_config.av_dumping &&
+        ((readbackSlots[0].buffer != VK_NULL_HANDLE) || initReadbackRing())) {
+        /* If the ring is full, the next slot is the oldest one, so we
+         * wait for its copy to complete and read it before reusing it */
+        if (readbackSlots[readbackWrite].pending) {
+            debuglogstdio(LCF_DUMP | LCF_VULKAN, "Readback ring is full, waiting for the oldest copy");
+            readOldestSlot();
+        }
+        slot = &readbackSlots[readbackWrite];
+    }
+
+    if (slot) {
+        VkBufferImageCopy bufferCopyRegion{};
+        bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        bufferCopyRegion.imageSubresource.layerCount = 1;
+        bufferCopyRegion.imageExtent.width = width;
+        bufferCopyRegion.imageExtent.height = height;
+        bufferCopyRegion.imageExtent.depth = 1;
+
+        orig::vkCmdCopyImageToBuffer(
+            cmdBuffer,
+            backbuffer, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            slot->buffer,
+            1,
+            &bufferCopyRegion);
+
+        /* Make the copy visible to the host */
+        VkBufferMemoryBarrier bufferBarrier{};
+        bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.buffer = slot->buffer;
+        bufferBarrier.offset = 0;
+        bufferBarrier.size = VK_WHOLE_SIZE;
+
+        orig::vkCmdPipelineBarrier(cmdBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+            0,
+            0, nullptr,
+            1, &bufferBarrier,
+            0, nullptr
+        );
+    }
+
 	/* Transition destination image to general layout, which is the required layout for mapping the image memory later on */
     dstBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     dstBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
@@ -389,9 +554,14 @@ int ScreenCapture_Vulkan::copyScreenToSurface()
 
     // debuglogstdio(LCF_VULKAN, "    vkQueueSubmit wait on %llx and signal %llx and semindex %d", submitInfo.pWaitSemaphores[0], submitInfo.pSignalSemaphores[0], vk::context.semaphoreIndex);
 
-    if ((res = orig::vkQueueSubmit(vk::context.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE)) != VK_SUCCESS) {
+    if ((res = orig::vkQueueSubmit(vk::context.graphicsQueue, 1, &submitInfo, slot ? slot->fence : VK_NULL_HANDLE)) != VK_SUCCESS) {
         debuglogstdio(LCF_VULKAN | LCF_ERROR, "vkEndCommandBuffer failed with error %d", res);
     }
+    else if (slot) {
+        slot->pending = true;
+        NATIVECALL(clock_gettime(CLOCK_MONOTONIC, &slot->submitTime));
+        readbackWrite = (readbackWrite + 1) % READBACK_SLOTS;
+    }
 
     vk::context.currentSemaphore = submitInfo.pSignalSemaphores[0];
     
@@ -407,10 +577,57 @@ int ScreenCapture_Vulkan::getPixelsFromSurface(uint8_t **pixels, bool draw)
     if (!draw)
         return size;
 
+    /* Read the oldest copy of the ring. If no copy was made, we keep the
+     * pixels of the previous frame */
+    if (readbackSlots[readbackRead].pending)
+        readOldestSlot();
+
+    return size;
+}
+
+void ScreenCapture_Vulkan::readOldestSlot()
+{
+    ReadbackSlot& slot = readbackSlots[readbackRead];
+
+    GlobalNative gn;
+
+    /* The copy was submitted a few frames ago, so it has usually completed */
+    VkResult res = orig::vkWaitForFences(vk::context.device, 1, &slot.fence, VK_TRUE, READBACK_TIMEOUT);
+    if (res == VK_SUCCESS) {
+        memcpy(winpixels.data(), slot.data, size);
+
+        TimeHolder readTime;
+        NATIVECALL(clock_gettime(CLOCK_MONOTONIC, &readTime));
+        perfTimer.addCall(PerfCounters::READBACK, readTime - slot.submitTime);
+    }
+    else {
+        debuglogstdio(LCF_VULKAN | LCF_ERROR, "vkWaitForFences failed with error %d", res);
+        /* Make sure that the fence is not used anymore before resetting it */
+        orig::vkQueueWaitIdle(vk::context.graphicsQueue);
+    }
+
+    orig::vkResetFences(vk::context.device, 1, &slot.fence);
+    slot.pending = false;
+    readbackRead = (readbackRead + 1) % READBACK_SLOTS;
+}
+
+int ScreenCapture_Vulkan::getReadbackDelay()
+{
+    return READBACK_SLOTS - 1;
+}
+
+int ScreenCapture_Vulkan::getCurrentPixels(uint8_t **pixels, bool draw)
+{
     GlobalNative gn;
 
     VkResult res;
 
+    /* The screen image is only updated on draw frames, so it always holds
+     * the last screen. Wait for its copy, which is rare enough here. */
+    orig::vkQueueWaitIdle(vk::context.graphicsQueue);
+
+    currentpixels.resize(size);
+
     /* Get layout of the image (including row pitch) */
 	VkImageSubresource subResource { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0 };
 	VkSubresourceLayout subResourceLayout;
@@ -419,15 +636,16 @@ int ScreenCapture_Vulkan::getPixelsFromSurface(uint8_t **pixels, bool draw)
 	/* Map image memory so we can start copying from it */
 	const char* data;
     if ((res = orig::vkMapMemory(vk::context.device, vkScreenImageMemory, 0, VK_WHOLE_SIZE, 0, (void**)&data)) != VK_SUCCESS) {
-        debuglogstdio(LCF_VULKAN | LCF_ERROR, "vkEndCommandBuffer failed with error %d", res);
+        debuglogstdio(LCF_VULKAN | LCF_ERROR, "vkMapMemory failed with error %d", res);
+        return 0;
     }
-    
+
     /* Copy image pixels respecting the image layout. */
     data += subResourceLayout.offset;
     VkDeviceSize s = 0;
     int h = 0;
     while ((s < subResourceLayout.size) && (h < height)) {
-        memcpy(&winpixels[h*width*pixelSize], data, width*pixelSize);
+        memcpy(&currentpixels[h*width*pixelSize], data, width*pixelSize);
         data += subResourceLayout.rowPitch;
         s += subResourceLayout.rowPitch;
         h++;
@@ -435,9 +653,13 @@ int ScreenCapture_Vulkan::getPixelsFromSurface(uint8_t **pixels, bool draw)
 
     if (h != height)
         debuglogstdio(LCF_VULKAN | LCF_ERROR, "Mismatch between Vulkan internal image height (%d) and registered height (%d)", h, height);
-    
+
     orig::vkUnmapMemory(vk::context.device, vkScreenImageMemory);
-    
+
+    if (pixels) {
+        *pixels = currentpixels.data();
+    }
+
     return size;
 }
 
@@ -22,6 +22,7 @@
 
 #include "ScreenCapture_Impl.h"
 #include "rendering/vulkanwrappers.h"
+#include "TimeHolder.h"
 
 #include <stdint.h>
 
@@ -53,6 +54,12 @@ public:
      * Returns the size of the array. */
     int getPixelsFromSurface(uint8_t **pixels, bool draw);
 
+    /* Pixels are read from a ring of buffers, a few frames after the copy */
+    int getReadbackDelay();
+
+    /* Read the screen image directly, after waiting for its copy */
+    int getCurrentPixels(uint8_t **pixels, bool draw);
+
     /* Copy back the stored screen buffer/surface/texture into the screen. */
     int copySurfaceToScreen();
 
@@ -68,6 +75,42 @@ private:
     VkSampler vkScreenSampler = VK_NULL_HANDLE;
     VkDescriptorSet vkScreenDescriptorSet = VK_NULL_HANDLE;
     VkDeviceMemory vkScreenImageMemory = VK_NULL_HANDLE;
+
+    /* Pixels returned by `getCurrentPixels()`, separated from the encoder
+     * pixels which must be kept for non-draw frames */
+    std::vector<uint8_t> currentpixels;
+
+    /* When encoding, the screen is also copied into a ring of host-visible
+     * buffers. The pixels of a frame are read when the ring wraps around, so
+     * that the GPU copy of the next frames can run in the meantime. */
+    struct ReadbackSlot {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        const uint8_t* data = nullptr;
+        VkFence fence = VK_NULL_HANDLE;
+
+        /* Has a copy been submitted that was not read yet */
+        bool pending = false;
+
+        /* Time of the copy submission, for the readback latency */
+        TimeHolder submitTime;
+    };
+
+    static const int READBACK_SLOTS = 3;
+    ReadbackSlot readbackSlots[READBACK_SLOTS];
+
+    /* Index of the next slot to copy into, and of the oldest pending slot */
+    int readbackWrite = 0;
+    int readbackRead = 0;
+
+    /* Allocate the buffers of the readback ring */
+    bool initReadbackRing();
+
+    /* Wait for pending copies and free the readback ring */
+    void destroyReadbackRing();
+
+    /* Wait for the oldest pending copy, read its pixels and release its slot */
+    void readOldestSlot();
 }; 
 }
 
@@ -27,46 +27,36 @@ namespace libtas {
 
 SDLEventQueue sdlEventQueue;
 
-SDLEventQueue::~SDLEventQueue()
-{
-    for (auto ev: eventQueue) {
-        if (Global::game_info.video & GameInfo::SDL1)
-            delete static_cast<SDL1::SDL_Event*>(ev);
-        if (Global::game_info.video & GameInfo::SDL2)
-            delete static_cast<SDL_Event*>(ev);
-    }
-}
-
 void SDLEventQueue::init(void)
 {
     emptied = false;
     if (Global::game_info.video & GameInfo::SDL2) {
         /* Insert default filters */
-        droppedEvents.insert(SDL_TEXTINPUT);
-        droppedEvents.insert(SDL_TEXTEDITING);
-        droppedEvents.insert(SDL_SYSWMEVENT);
+        droppedEvents.set(SDL_TEXTINPUT);
+        droppedEvents.set(SDL_TEXTEDITING);
+        droppedEvents.set(SDL_SYSWMEVENT);
     }
 }
 
 void SDLEventQueue::disable(int type)
 {
-    droppedEvents.insert(type);
+    if ((type >= 0) && (type < static_cast<int>(droppedEvents.size())))
+        droppedEvents.set(type);
 }
 
 void SDLEventQueue::enable(int type)
 {
-    std::set<int>::iterator it = droppedEvents.find(type);
-    if (it != droppedEvents.end())
-        droppedEvents.erase(it);
+    if ((type >= 0) && (type < static_cast<int>(droppedEvents.size())))
+        droppedEvents.reset(type);
 }
 
 bool SDLEventQueue::isEnabled(int type)
 {
-    return droppedEvents.find(type) == droppedEvents.end();
+    if ((type < 0) || (type >= static_cast<int>(droppedEvents.size())))
+        return true;
+    return !droppedEvents.test(type);
 }
 
-#define EVENTQUEUE_MAXLEN 1024
-
 int SDLEventQueue::insert(SDL_Event* event)
 {
     /* Before inserting the event, we have some checks in a specific order */
@@ -87,19 +77,14 @@ int SDLEventQueue::insert(SDL_Event* event)
         watch.first(watch.second, event);
     }
 
-    /* 4. Check the size of the queue */
-    if (eventQueue.size() > 1024) {
+    /* 4. Push the event at the end of the queue, if there is room */
+    AnyEvent ev;
+    memcpy(&ev.ev2, event, sizeof(SDL_Event));
+    if (!eventQueue.push(ev, event->type)) {
         debuglogstdio(LCF_SDL | LCF_EVENTS, "We reached the limit of the event queue size!");
         return -1;
     }
 
-    /* Building a dynamically allocated event */
-    SDL_Event* ev = new SDL_Event;
-    memcpy(ev, event, sizeof(SDL_Event));
-
-    /* Push the event at the end of the queue */
-    eventQueue.push_back(ev);
-
     return 1;
 }
 
@@ -118,19 +103,14 @@ int SDLEventQueue::insert(SDL1::SDL_Event* event)
             return -1;
     }
 
-    /* 3. Check the size of the queue */
-    if (eventQueue.size() > 1024) {
+    /* 3. Push the event at the end of the queue, if there is room */
+    AnyEvent ev;
+    memcpy(&ev.ev1, event, sizeof(SDL1::SDL_Event));
+    if (!eventQueue.push(ev, event->type)) {
         debuglogstdio(LCF_SDL | LCF_EVENTS, "We reached the limit of the event queue size!");
         return -1;
     }
 
-    /* Building a dynamically allocated event */
-    SDL1::SDL_Event* ev = new SDL1::SDL_Event;
-    memcpy(ev, event, sizeof(SDL1::SDL_Event));
-
-    /* Push the event at the end of the queue */
-    eventQueue.push_back(ev);
-
     return 0;
 }
 
@@ -142,9 +122,14 @@ int SDLEventQueue::pop(SDL_Event* events, int num, Uint32 minType, Uint32 maxTyp
     if (num <= 0)
         return 0;
 
-    std::list<void*>::iterator it = eventQueue.begin();
-    while (it != eventQueue.end()) {
-        SDL_Event* ev = static_cast<SDL_Event*>(*it);
+    /* Games often ask for a single event type, which we can get directly
+     * from the chain of events of that type. */
+    bool singleType = (minType == maxType);
+    int i = singleType ? eventQueue.firstOfType(minType) : eventQueue.front();
+
+    while (i != eventQueue.NONE) {
+        int next = singleType ? eventQueue.nextOfType(i) : eventQueue.next(i);
+        SDL_Event* ev = &eventQueue.at(i).ev2;
 
         /* Check if event match the filter */
         if ((ev->type >= minType) && (ev->type <= maxType)) {
@@ -154,21 +139,16 @@ int SDLEventQueue::pop(SDL_Event* events, int num, Uint32 minType, Uint32 maxTyp
             evi++;
 
             if (update) {
-                /* Deleting the object and removing it from the list */
-                delete ev;
-                it = eventQueue.erase(it);
+                /* Removing the event from the queue */
+                eventQueue.erase(i);
             }
-            else
-                ++it;
 
             /* Check if we reached the limit on the number of events */
             if (evi >= num)
                 return num;
         }
-        else {
-            ++it;
-        }
 
+        i = next;
     }
 
     emptied = true;
@@ -184,9 +164,10 @@ int SDLEventQueue::pop(SDL1::SDL_Event* events, int num, Uint32 mask, bool updat
     if (num <= 0)
         return 0;
 
-    std::list<void*>::iterator it = eventQueue.begin();
-    while (it != eventQueue.end()) {
-        SDL1::SDL_Event* ev = static_cast<SDL1::SDL_Event*>(*it);
+    int i = eventQueue.front();
+    while (i != eventQueue.NONE) {
+        int next = eventQueue.next(i);
+        SDL1::SDL_Event* ev = &eventQueue.at(i).ev1;
 
         /* Check if event match the filter */
         if (mask & SDL1_EVENTMASK(ev->type)) {
@@ -196,21 +177,17 @@ int SDLEventQueue::pop(SDL1::SDL_Event* events, int num, Uint32 mask, bool updat
             evi++;
 
             if (update) {
-                /* Deleting the object and removing it from the list */
-                delete ev;
-                it = eventQueue.erase(it);
+                /* Removing the event from the queue */
+                eventQueue.erase(i);
             }
-            else
-                ++it;
 
             /* Check if we reached the limit on the number of events */
             if (evi >= num)
                 return num;
 
         }
-        else {
-            ++it;
-        }
+
+        i = next;
     }
 
     emptied = true;
@@ -220,56 +197,51 @@ int SDLEventQueue::pop(SDL1::SDL_Event* events, int num, Uint32 mask, bool updat
 
 void SDLEventQueue::flush(Uint32 minType, Uint32 maxType)
 {
-    std::list<void*>::iterator it = eventQueue.begin();
-    while (it != eventQueue.end()) {
-        SDL_Event* ev = static_cast<SDL_Event*>(*it);
+    int i = eventQueue.front();
+    while (i != eventQueue.NONE) {
+        int next = eventQueue.next(i);
+        Uint32 type = eventQueue.typeAt(i);
 
         /* Check if event match the filter */
-        if ((ev->type >= minType) && (ev->type <= maxType)) {
-            /* Deleting the object and removing it from the list */
-            delete ev;
-            it = eventQueue.erase(it);
-        }
-        else {
-            ++it;
+        if ((type >= minType) && (type <= maxType)) {
+            /* Removing the event from the queue */
+            eventQueue.erase(i);
         }
+
+        i = next;
     }
 }
 
 void SDLEventQueue::flush(Uint32 mask)
 {
-    std::list<void*>::iterator it = eventQueue.begin();
-    while (it != eventQueue.end()) {
-        SDL1::SDL_Event* ev = static_cast<SDL1::SDL_Event*>(*it);
+    int i = eventQueue.front();
+    while (i != eventQueue.NONE) {
+        int next = eventQueue.next(i);
 
         /* Check if event match the filter */
-        if (mask & SDL1_EVENTMASK(ev->type)) {
-            /* Deleting the object and removing it from the list */
-            delete ev;
-            it = eventQueue.erase(it);
-        }
-        else {
-            ++it;
+        if (mask & SDL1_EVENTMASK(eventQueue.typeAt(i))) {
+            /* Removing the event from the queue */
+            eventQueue.erase(i);
         }
+
+        i = next;
     }
 }
 
 void SDLEventQueue::applyFilter(SDL_EventFilter filter, void* userdata)
 {
-    std::list<void*>::iterator it = eventQueue.begin();
-    while (it != eventQueue.end()) {
-        SDL_Event* ev = static_cast<SDL_Event*>(*it);
+    int i = eventQueue.front();
+    while (i != eventQueue.NONE) {
+        int next = eventQueue.next(i);
 
         /* Run the filter function and check the result */
-        int isKept = filter(userdata, ev);
+        int isKept = filter(userdata, &eventQueue.at(i).ev2);
         if (!isKept) {
-            /* Deleting the object and removing it from the list */
-            delete ev;
-            it = eventQueue.erase(it);
-        }
-        else {
-            ++it;
+            /* Removing the event from the queue */
+            eventQueue.erase(i);
         }
+
+        i = next;
     }
 }
 
@@ -21,8 +21,9 @@
 #define LIBTAS_SDLEVENTQUEUE_H_INCLUDED
 
 #include "../external/SDL1.h"
+#include "../FixedEventQueue.h"
 
-#include <list>
+#include <bitset>
 #include <set>
 #include <mutex>
 #include <SDL2/SDL.h>
@@ -38,8 +39,6 @@ namespace libtas {
 class SDLEventQueue
 {
     public:
-        ~SDLEventQueue();
-
         void init();
 
         /* Try to insert an event in the queue if conditions are met.
@@ -108,8 +107,18 @@ class SDLEventQueue
         std::mutex mutex;
 
     private:
-        std::list<void*> eventQueue;
-        std::set<int> droppedEvents;
+        /* Storage for either an SDL1 or SDL2 event */
+        union AnyEvent {
+            SDL_Event ev2;
+            SDL1::SDL_Event ev1;
+        };
+
+        /* Event queue. SDL2 event types are grouped by high byte, and the
+         * bucket function of the queue spreads them */
+        FixedEventQueue<AnyEvent, EVENTQUEUE_MAXLEN, 256> eventQueue;
+
+        /* Disabled event types, indexed by type */
+        std::bitset<0x10000> droppedEvents;
         std::set<std::pair<SDL_EventFilter,void*>> watches;
         SDL1::SDL_EventFilter filterFunc1 = nullptr;
         SDL_EventFilter filterFunc = nullptr;
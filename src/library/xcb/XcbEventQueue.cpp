@@ -67,8 +67,6 @@ void XcbEventQueue::setMask(xcb_window_t wid, uint32_t event_mask)
     }
 }
 
-#define EVENTQUEUE_MAXLEN 1024
-
 int XcbEventQueue::insert(xcb_generic_event_t *event)
 {
     /* Check if the window can produce such event */
@@ -83,28 +81,25 @@ int XcbEventQueue::insert(xcb_generic_event_t *event)
     //         return 0;
     // }
 
-    /* Check the size of the queue */
-    if (eventQueue.size() > 1024) {
+    /* Push the event at the end of the queue */
+    if (!eventQueue.push(*event, event->response_type & ~0x80)) {
         debuglogstdio(LCF_EVENTS, "We reached the limit of the event queue size!");
         return -1;
     }
 
-    /* Push the event at the beginning of the queue */
-    eventQueue.push_front(*event);
-
     return 1;
 }
 
 xcb_generic_event_t* XcbEventQueue::pop()
 {
-    if (eventQueue.size() == 0)
+    int i = eventQueue.front();
+    if (i == eventQueue.NONE)
         return nullptr;
 
-    xcb_generic_event_t* ev = new xcb_generic_event_t;
-    xcb_generic_event_t event = eventQueue.back();
-    eventQueue.pop_back();
-
-    memcpy(ev, &event, sizeof(xcb_generic_event_t));
+    /* The game will free() the returned event */
+    xcb_generic_event_t* ev = static_cast<xcb_generic_event_t*>(malloc(sizeof(xcb_generic_event_t)));
+    memcpy(ev, &eventQueue.at(i), sizeof(xcb_generic_event_t));
+    eventQueue.erase(i);
     return ev;
 }
 
@@ -20,7 +20,8 @@
 #ifndef LIBTAS_XCBEVENTQUEUE_H_INCLUDED
 #define LIBTAS_XCBEVENTQUEUE_H_INCLUDED
 
-#include <list>
+#include "../FixedEventQueue.h"
+
 #include <map>
 #include <xcb/xcb.h>
 
@@ -47,8 +48,9 @@ class XcbEventQueue
         xcb_connection_t *c;
 
     private:
-        /* Event queue */
-        std::list<xcb_generic_event_t> eventQueue;
+        /* Event queue. Event types fit in 7 bits (the top bit of
+         * response_type is the send_event flag) */
+        FixedEventQueue<xcb_generic_event_t, EVENTQUEUE_MAXLEN, 128> eventQueue;
 
         /* Event mask for each Window */
         std::map<xcb_window_t, uint32_t> eventMasks;
@@ -26,13 +26,36 @@
 
 namespace libtas {
 
-XlibEventQueue::XlibEventQueue(Display* d) : display(d), emptied(false), grab_window(0) {}
+XlibEventQueue::XlibEventQueue(Display* d) : display(d), emptied(false), maskCount(0), grab_window(0) {}
+
+long* XlibEventQueue::getMask(Window w, bool create)
+{
+    for (int m = 0; m < maskCount; m++) {
+        if (maskWindows[m] == w)
+            return &eventMasks[m];
+    }
+
+    if (!create)
+        return nullptr;
+
+    if (maskCount >= MAX_MASKED_WINDOWS) {
+        debuglogstdio(LCF_EVENTS | LCF_ERROR, "Too many windows with an event mask (max %d), ignoring the mask of window %d", MAX_MASKED_WINDOWS, w);
+        return nullptr;
+    }
+
+    maskWindows[maskCount] = w;
+    eventMasks[maskCount] = 0;
+    return &eventMasks[maskCount++];
+}
 
 void XlibEventQueue::setMask(Window w, long event_mask)
 {
+    long* mask = getMask(w, true);
+    long old_mask = mask ? *mask : 0;
+
     /* If the game is interested in the EnterNotify event for the first time,
      * send one immediately */
-    if (event_mask & EnterWindowMask && (!(eventMasks[w] & EnterWindowMask))) {
+    if (event_mask & EnterWindowMask && (!(old_mask & EnterWindowMask))) {
         XEvent ev;
         ev.type = EnterNotify;
         ev.xcrossing.window = w;
@@ -53,7 +76,7 @@ void XlibEventQueue::setMask(Window w, long event_mask)
 
     /* If the game is interested in the FocusIn event for the first time,
      * send one immediately */
-    if (event_mask & FocusChangeMask && (!(eventMasks[w] & FocusChangeMask))) {
+    if (event_mask & FocusChangeMask && (!(old_mask & FocusChangeMask))) {
         XEvent ev;
         ev.type = FocusIn;
         ev.xfocus.window = w;
@@ -62,11 +85,10 @@ void XlibEventQueue::setMask(Window w, long event_mask)
         insert(&ev);
     }
 
-    eventMasks[w] = event_mask;
+    if (mask)
+        *mask = event_mask;
 }
 
-#define EVENTQUEUE_MAXLEN 1024
-
 int XlibEventQueue::insert(XEvent* event)
 {
     std::lock_guard<std::recursive_mutex> lock(mutex);
@@ -82,17 +104,14 @@ int XlibEventQueue::insert(XEvent* event)
             /* Register event to the grab window */
             event->xany.window = grab_window;
             
-            /* Check the size of the queue */
-            if (eventQueue.size() > 1024) {
-                debuglogstdio(LCF_EVENTS, "We reached the limit of the event queue size!");
-                return -1;
-            }
-
             /* Specify the display */
             event->xany.display = display;
 
-            /* Push the event at the beginning of the queue */
-            eventQueue.push_front(*event);
+            /* Push the event at the end of the queue */
+            if (!eventQueue.push(*event, event->type)) {
+                debuglogstdio(LCF_EVENTS, "We reached the limit of the event queue size!");
+                return -1;
+            }
 
             /* If grab was set with owner_events being False, only report to 
              * the grab window, or discard */
@@ -112,9 +131,9 @@ int XlibEventQueue::insert(XEvent* event)
      * so we are always returning those events */
 
     if (event->type != ConfigureNotify) {
-        auto mask = eventMasks.find(event->xany.window);
-        if (mask != eventMasks.end()) {
-            if (!isTypeOfMask(event->type, mask->second))
+        long* mask = getMask(event->xany.window, false);
+        if (mask) {
+            if (!isTypeOfMask(event->type, *mask))
             return 0;            
         }
         else {
@@ -124,34 +143,39 @@ int XlibEventQueue::insert(XEvent* event)
         }        
     }
 
-    /* Check the size of the queue */
-    if (eventQueue.size() > 1024) {
-        debuglogstdio(LCF_EVENTS, "We reached the limit of the event queue size!");
-        return -1;
-    }
-
     /* Specify the display */
     event->xany.display = display;
 
-    /* Push the event at the beginning of the queue */
-    eventQueue.push_front(*event);
+    /* Push the event at the end of the queue */
+    if (!eventQueue.push(*event, event->type)) {
+        debuglogstdio(LCF_EVENTS, "We reached the limit of the event queue size!");
+        return -1;
+    }
 
     return 1;
 }
 
+void XlibEventQueue::popAt(int i, XEvent* event)
+{
+    memcpy(event, &eventQueue.at(i), sizeof(XEvent));
+    eventQueue.erase(i);
+}
+
 bool XlibEventQueue::pop(XEvent* event, bool update)
 {
     std::lock_guard<std::recursive_mutex> lock(mutex);
 
-    if (eventQueue.size() == 0) {
+    int i = eventQueue.front();
+    if (i == eventQueue.NONE) {
         emptied = true;
         return false;
     }
 
-    XEvent ev = eventQueue.back();
-    memcpy(event, &ev, sizeof(XEvent));
     if (update) {
-        eventQueue.pop_back();
+        popAt(i, event);
+    }
+    else {
+        memcpy(event, &eventQueue.at(i), sizeof(XEvent));
     }
     return true;
 }
@@ -160,21 +184,35 @@ bool XlibEventQueue::pop(XEvent* event, Window w, long event_mask)
 {
     std::lock_guard<std::recursive_mutex> lock(mutex);
 
-    for (auto it = eventQueue.begin(); it != eventQueue.end(); ++it) {
-        XEvent ev = *it;
-        int type = ev.type;
-
-        /* Check window match */
-        if ((w != 0) && (w != ev.xany.window))
+    /* Look at the oldest matching event of each type that belongs to the
+     * mask, and keep the oldest one. */
+    int found = eventQueue.NONE;
+    for (int type = 0; type < 128; type++) {
+        if (!eventQueue.mayContainType(type))
             continue;
 
         /* Check if event type match the mask */
         if (!isTypeOfMask(type, event_mask))
             continue;
 
+        int i = eventQueue.firstOfType(type);
+
+        /* Check window match */
+        if (w != 0) {
+            while ((i != eventQueue.NONE) && (w != eventQueue.at(i).xany.window))
+                i = eventQueue.nextOfType(i);
+        }
+
+        if (i == eventQueue.NONE)
+            continue;
+
+        if ((found == eventQueue.NONE) || (eventQueue.orderAt(i) < eventQueue.orderAt(found)))
+            found = i;
+    }
+
+    if (found != eventQueue.NONE) {
         /* We found a match */
-        memcpy(event, &ev, sizeof(XEvent));
-        eventQueue.erase(it);
+        popAt(found, event);
         return true;
     }
     emptied = true;
@@ -185,20 +223,17 @@ bool XlibEventQueue::pop(XEvent* event, Window w, int event_type)
 {
     std::lock_guard<std::recursive_mutex> lock(mutex);
 
-    for (auto it = eventQueue.begin(); it != eventQueue.end(); ++it) {
-        XEvent ev = *it;
+    int i = eventQueue.firstOfType(event_type);
 
-        /* Check window match */
-        if ((w != 0) && (w != ev.xany.window))
-            continue;
-
-        /* Check if event type match */
-        if (ev.type != event_type)
-            continue;
+    /* Check window match */
+    if (w != 0) {
+        while ((i != eventQueue.NONE) && (w != eventQueue.at(i).xany.window))
+            i = eventQueue.nextOfType(i);
+    }
 
+    if (i != eventQueue.NONE) {
         /* We found a match */
-        memcpy(event, &ev, sizeof(XEvent));
-        eventQueue.erase(it);
+        popAt(i, event);
         return true;
     }
     emptied = true;
@@ -209,14 +244,14 @@ bool XlibEventQueue::pop(XEvent* event, Bool (*predicate)(Display *, XEvent *, X
 {
     std::lock_guard<std::recursive_mutex> lock(mutex);
 
-    for (auto it = eventQueue.begin(); it != eventQueue.end(); ++it) {
-        XEvent ev = *it;
+    for (int i = eventQueue.front(); i != eventQueue.NONE; i = eventQueue.next(i)) {
+        /* Pass a copy, the predicate could modify the event */
+        XEvent ev = eventQueue.at(i);
 
         /* Check the predicate */
         if (predicate(ev.xany.display, &ev, arg)) {
             /* We found a match */
-            memcpy(event, &ev, sizeof(XEvent));
-            eventQueue.erase(it);
+            popAt(i, event);
             return true;
         }
     }
@@ -228,7 +263,7 @@ int XlibEventQueue::size()
 {
     std::lock_guard<std::recursive_mutex> lock(mutex);
 
-    size_t s = eventQueue.size();
+    int s = eventQueue.size();
     if (s == 0)
         emptied = true;
     return s;
@@ -20,8 +20,8 @@
 #ifndef LIBTAS_XLIBEVENTQUEUE_H_INCLUDED
 #define LIBTAS_XLIBEVENTQUEUE_H_INCLUDED
 
-#include <list>
-#include <map>
+#include "../FixedEventQueue.h"
+
 #include <mutex>
 #include <X11/X.h>
 #include <X11/Xlib.h>
@@ -43,8 +43,10 @@ class XlibEventQueue
          * event from the queue if update is true. Returns if an event was pulled. */
         bool pop(XEvent* event, bool update);
 
-        /* Copy the first event of the queue into `event` that matches the
-         * window and event mask, and remove that event from the queue.
+        /* Copy the oldest event of the queue into `event` that matches the
+         * window and event mask, and remove that event from the queue, like
+         * XWindowEvent() does. Before events were stored in fixed storage,
+         * the most recent matching event was returned instead.
          * Returns if an event was pulled. */
         bool pop(XEvent* event, Window w, long event_mask);
 
@@ -76,14 +78,29 @@ class XlibEventQueue
         std::recursive_mutex mutex;
 
     private:
-        /* Event queue */
-        std::list<XEvent> eventQueue;
+        /* Event queue. Event types are below 128, so each type has its
+         * own bucket. */
+        FixedEventQueue<XEvent, EVENTQUEUE_MAXLEN, 128> eventQueue;
+
+        /* Maximum number of windows with an event mask. Masks of additional
+         * windows are not stored, so those windows only receive unmaskable
+         * events, and an error is logged. */
+        enum { MAX_MASKED_WINDOWS = 64 };
 
         /* Event mask for each Window */
-        std::map<Window, long> eventMasks;
+        Window maskWindows[MAX_MASKED_WINDOWS];
+        long eventMasks[MAX_MASKED_WINDOWS];
+        int maskCount;
+
+        /* Get the event mask of a window, or nullptr if not set. If `create`
+         * is true, register the window with an empty mask if needed. */
+        long* getMask(Window w, bool create);
 
         /* Does a type belong to an event mask?*/
         bool isTypeOfMask(int type, long event_mask);
+
+        /* Copy the event at index `i` into `event` and remove it from the queue */
+        void popAt(int i, XEvent* event);
         
         Window grab_window;
         unsigned int grab_event_mask;
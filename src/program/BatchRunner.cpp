@@ -0,0 +1,537 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BatchRunner.h"
+#include "GameLoop.h"
+#include "GameEvents.h"
+#include "Context.h"
+#include "utils.h"
+#include "ui/ErrorChecking.h"
+#include "ramsearch/MemAccess.h"
+#include "movie/MovieFile.h"
+
+#include "../shared/SharedConfig.h"
+#include "../shared/sockethelpers.h"
+#include "../shared/messages.h"
+
+#include <QString>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <future>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <climits> // PATH_MAX
+#include <unistd.h>
+#include <sys/wait.h>
+#if defined(__APPLE__) && defined(__MACH__)
+#include <mach-o/dyld.h> // _NSGetExecutablePath
+#endif
+
+/* Escape a string to be printed inside a JSON report */
+static std::string escape(const std::string& str)
+{
+    std::ostringstream oss;
+    for (char c : str) {
+        switch (c) {
+            case '"': oss << "\\\""; break;
+            case '\\': oss << "\\\\"; break;
+            case '\n': oss << "\\n"; break;
+            case '\t': oss << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                    oss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+                else
+                    oss << c;
+        }
+    }
+    return oss.str();
+}
+
+BatchRunner::BatchRunner(Context *c) : context(c) {}
+
+bool BatchRunner::addChecksumRange(const char* str)
+{
+    uint64_t addr, size;
+    if (!parseMemoryRange(str, &addr, &size))
+        return false;
+
+    Range range;
+    range.addr = addr;
+    range.size = size;
+    ranges.push_back(range);
+    return true;
+}
+
+bool BatchRunner::setExpectedChecksum(const char* str)
+{
+    char* end;
+    expected_checksum = std::strtoull(str, &end, 16);
+    if ((end == str) || (*end != '\0'))
+        return false;
+
+    has_expected_checksum = true;
+    return true;
+}
+
+bool BatchRunner::setDumpRange(const char* str)
+{
+    char* end;
+    dump_start = std::strtoull(str, &end, 10);
+    if ((end == str) || (*end != ':'))
+        return false;
+
+    const char* endstr = end + 1;
+    dump_end = std::strtoull(endstr, &end, 10);
+    if ((end == endstr) || (*end != '\0') || (dump_end <= dump_start))
+        return false;
+
+    has_dump_range = true;
+    return true;
+}
+
+bool BatchRunner::setParallelJobs(const char* str)
+{
+    char* end;
+    long jobs = std::strtol(str, &end, 10);
+    if ((end == str) || (*end != '\0') || (jobs < 1) || (jobs > 256))
+        return false;
+
+    parallel_jobs = static_cast<int>(jobs);
+    return true;
+}
+
+void BatchRunner::connectGameLoop(GameLoop *gameLoop)
+{
+    /* Nobody can answer questions, so we always answer no. Answering yes
+     * would save the movie file or load another movie. */
+    auto answerNo = [](QString str, void* promise) {
+        std::cerr << str.toStdString() << " No" << std::endl;
+        static_cast<std::promise<bool>*>(promise)->set_value(false);
+    };
+    auto printAlert = [](QString str) {
+        std::cerr << str.toStdString() << std::endl;
+    };
+
+    QObject::connect(gameLoop, &GameLoop::askToShow, answerNo);
+    QObject::connect(gameLoop->gameEvents, &GameEvents::askToShow, answerNo);
+    QObject::connect(gameLoop, &GameLoop::alertToShow, printAlert);
+    QObject::connect(gameLoop->gameEvents, &GameEvents::alertToShow, printAlert);
+
+    /* This signal is emitted while the game is waiting at a frame boundary,
+     * so its memory is not modified while we are reading it */
+    QObject::connect(gameLoop, &GameLoop::uiChanged, [this] {
+        last_framecount = context->framecount;
+
+        if (has_dump_range) {
+            /* Start encoding at the frame boundary of the beginning of the
+             * range, like the toggle encode hotkey does. The game receives
+             * the config now and encodes starting with the next frame. */
+            if (!dump_started && (context->framecount == dump_start)) {
+                dump_started = true;
+                context->config.sc.av_dumping = true;
+                context->config.sc_modified = true;
+                context->config.dumpfile_modified = true;
+            }
+
+            /* The last frame of the range was just encoded, so we stop the
+             * encode right away and quit */
+            if ((context->framecount >= dump_end) && (context->status != Context::QUITTING)) {
+                context->config.sc.av_dumping = false;
+                context->config.sc_modified = true;
+                sendMessage(MSGN_STOP_ENCODE);
+                context->status = Context::QUITTING;
+            }
+        }
+
+        /* The game quits when advancing to the last frame of the movie, so
+         * the frame before it is the last frame boundary that we see */
+        if (!has_checksum && !ranges.empty() &&
+            ((context->framecount + 1) >= context->config.sc.movie_framecount))
+            computeChecksum();
+    });
+}
+
+void BatchRunner::computeChecksum()
+{
+    static const uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+    static const uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+    uint8_t buf[4096];
+    checksum = FNV_OFFSET;
+
+    for (const Range& range : ranges) {
+        size_t offset = 0;
+        while (offset < range.size) {
+            size_t size = range.size - offset;
+            if (size > sizeof(buf))
+                size = sizeof(buf);
+
+            size_t ret = MemAccess::read(buf, reinterpret_cast<void*>(range.addr + offset), size);
+            if (ret != size) {
+                std::cerr << "Could not read game memory at address " << std::hex << (range.addr + offset) << std::dec << std::endl;
+                checksum_error = true;
+                has_checksum = true;
+                return;
+            }
+
+            for (size_t i = 0; i < size; i++) {
+                checksum ^= buf[i];
+                checksum *= FNV_PRIME;
+            }
+            offset += size;
+        }
+    }
+
+    has_checksum = true;
+}
+
+int BatchRunner::run()
+{
+    if (context->config.sc.recording != SharedConfig::RECORDING_READ) {
+        std::cerr << "Batch mode requires a movie to play" << std::endl;
+        printReport("error", 0);
+        return EXIT_ERROR;
+    }
+
+    if (!ErrorChecking::allChecks(context)) {
+        printReport("error", 0);
+        return EXIT_ERROR;
+    }
+
+    if ((parallel_jobs > 1) || has_dump_range) {
+        if (!context->config.dumping) {
+            std::cerr << "Encoding a range of the movie requires a dump file" << std::endl;
+            printReport("error", 0);
+            return EXIT_ERROR;
+        }
+    }
+
+    if ((parallel_jobs > 1) && !has_dump_range)
+        return runParallel();
+
+    /* Play the movie as fast as possible, with dumping if specified */
+    context->config.sc.running = true;
+    context->config.sc.fastforward = true;
+    context->config.sc.av_dumping = context->config.dumping;
+
+    if (has_dump_range) {
+        /* Start encoding when reaching the beginning of the range, and quit
+         * the game at the end of the range */
+        dump_started = (dump_start == 0);
+        context->config.sc.av_dumping = dump_started;
+
+        /* We quit ourselves at the end of the range, which may be the last
+         * frame of the movie, so the game must not quit before that */
+        context->pause_frame = dump_end + 1;
+
+        /* Use our own socket and movie directory, so that other processes
+         * can play the same game at the same time */
+        std::string socketpath = "/tmp/libTAS-";
+        socketpath += std::to_string(getpid());
+        socketpath += ".socket";
+        setenv("LIBTAS_SOCKET_PATH", socketpath.c_str(), 1);
+
+        context->config.tempmoviedir += "/range";
+        context->config.tempmoviedir += std::to_string(dump_start);
+        if (create_dir(context->config.tempmoviedir) < 0) {
+            std::cerr << "Cannot create dir " << context->config.tempmoviedir << std::endl;
+            printReport("error", 0);
+            return EXIT_ERROR;
+        }
+    }
+    context->config.sc.sigint_upon_launch = false;
+    context->config.sc_modified = true;
+
+    GameLoop* gameLoop = new GameLoop(context);
+    connectGameLoop(gameLoop);
+
+    auto start = std::chrono::steady_clock::now();
+
+    /* The game loop returns when the game exits, and must be started again
+     * if the movie asked for a restart */
+    context->status = Context::STARTING;
+    do {
+        gameLoop->start();
+    } while (context->status == Context::RESTARTING);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    first_desync = gameLoop->movie.hashes->first_desync;
+
+    delete gameLoop;
+
+    /* When playing the whole movie, the last frame boundary is the one
+     * before the last movie frame. When encoding a range, we quit at the
+     * boundary of the end of the range. */
+    bool complete = has_dump_range ? (last_framecount >= dump_end) :
+        ((last_framecount + 1) >= context->config.sc.movie_framecount);
+    if (!complete) {
+        printReport("incomplete", elapsed.count());
+        return EXIT_DESYNC;
+    }
+
+    if (checksum_error) {
+        printReport("error", elapsed.count());
+        return EXIT_ERROR;
+    }
+
+    if ((first_desync != -1) ||
+        (has_expected_checksum && (!has_checksum || (checksum != expected_checksum)))) {
+        printReport("desync", elapsed.count());
+        return EXIT_DESYNC;
+    }
+
+    printReport("sync", elapsed.count());
+    return EXIT_SYNC;
+}
+
+int BatchRunner::runParallel()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    /* Load the movie to get its length */
+    MovieFile movie(context);
+    int ret = movie.loadMovie();
+    if (ret < 0) {
+        std::cerr << MovieFile::errorString(ret) << std::endl;
+        printReport("error", 0);
+        return EXIT_ERROR;
+    }
+
+    uint64_t frames = context->config.sc.movie_framecount;
+    int jobs = parallel_jobs;
+    if (static_cast<uint64_t>(jobs) > frames)
+        jobs = static_cast<int>(frames);
+    if (jobs < 1) {
+        std::cerr << "Movie is empty" << std::endl;
+        printReport("error", 0);
+        return EXIT_ERROR;
+    }
+
+    /* Path of our own executable, used to start the processes */
+    char buf[PATH_MAX];
+#ifdef __unix__
+    ssize_t count = readlink("/proc/self/exe", buf, PATH_MAX);
+    std::string exepath(buf, (count > 0) ? count : 0);
+#elif defined(__APPLE__) && defined(__MACH__)
+    uint32_t size = PATH_MAX;
+    std::string exepath;
+    if (_NSGetExecutablePath(buf, &size) == 0)
+        exepath = buf;
+#endif
+    if (exepath.empty()) {
+        std::cerr << "Could not get path of libTAS executable" << std::endl;
+        printReport("error", 0);
+        return EXIT_ERROR;
+    }
+
+    /* Segment files are named after the dump file */
+    const std::string& dumpfile = context->config.dumpfile;
+    size_t dot = dumpfile.find_last_of('.');
+    if ((dot == std::string::npos) || (dot < dumpfile.find_last_of('/') + 1)) {
+        std::cerr << "Dump file " << dumpfile << " has no extension" << std::endl;
+        printReport("error", 0);
+        return EXIT_ERROR;
+    }
+
+    std::vector<std::string> segments;
+    std::vector<pid_t> pids;
+    for (int j = 0; j < jobs; j++) {
+        uint64_t range_start = frames * j / jobs;
+        uint64_t range_end = frames * (j + 1) / jobs;
+
+        std::string segment = dumpfile.substr(0, dot) + "_part" + std::to_string(j) + dumpfile.substr(dot);
+        segments.push_back(segment);
+
+        std::string range = std::to_string(range_start) + ":" + std::to_string(range_end);
+        std::vector<std::string> args = {exepath, "--batch",
+            "--read", context->config.moviefile,
+            "--dump", segment,
+            "--dump-range", range,
+            "--libtas-so-path", context->libtaspath};
+        if (!context->libtas32path.empty()) {
+            args.push_back("--libtas32-so-path");
+            args.push_back(context->libtas32path);
+        }
+        args.push_back(context->gamepath);
+        if (!context->config.gameargs.empty())
+            args.push_back(context->config.gameargs);
+
+        std::cerr << "Encoding frames " << range << " into " << segment << std::endl;
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            /* The standard output is only used by our report */
+            dup2(STDERR_FILENO, STDOUT_FILENO);
+
+            std::vector<char*> argv;
+            for (std::string& arg : args)
+                argv.push_back(const_cast<char*>(arg.c_str()));
+            argv.push_back(nullptr);
+
+            execv(argv[0], argv.data());
+            std::cerr << "Could not start " << argv[0] << std::endl;
+            _exit(EXIT_ERROR);
+        }
+        if (pid < 0) {
+            std::cerr << "Could not fork" << std::endl;
+            break;
+        }
+        pids.push_back(pid);
+    }
+
+    /* Wait for all segments to be encoded */
+    int status_code = EXIT_SYNC;
+    if (pids.size() != segments.size())
+        status_code = EXIT_ERROR;
+
+    for (size_t j = 0; j < pids.size(); j++) {
+        int status;
+        waitpid(pids[j], &status, 0);
+        int code = WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_ERROR;
+        if (code == EXIT_SYNC) {
+            last_framecount += frames * (j + 1) / jobs - frames * j / jobs;
+        }
+        else {
+            std::cerr << "Segment " << segments[j] << " failed" << std::endl;
+            if (status_code == EXIT_SYNC)
+                status_code = code;
+        }
+    }
+
+    if ((status_code == EXIT_SYNC) && !concatSegments(segments))
+        status_code = EXIT_ERROR;
+
+    /* Each frame of the movie must have been encoded exactly once. This can
+     * only be checked when each frame is sent as a single video frame. */
+    if ((status_code == EXIT_SYNC) &&
+        !context->config.sc.variable_framerate &&
+        !context->config.sc.video_skip_duplicates) {
+
+        std::ostringstream cmd;
+        cmd << "ffprobe -v error -select_streams v:0 -count_packets";
+        cmd << " -show_entries stream=nb_read_packets -of csv=p=0";
+        cmd << " \"" << context->config.dumpfile << "\"";
+
+        int status = -1;
+        std::string count = queryCmd(cmd.str(), &status);
+        uint64_t encoded_frames = std::strtoull(count.c_str(), nullptr, 10);
+        if (status != 0) {
+            std::cerr << "Could not count the frames of " << context->config.dumpfile << std::endl;
+        }
+        else if (encoded_frames != frames) {
+            std::cerr << "Encode has " << encoded_frames << " frames instead of " << frames << std::endl;
+            status_code = EXIT_ERROR;
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    switch (status_code) {
+        case EXIT_SYNC:
+            printReport("sync", elapsed.count());
+            break;
+        case EXIT_DESYNC:
+            printReport("desync", elapsed.count());
+            break;
+        default:
+            status_code = EXIT_ERROR;
+            printReport("error", elapsed.count());
+            break;
+    }
+    return status_code;
+}
+
+bool BatchRunner::concatSegments(const std::vector<std::string>& segments)
+{
+    const std::string& dumpfile = context->config.dumpfile;
+    std::string listfile = dumpfile + ".segments.txt";
+
+    /* A segment may have been split into more files if the game restarted */
+    std::vector<std::string> files;
+    for (const std::string& segment : segments) {
+        files.push_back(segment);
+        size_t dot = segment.find_last_of('.');
+        for (int n = 1; ; n++) {
+            std::string file = segment.substr(0, dot) + "_" + std::to_string(n) + segment.substr(dot);
+            if (access(file.c_str(), F_OK) != 0)
+                break;
+            files.push_back(file);
+        }
+    }
+
+    /* List of files for the concat demuxer, with single quotes escaped */
+    std::ofstream list(listfile);
+    for (const std::string& file : files) {
+        list << "file '";
+        for (char c : file) {
+            if (c == '\'')
+                list << "'\\''";
+            else
+                list << c;
+        }
+        list << "'" << std::endl;
+    }
+    list.close();
+
+    std::ostringstream oss;
+    oss << "ffmpeg -hide_banner -y -f concat -safe 0 -i \"" << listfile << "\" -c copy \"" << dumpfile << "\"";
+
+    int ret = system(oss.str().c_str());
+    if (!WIFEXITED(ret) || (WEXITSTATUS(ret) != 0)) {
+        std::cerr << "Could not concatenate segments, they are kept in " << listfile << std::endl;
+        return false;
+    }
+
+    for (const std::string& file : files)
+        unlink(file.c_str());
+    unlink(listfile.c_str());
+    return true;
+}
+
+void BatchRunner::printReport(const char* status, double elapsed)
+{
+    std::ostringstream oss;
+    oss << "{\"status\": \"" << status << "\"";
+    oss << ", \"movie\": \"" << escape(context->config.moviefile) << "\"";
+    oss << ", \"movie_frames\": " << context->config.sc.movie_framecount;
+    oss << ", \"frames\": " << last_framecount;
+    oss << ", \"rerecords\": " << context->rerecord_count;
+    if (first_desync != -1)
+        oss << ", \"first_desync\": " << first_desync;
+    if (context->config.dumping)
+        oss << ", \"dump\": \"" << escape(context->config.dumpfile) << "\"";
+    if (has_dump_range)
+        oss << ", \"dump_range\": [" << dump_start << ", " << dump_end << "]";
+    if (parallel_jobs > 1)
+        oss << ", \"jobs\": " << parallel_jobs;
+    if (has_checksum && !checksum_error)
+        oss << ", \"checksum\": \"" << std::hex << std::setw(16) << std::setfill('0') << checksum << std::dec << "\"";
+    if (has_expected_checksum)
+        oss << ", \"expected_checksum\": \"" << std::hex << std::setw(16) << std::setfill('0') << expected_checksum << std::dec << "\"";
+    oss << std::fixed << std::setprecision(3);
+    oss << ", \"elapsed\": " << elapsed;
+    if (elapsed > 0)
+        oss << ", \"fps\": " << (last_framecount / elapsed);
+    oss << "}";
+
+    std::cout << oss.str() << std::endl;
+}
@@ -0,0 +1,123 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_BATCHRUNNER_H_INCLUDED
+#define LIBTAS_BATCHRUNNER_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/* Forward declaration */
+struct Context;
+class GameLoop;
+
+/* Plays a movie without any user interface, for verifying movies or encoding
+ * them on headless machines. The game loop is executed directly in the
+ * calling thread, with the movie played in fast-forward until its last frame.
+ * When the movie ends, a checksum of a list of memory ranges of the game can
+ * be computed and compared with an expected value. If the movie contains
+ * per-frame state hashes, the first frame that does not match is reported. A report is printed on the
+ * standard output as a single JSON object.
+ *
+ * Long movies can be encoded in parallel: the movie is split into segments,
+ * and each segment is encoded by another libTAS process in batch mode, which
+ * plays the movie without encoding until the start of its segment. Segments
+ * are then concatenated without re-encoding.
+ */
+class BatchRunner {
+public:
+    /* Exit codes of the program */
+    enum ExitCode {
+        EXIT_SYNC = 0,
+        EXIT_DESYNC = 1,
+        EXIT_ERROR = 2,
+    };
+
+    BatchRunner(Context *c);
+
+    /* Add a memory range to be hashed at the end of the movie, in the form
+     * ADDR:SIZE, with both values in hexadecimal. Returns false if the string
+     * could not be parsed. */
+    bool addChecksumRange(const char* str);
+
+    /* Set the expected checksum, in hexadecimal. Returns false if the string
+     * could not be parsed. */
+    bool setExpectedChecksum(const char* str);
+
+    /* Only encode the frames between START and END, in the form START:END,
+     * and quit the game at frame END. Returns false if the string could not
+     * be parsed. */
+    bool setDumpRange(const char* str);
+
+    /* Set the number of processes encoding segments of the movie in
+     * parallel. Returns false if the string could not be parsed. */
+    bool setParallelJobs(const char* str);
+
+    /* Play the movie and print the report. Returns one of the exit codes */
+    int run();
+
+private:
+    Context *context;
+
+    struct Range {
+        uintptr_t addr;
+        size_t size;
+    };
+    std::vector<Range> ranges;
+
+    bool has_expected_checksum = false;
+    uint64_t expected_checksum = 0;
+
+    bool has_checksum = false;
+    bool checksum_error = false;
+    uint64_t checksum = 0;
+
+    /* Last frame count reached by the game */
+    uint64_t last_framecount = 0;
+
+    /* First frame where the state hash did not match the movie, or -1 */
+    int64_t first_desync = -1;
+
+    /* Range of frames to encode */
+    bool has_dump_range = false;
+    bool dump_started = false;
+    uint64_t dump_start = 0;
+    uint64_t dump_end = 0;
+
+    /* Number of processes encoding in parallel */
+    int parallel_jobs = 1;
+
+    /* Connect the signals of the game loop that expect an answer */
+    void connectGameLoop(GameLoop *gameLoop);
+
+    /* Hash all memory ranges of the game using FNV-1a */
+    void computeChecksum();
+
+    /* Split the encode into segments played by other processes, and
+     * concatenate them at the end */
+    int runParallel();
+
+    /* Concatenate the segment files into the dump file using ffmpeg */
+    bool concatSegments(const std::vector<std::string>& segments);
+
+    void printReport(const char* status, double elapsed);
+};
+
+#endif
@@ -23,39 +23,20 @@
 #include <list>
 #include <mutex>
 
-/* Thread-safe queue, will be used for a single producer/single consumer model
+/* Thread-safe queue, used when elements can be pushed by several threads.
+ * When there is a single producer thread, use SPSCQueue instead.
  * taken from https://juanchopanzacpp.wordpress.com/2013/02/26/concurrent-queue-c11/
  */
 template <typename T>
 class ConcurrentQueue {
 public:
 
-    bool empty() const
+    bool empty()
     {
-        /* We should not need to protect this function with a mutex */
+        std::unique_lock<std::mutex> mlock(mutex_);
         return queue_.empty();
     }
 
-    typename std::list<T>::const_iterator begin()
-    {
-        return queue_.cbegin();
-    }
-
-    typename std::list<T>::const_iterator end()
-    {
-        return queue_.cend();
-    }
-    
-    void lock()
-    {
-        mutex_.lock();
-    }
-
-    void unlock()
-    {
-        mutex_.unlock();
-    }
-
     void pop(T& item)
     {
         std::unique_lock<std::mutex> mlock(mutex_);
@@ -69,9 +50,16 @@ public:
         queue_.push_back(item);
     }
 
-    const T& back(void)
+    /* Copy the last element, and returns false if the queue is empty. We
+     * don't return a reference, because the element may be popped by the
+     * other thread */
+    bool back(T& item)
     {
-        return queue_.back();
+        std::unique_lock<std::mutex> mlock(mutex_);
+        if (queue_.empty())
+            return false;
+        item = queue_.back();
+        return true;
     }
 
     ConcurrentQueue()=default;
@@ -160,6 +160,9 @@ void Config::save(const std::string& gamepath) {
     settings.setValue("video_codec", sc.video_codec);
     settings.setValue("video_bitrate", sc.video_bitrate);
     settings.setValue("video_framerate", sc.video_framerate);
+    settings.setValue("video_downscale", sc.video_downscale);
+    settings.setValue("video_yuv_conversion", sc.video_yuv_conversion);
+    settings.setValue("video_skip_duplicates", sc.video_skip_duplicates);
     settings.setValue("audio_codec", sc.audio_codec);
     settings.setValue("audio_bitrate", sc.audio_bitrate);
     settings.setValue("locale", sc.locale);
@@ -335,6 +338,9 @@ void Config::load(const std::string& gamepath) {
     sc.video_codec = settings.value("video_codec", sc.video_codec).toInt();
     sc.video_bitrate = settings.value("video_bitrate", sc.video_bitrate).toInt();
     sc.video_framerate = settings.value("video_framerate", sc.video_framerate).toInt();
+    sc.video_downscale = settings.value("video_downscale", sc.video_downscale).toInt();
+    sc.video_yuv_conversion = settings.value("video_yuv_conversion", sc.video_yuv_conversion).toBool();
+    sc.video_skip_duplicates = settings.value("video_skip_duplicates", sc.video_skip_duplicates).toBool();
     sc.audio_codec = settings.value("audio_codec", sc.audio_codec).toInt();
     sc.audio_bitrate = settings.value("audio_bitrate", sc.audio_bitrate).toInt();
     sc.savestate_settings = settings.value("savestate_settings", sc.savestate_settings).toInt();
@@ -29,6 +29,8 @@
 #elif defined(__APPLE__) && defined(__MACH__)
 #endif
 #include <string>
+#include <vector>
+#include <utility>
 #include <stdint.h>
 
 struct Context {
@@ -135,6 +137,16 @@ struct Context {
 
     /* Interactive mode */
     bool interactive = true;
+
+    /* Batch mode, where the game loop runs without user interface */
+    bool batch = false;
+
+    /* Memory ranges (address, size) hashed by the game at each frame when
+     * recording a movie */
+    std::vector<std::pair<uint64_t, uint64_t>> state_hash_ranges;
+
+    /* File where the performance counters of each frame are exported */
+    std::string perf_export_file;
     
     /* Indicate if the current frame is a draw frame */
     bool draw_frame;
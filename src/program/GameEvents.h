@@ -54,6 +54,16 @@ public:
      */
     virtual bool haveFocus() = 0;
 
+    /* Perform a savestate in a slot. Returns if saving succeeded */
+    bool saveState(int slot);
+
+    /* Load a savestate from a slot, or load it as a branch. Returns if
+     * loading succeeded */
+    bool loadState(int slot, bool branch);
+
+    /* Remove a savestate and free its memory */
+    void freeState(int slot);
+
     /* Indicate if at least one savestate was performed, for backtrack savestate */
     bool didASavestate = false;
 
@@ -37,6 +37,8 @@
 #include "SaveStateList.h"
 #include "lua/Input.h"
 #include "lua/Callbacks.h"
+#include "lua/Gui.h"
+#include "lua/Savestate.h"
 #include "lua/NamedLuaFunction.h"
 #include "ramsearch/MemAccess.h"
 #include "ui/InputEditorView.h"
@@ -73,6 +75,8 @@ void GameLoop::start()
     init();
     initProcessMessages();
 
+    Lua::Savestate::registerGameEvents(gameEvents);
+    Lua::Gui::resetDrawList();
     Lua::Callbacks::call(Lua::NamedLuaFunction::CallbackStartup);
 
     while (1)
@@ -249,6 +253,16 @@ void GameLoop::init()
         }
     }
 
+    /* Export performance counters of the game */
+    if ((context->status != Context::RESTARTING) && !context->perf_export_file.empty())
+        perfMonitor.open(context->perf_export_file);
+
+    /* Memory ranges to hash at each frame. When playing a movie, we keep the
+     * ranges stored in the movie, so that hashes can be compared */
+    if ((context->config.sc.recording == SharedConfig::RECORDING_WRITE) &&
+        movie.hashes->ranges.empty())
+        movie.hashes->ranges = context->state_hash_ranges;
+
     /* Detect common game engines and load some known settings. This is done
      * before forking, because it can modify settings used by both the game
      * process (env variables, commandline-options) and the libtas program
@@ -355,6 +369,15 @@ void GameLoop::initProcessMessages()
     context->config.sc.initial_time_sec = it.tv_sec;
     context->config.sc.initial_time_nsec = it.tv_nsec;
 
+    /* Send memory ranges to hash at each frame */
+    if (context->config.sc.recording != SharedConfig::NO_RECORDING) {
+        for (const auto& range : movie.hashes->ranges) {
+            sendMessage(MSGN_STATE_HASH_RANGE);
+            sendData(&range.first, sizeof(uint64_t));
+            sendData(&range.second, sizeof(uint64_t));
+        }
+    }
+
     /* Send initial framecount and elapsed time */
     sendMessage(MSGN_INITIAL_FRAMECOUNT_TIME);
     sendData(&context->framecount, sizeof(uint64_t));
@@ -508,6 +531,36 @@ bool GameLoop::startFrameMessages()
             }
 
             break;
+        case MSGB_STATE_HASH:
+        {
+            uint64_t hash;
+            receiveData(&hash, sizeof(uint64_t));
+
+            if (context->config.sc.recording == SharedConfig::RECORDING_WRITE) {
+                movie.hashes->setHash(context->framecount, hash);
+            }
+            else if (context->config.sc.recording == SharedConfig::RECORDING_READ) {
+                bool first = (movie.hashes->first_desync == -1);
+                if (!movie.hashes->checkHash(context->framecount, hash) && first)
+                    emit alertToShow(QString("State hash mismatch: the movie desynced at frame %1").arg(context->framecount));
+            }
+            break;
+        }
+        case MSGB_AUDIO_HASH:
+        {
+            uint64_t hash;
+            receiveData(&hash, sizeof(uint64_t));
+
+            if (context->config.sc.recording == SharedConfig::RECORDING_WRITE) {
+                movie.hashes->setAudioHash(context->framecount, hash);
+            }
+            else if (context->config.sc.recording == SharedConfig::RECORDING_READ) {
+                bool first = (movie.hashes->first_desync == -1);
+                if (!movie.hashes->checkAudioHash(context->framecount, hash) && first)
+                    emit alertToShow(QString("Audio fingerprint mismatch: the movie desynced at frame %1").arg(context->framecount));
+            }
+            break;
+        }
         case MSGB_GAMEINFO:
             receiveData(&game_info, sizeof(game_info));
             emit gameInfoChanged(game_info);
@@ -558,8 +611,9 @@ bool GameLoop::startFrameMessages()
             break;
         }
         case MSGB_QUIT:
-            if (!context->interactive) {
-                /* Exit the program when game has exit */
+            if (!context->interactive && !context->batch) {
+                /* Exit the program when game has exit. In batch mode, we
+                 * return from the game loop to be able to report. */
                 exit(0);
             }
             return true;
@@ -580,6 +634,12 @@ bool GameLoop::startFrameMessages()
      * is a draw frame or not */
     movie.editor->setDraw(context->draw_frame);
 
+    /* The game is waiting, we can read its performance counters */
+    perfMonitor.update();
+
+    /* Messages until the end of the frame boundary are sent in a single write */
+    beginMessageBatch();
+
     /* Send ram watches */
     if (context->config.sc.osd) {
         std::string ramwatch;
@@ -591,10 +651,12 @@ bool GameLoop::startFrameMessages()
         }
     }
 
-    /* Execute the lua callback onPaint here */
+    /* Execute the lua callback onPaint here, and send its drawings */
     Lua::Callbacks::call(Lua::NamedLuaFunction::CallbackPaint);
+    Lua::Gui::sendDrawList();
 
     sendMessage(MSGN_START_FRAMEBOUNDARY);
+    flushMessageBatch();
 
     return false;
 }
@@ -828,6 +890,9 @@ void GameLoop::processInputs(AllInputs &ai)
 
 void GameLoop::endFrameMessages(AllInputs &ai)
 {
+    /* All messages are sent in a single write */
+    beginMessageBatch();
+
     /* If the user stopped the game with the Stop button, don't write back
      * savefiles.*/
     if (context->status == Context::QUITTING) {
@@ -865,6 +930,7 @@ void GameLoop::endFrameMessages(AllInputs &ai)
     }
 
     sendMessage(MSGN_END_FRAMEBOUNDARY);
+    flushMessageBatch();
 }
 
 void GameLoop::loopExit()
@@ -923,6 +989,7 @@ void GameLoop::loopExit()
     }
 
     movie.close();
+    perfMonitor.close();
     closeSocket();
 
     /* Remove savestates because they are invalid on future instances of the game */
@@ -24,6 +24,7 @@
 #include <cstdint>
 
 #include "movie/MovieFile.h"
+#include "PerfMonitor.h"
 #include "../shared/GameInfo.h"
 
 /* Forward declaration */
@@ -45,6 +46,9 @@ public:
     /* Handle hotkeys */
     GameEvents* gameEvents;
 
+    /* Performance counters of the game */
+    PerfMonitor perfMonitor;
+
 private:
     Context* context;
 
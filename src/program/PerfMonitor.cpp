@@ -0,0 +1,137 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PerfMonitor.h"
+
+#include "../shared/sockethelpers.h"
+
+#include <iostream>
+
+bool PerfMonitor::open(const std::string& path)
+{
+    close();
+
+    out.open(path, std::ios::trunc);
+    if (!out) {
+        std::cerr << "Could not open performance export file " << path << std::endl;
+        return false;
+    }
+
+    json = (path.size() >= 5) && (path.compare(path.size() - 5, 5, ".json") == 0);
+    first_event = true;
+    trace_ts = 0;
+
+    if (json) {
+        out << "{\"traceEvents\": [\n";
+    }
+    else {
+        out << "frame";
+        for (int c = 0; c < PerfCounters::COUNTER_COUNT; c++)
+            out << "," << PerfCounters::name(c) << "_us," << PerfCounters::name(c) << "_calls";
+        out << "\n";
+    }
+    return true;
+}
+
+void PerfMonitor::close()
+{
+    if (!out.is_open())
+        return;
+
+    if (json)
+        out << "\n]}\n";
+    out.close();
+}
+
+void PerfMonitor::update()
+{
+    const PerfCounters* counters = getSharedPerfCounters();
+    if (!counters)
+        return;
+
+    PerfCounters::Data data;
+    if (!counters->read(data))
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        last = data;
+        has_last = true;
+    }
+
+    if (!out.is_open())
+        return;
+
+    if (json)
+        writeJson(data);
+    else
+        writeCsv(data);
+}
+
+bool PerfMonitor::get(PerfCounters::Data& data)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!has_last)
+        return false;
+    data = last;
+    return true;
+}
+
+void PerfMonitor::writeCsv(const PerfCounters::Data& data)
+{
+    out << data.framecount;
+    for (int c = 0; c < PerfCounters::COUNTER_COUNT; c++)
+        out << "," << (data.values[c].frame_ns / 1000) << "," << data.values[c].frame_calls;
+    out << "\n";
+}
+
+void PerfMonitor::writeJson(const PerfCounters::Data& data)
+{
+    /* Each frame is a complete event, and the timers of the frame are laid
+     * out one after the other inside it, so that the trace viewer shows
+     * where the time of each frame went. Call counts are counter events. */
+    uint64_t frame_us = 0;
+    for (int c = 0; c < PerfCounters::SAVESTATE; c++)
+        frame_us += data.values[c].frame_ns / 1000;
+
+    if (!first_event)
+        out << ",\n";
+    first_event = false;
+
+    out << "{\"name\": \"frame " << data.framecount << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": "
+        << trace_ts << ", \"dur\": " << frame_us << "}";
+
+    uint64_t ts = trace_ts;
+    for (int c = 0; c < PerfCounters::SAVESTATE; c++) {
+        uint64_t us = data.values[c].frame_ns / 1000;
+        if (us == 0)
+            continue;
+        out << ",\n{\"name\": \"" << PerfCounters::name(c) << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": 2, \"ts\": "
+            << ts << ", \"dur\": " << us << "}";
+        ts += us;
+    }
+
+    for (int c = PerfCounters::SAVESTATE; c < PerfCounters::COUNTER_COUNT; c++) {
+        out << ",\n{\"name\": \"" << PerfCounters::name(c) << "\", \"ph\": \"C\", \"pid\": 1, \"ts\": "
+            << trace_ts << ", \"args\": {\"us\": " << (data.values[c].frame_ns / 1000)
+            << ", \"calls\": " << data.values[c].frame_calls << "}}";
+    }
+
+    trace_ts += frame_us;
+}
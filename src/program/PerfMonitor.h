@@ -0,0 +1,65 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_PERFMONITOR_H_INCLUDED
+#define LIBTAS_PERFMONITOR_H_INCLUDED
+
+#include "../shared/PerfCounters.h"
+
+#include <string>
+#include <fstream>
+#include <mutex>
+
+/* Collects the performance counters of the game at each frame boundary,
+ * keeps the last values for the UI, and optionally exports them for each
+ * frame into a CSV file, or a Chrome trace JSON file if the file name
+ * ends with .json.
+ */
+class PerfMonitor {
+public:
+    /* Start exporting counters into a file */
+    bool open(const std::string& path);
+
+    /* Stop exporting */
+    void close();
+
+    /* Read the counters from the shared memory. Must be called while the
+     * game is waiting at the frame boundary. */
+    void update();
+
+    /* Get the counters of the last frame. Returns false if none. */
+    bool get(PerfCounters::Data& data);
+
+private:
+    std::mutex mutex;
+    PerfCounters::Data last;
+    bool has_last = false;
+
+    std::ofstream out;
+    bool json = false;
+    bool first_event = true;
+
+    /* Timestamp of the next frame in the trace, in microseconds */
+    uint64_t trace_ts = 0;
+
+    void writeCsv(const PerfCounters::Data& data);
+    void writeJson(const PerfCounters::Data& data);
+};
+
+#endif
@@ -0,0 +1,125 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_SPSCQUEUE_H_INCLUDED
+#define LIBTAS_SPSCQUEUE_H_INCLUDED
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <cstddef>
+
+/* Queue with a single producer thread and a single consumer thread.
+ * Elements are stored in a preallocated ring buffer, so that pushing and
+ * popping never take a lock nor allocate memory.
+ *
+ * When the ring is full (e.g. clearing an input over a long movie), elements
+ * are stored in an overflow list protected by a mutex, until the consumer
+ * has drained it. Elements are always popped in the order they were pushed.
+ *
+ * CAPACITY must be a power of two.
+ */
+template <typename T, size_t CAPACITY>
+class SPSCQueue {
+public:
+    SPSCQueue() : head(0), tail(0), overflowing(false) {}
+
+    SPSCQueue(const SPSCQueue&) = delete;
+    SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+    /* Push an element. Must only be called by the producer thread */
+    void push(const T& item)
+    {
+        /* Once we started using the overflow list, keep using it until the
+         * consumer emptied it, so that elements stay in order */
+        if (overflowing.load(std::memory_order_acquire)) {
+            std::unique_lock<std::mutex> lock(overflow_mutex);
+            if (overflowing.load(std::memory_order_relaxed)) {
+                overflow.push_back(item);
+                return;
+            }
+        }
+
+        size_t t = tail.load(std::memory_order_relaxed);
+        if ((t - head.load(std::memory_order_acquire)) == CAPACITY) {
+            std::unique_lock<std::mutex> lock(overflow_mutex);
+            overflow.push_back(item);
+            overflowing.store(true, std::memory_order_release);
+            return;
+        }
+
+        ring[t & (CAPACITY - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+    }
+
+    /* Pop the oldest element, and returns false if the queue was empty.
+     * Must only be called by the consumer thread */
+    bool pop(T& item)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h != tail.load(std::memory_order_acquire)) {
+            item = ring[h & (CAPACITY - 1)];
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        if (!overflowing.load(std::memory_order_acquire))
+            return false;
+
+        std::unique_lock<std::mutex> lock(overflow_mutex);
+
+        /* The producer may have pushed to the ring just before switching to
+         * the overflow list */
+        if (h != tail.load(std::memory_order_acquire)) {
+            item = ring[h & (CAPACITY - 1)];
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        item = overflow.front();
+        overflow.pop_front();
+        if (overflow.empty())
+            overflowing.store(false, std::memory_order_release);
+        return true;
+    }
+
+    /* Returns if the queue is empty. Exact only when called by the consumer */
+    bool empty() const
+    {
+        return (head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire)) &&
+            !overflowing.load(std::memory_order_acquire);
+    }
+
+private:
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+    T ring[CAPACITY];
+
+    /* Index of the next element to pop, only written by the consumer */
+    alignas(64) std::atomic<size_t> head;
+
+    /* Index of the next element to push, only written by the producer */
+    alignas(64) std::atomic<size_t> tail;
+
+    std::atomic<bool> overflowing;
+    std::deque<T> overflow;
+    std::mutex overflow_mutex;
+};
+
+#endif
@@ -30,7 +30,7 @@
 void SaveState::init(Context* context, int i)
 {
     id = i;
-    is_backtrack = (i == 10);
+    is_backtrack = (i == SharedConfig::SLOT_BACKTRACK);
     framecount = 0; // Special value for `no state`
     parent = -1;
     invalid = false;
@@ -290,3 +290,23 @@ void SaveState::backupMovie()
     if (framecount) // 0 means no state has been made
         movie->saveMovie(movie_path);
 }
+
+void SaveState::free(Context* context)
+{
+    if (!framecount)
+        return;
+
+    if (context->config.sc.savestate_settings & SharedConfig::SS_RAM) {
+        sendMessage(MSGN_SAVESTATE_INDEX);
+        sendData(&id, sizeof(int));
+        sendMessage(MSGN_FREE_SAVESTATE);
+    }
+
+    /* Remove the savestate files, or the empty files when stored in RAM */
+    unlink(pagemap_path.c_str());
+    unlink(pages_path.c_str());
+
+    framecount = 0;
+    parent = -1;
+    invalid = false;
+}
@@ -84,6 +84,9 @@ public:
     /* Save movie on disk when exiting */
     void backupMovie();
 
+    /* Remove the state, and free its memory in the game */
+    void free(Context* context);
+
 private:
     /* Savestate path */
     std::string path;
@@ -25,7 +25,7 @@
 
 #include <iostream>
 
-#define NB_STATES 11
+#define NB_STATES SharedConfig::SLOT_COUNT
 
 /* Array of savestates */
 static SaveState states[NB_STATES];
@@ -36,6 +36,23 @@ static int last_state_id;
 /* Old id of root savestate */
 static uint64_t old_root_framecount;
 
+/* Id of last loaded or saved savestate including states from Lua scripts,
+ * which the game uses as the parent of the next incremental savestate */
+static int game_parent_id;
+
+/* The game parent savestate must be freed once it is not the parent anymore */
+static bool free_game_parent;
+
+/* Update the game parent savestate, and free the previous one if needed */
+static void setGameParent(int id, Context* context)
+{
+    if (free_game_parent && (id != game_parent_id))
+        states[game_parent_id].free(context);
+
+    free_game_parent = false;
+    game_parent_id = id;
+}
+
 void SaveStateList::init(Context* context)
 {
     for (int i = 0; i < NB_STATES; i++) {
@@ -44,6 +61,8 @@ void SaveStateList::init(Context* context)
     
     last_state_id = -1;
     old_root_framecount = 0;
+    game_parent_id = -1;
+    free_game_parent = false;
 }
 
 SaveState& SaveStateList::get(int id)
@@ -62,6 +81,12 @@ int SaveStateList::save(int id, Context* context, MovieFile& movie)
     int message = ss.save(context, movie);
     
     if (message == MSGB_SAVING_SUCCEEDED) {
+        setGameParent(id, context);
+
+        /* States created by Lua scripts are not part of the state tree */
+        if (id >= SharedConfig::SLOT_LUA_FIRST)
+            return message;
+
         /* Update root savestate */
         old_root_framecount = rootStateFramecount();        
         
@@ -95,6 +120,12 @@ int SaveStateList::postLoad(int id, Context* context, MovieFile& movie, bool bra
     int message = ss.postLoad(context, movie, branch, inputEditor);
     
     if (message == MSGB_LOADING_SUCCEEDED) {
+        setGameParent(id, context);
+
+        /* States created by Lua scripts are not part of the state tree */
+        if (id >= SharedConfig::SLOT_LUA_FIRST)
+            return message;
+
         /* Update root savestate */
         old_root_framecount = rootStateFramecount();
         last_state_id = id;
@@ -115,7 +146,8 @@ void SaveStateList::invalidate()
 
 int SaveStateList::stateAtFrame(uint64_t frame)
 {
-    for (int i = 0; i < NB_STATES; i++) {
+    /* States created by Lua scripts are not shown */
+    for (int i = 0; i < SharedConfig::SLOT_LUA_FIRST; i++) {
         if ((states[i].framecount == frame) && !states[i].invalid)
             return states[i].id;
     }
@@ -162,7 +194,28 @@ int SaveStateList::nearestState(uint64_t framecount)
 
 void SaveStateList::backupMovies()
 {
-    for (int i = 0; i < NB_STATES; i++) {
+    /* States created by Lua scripts are temporary */
+    for (int i = 0; i < SharedConfig::SLOT_LUA_FIRST; i++) {
         states[i].backupMovie();
     }
 }
+
+void SaveStateList::free(int id, Context* context)
+{
+    SaveState& ss = get(id);
+
+    /* Detach the children of the state */
+    for (int cid = 0; cid < NB_STATES; cid++) {
+        if (states[cid].parent == id)
+            states[cid].parent = ss.parent;
+    }
+
+    /* Pages of the next incremental savestate are compared to the game parent
+     * savestate, so it is only freed when another state is saved or loaded */
+    if (id == game_parent_id) {
+        free_game_parent = true;
+        return;
+    }
+
+    ss.free(context);
+}
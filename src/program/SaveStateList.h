@@ -63,6 +63,10 @@ namespace SaveStateList {
     /* Save movies on disk when exiting */
     void backupMovies();
 
+    /* Remove a state and free its memory. This must be called when the game
+     * is waiting at a frame boundary */
+    void free(int id, Context* context);
+
 }
 
 #endif
@@ -21,6 +21,8 @@
 #include "Main.h"
 #include "NamedLuaFunction.h"
 #include "LuaFunctionList.h"
+#include "Memory.h"
+#include "Savestate.h"
 
 #include "Context.h"
 
@@ -79,7 +81,11 @@ int Callbacks::onPaint(lua_State *L)
 
 void Callbacks::call(NamedLuaFunction::CallbackType type)
 {
+    /* The game may have run since the last callback */
+    Memory::invalidateCache();
+    Savestate::beginCallback(type);
     getList().call(type);
+    Savestate::endCallback();
 }
 
 LuaFunctionList& Callbacks::getList()
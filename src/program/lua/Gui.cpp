@@ -21,9 +21,12 @@
 
 #include "../shared/sockethelpers.h"
 #include "../shared/messages.h"
+#include "../shared/LuaDrawRecord.h"
 
 #include <iostream>
 #include <string>
+#include <vector>
+#include <cstring>
 extern "C" {
 #include <lua.h>
 #include <lauxlib.h>
@@ -41,6 +44,26 @@ static const luaL_Reg gui_functions[] =
     { NULL, NULL }
 };
 
+/* Draw list of the current frame, and the one that was last sent to the game */
+static std::vector<LuaDrawRecord> records;
+static std::vector<LuaDrawRecord> sent_records;
+static std::string texts;
+static std::string sent_texts;
+
+/* Append a new record to the draw list, or return nullptr if full */
+static LuaDrawRecord* newRecord(int type, uint32_t color)
+{
+    if (records.size() >= LUA_DRAW_MAX_RECORDS)
+        return nullptr;
+
+    records.emplace_back();
+    LuaDrawRecord* record = &records.back();
+    memset(record, 0, sizeof(LuaDrawRecord));
+    record->type = type;
+    record->color = color;
+    return record;
+}
+
 void Lua::Gui::registerFunctions(lua_State *L)
 {
     luaL_newlib(L, gui_functions);
@@ -70,23 +93,31 @@ int Lua::Gui::text(lua_State *L)
 {
     int x = static_cast<int>(lua_tointeger(L, 1));
     int y = static_cast<int>(lua_tointeger(L, 2));
-    std::string text = luaL_checklstring(L, 3, nullptr);
+    size_t text_size;
+    const char* text = luaL_checklstring(L, 3, &text_size);
     uint32_t color = luaL_optnumber (L, 4, 0xffffffff);
     float anchor_x = static_cast<float>(luaL_optnumber(L, 5, 0.0f));
     float anchor_y = static_cast<float>(luaL_optnumber(L, 6, 0.0f));
     float font_size = static_cast<float>(luaL_optnumber(L, 7, 16.0f));
     bool monospace = static_cast<bool>(luaL_optinteger(L, 8, 0));
-    
-    sendMessage(MSGN_LUA_TEXT);
-    sendData(&x, sizeof(int));
-    sendData(&y, sizeof(int));
-    sendString(text);
-    sendData(&color, sizeof(uint32_t));
-    sendData(&anchor_x, sizeof(float));
-    sendData(&anchor_y, sizeof(float));
-    sendData(&font_size, sizeof(float));
-    sendData(&monospace, sizeof(bool));
-    
+
+    if (texts.size() + text_size > LUA_DRAW_MAX_TEXT)
+        return 0;
+
+    LuaDrawRecord* record = newRecord(LuaDrawRecord::LUA_DRAW_TEXT, color);
+    if (!record)
+        return 0;
+
+    record->x0 = x;
+    record->y0 = y;
+    record->flag = monospace;
+    record->anchor_x = anchor_x;
+    record->anchor_y = anchor_y;
+    record->font_size = font_size;
+    record->text_offset = texts.size();
+    record->text_size = text_size;
+    texts.append(text, text_size);
+
     return 0;
 }
 
@@ -95,12 +126,14 @@ int Lua::Gui::pixel(lua_State *L)
     int x = static_cast<int>(lua_tointeger(L, 1));
     int y = static_cast<int>(lua_tointeger(L, 2));
     uint32_t color = luaL_optnumber (L, 3, 0xffffffff);
-    
-    sendMessage(MSGN_LUA_PIXEL);
-    sendData(&x, sizeof(int));
-    sendData(&y, sizeof(int));
-    sendData(&color, sizeof(uint32_t));
-    
+
+    LuaDrawRecord* record = newRecord(LuaDrawRecord::LUA_DRAW_PIXEL, color);
+    if (!record)
+        return 0;
+
+    record->x0 = x;
+    record->y0 = y;
+
     return 0;
 }
 
@@ -113,16 +146,18 @@ int Lua::Gui::rectangle(lua_State *L)
     int thickness = luaL_optnumber (L, 5, 1);
     uint32_t color = luaL_optnumber (L, 6, 0xffffffff);
     int filled = luaL_optnumber (L, 7, 0);
-    
-    sendMessage(MSGN_LUA_RECT);
-    sendData(&x, sizeof(int));
-    sendData(&y, sizeof(int));
-    sendData(&w, sizeof(int));
-    sendData(&h, sizeof(int));
-    sendData(&thickness, sizeof(int));
-    sendData(&color, sizeof(uint32_t));
-    sendData(&filled, sizeof(int));
-    
+
+    LuaDrawRecord* record = newRecord(LuaDrawRecord::LUA_DRAW_RECT, color);
+    if (!record)
+        return 0;
+
+    record->x0 = x;
+    record->y0 = y;
+    record->x1 = w;
+    record->y1 = h;
+    record->thickness = thickness;
+    record->flag = filled;
+
     return 0;
 }
 
@@ -133,14 +168,16 @@ int Lua::Gui::line(lua_State *L)
     int x1 = static_cast<int>(lua_tointeger(L, 3));
     int y1 = static_cast<int>(lua_tointeger(L, 4));
     uint32_t color = luaL_optnumber (L, 5, 0xffffffff);
-    
-    sendMessage(MSGN_LUA_LINE);
-    sendData(&x0, sizeof(int));
-    sendData(&y0, sizeof(int));
-    sendData(&x1, sizeof(int));
-    sendData(&y1, sizeof(int));
-    sendData(&color, sizeof(uint32_t));
-    
+
+    LuaDrawRecord* record = newRecord(LuaDrawRecord::LUA_DRAW_LINE, color);
+    if (!record)
+        return 0;
+
+    record->x0 = x0;
+    record->y0 = y0;
+    record->x1 = x1;
+    record->y1 = y1;
+
     return 0;
 }
 
@@ -151,13 +188,71 @@ int Lua::Gui::ellipse(lua_State *L)
     int radius_x = static_cast<int>(lua_tointeger(L, 3));
     int radius_y = static_cast<int>(lua_tointeger(L, 4));
     uint32_t color = luaL_optnumber (L, 5, 0xffffffff);
-    
-    sendMessage(MSGN_LUA_ELLIPSE);
-    sendData(&center_x, sizeof(int));
-    sendData(&center_y, sizeof(int));
-    sendData(&radius_x, sizeof(int));
-    sendData(&radius_y, sizeof(int));
-    sendData(&color, sizeof(uint32_t));
-    
+
+    LuaDrawRecord* record = newRecord(LuaDrawRecord::LUA_DRAW_ELLIPSE, color);
+    if (!record)
+        return 0;
+
+    record->x0 = center_x;
+    record->y0 = center_y;
+    record->x1 = radius_x;
+    record->y1 = radius_y;
+
     return 0;
 }
+
+void Lua::Gui::sendDrawList()
+{
+    bool text_changed = (texts != sent_texts);
+
+    /* Build the runs of records that differ from the sent draw list */
+    std::vector<std::pair<uint32_t, uint32_t>> runs;
+    for (uint32_t i = 0; i < records.size(); ) {
+        if ((i < sent_records.size()) &&
+            (memcmp(&records[i], &sent_records[i], sizeof(LuaDrawRecord)) == 0)) {
+            i++;
+            continue;
+        }
+
+        uint32_t first = i++;
+        while ((i < records.size()) && ((i >= sent_records.size()) ||
+            (memcmp(&records[i], &sent_records[i], sizeof(LuaDrawRecord)) != 0)))
+            i++;
+        runs.emplace_back(first, i - first);
+    }
+
+    /* The game keeps drawing the previous list if nothing changed */
+    if (text_changed || !runs.empty() || (records.size() != sent_records.size())) {
+        uint32_t record_count = records.size();
+        sendMessage(MSGN_LUA_DRAW_LIST);
+        sendData(&record_count, sizeof(uint32_t));
+        sendData(&text_changed, sizeof(bool));
+        if (text_changed) {
+            uint32_t text_size = texts.size();
+            sendData(&text_size, sizeof(uint32_t));
+            sendData(texts.data(), text_size);
+        }
+
+        uint32_t run_count = runs.size();
+        sendData(&run_count, sizeof(uint32_t));
+        for (auto& run : runs) {
+            sendData(&run.first, sizeof(uint32_t));
+            sendData(&run.second, sizeof(uint32_t));
+            sendData(&records[run.first], run.second * sizeof(LuaDrawRecord));
+        }
+    }
+
+    /* Keep the allocated buffers for the next frame */
+    sent_records.swap(records);
+    records.clear();
+    sent_texts.swap(texts);
+    texts.clear();
+}
+
+void Lua::Gui::resetDrawList()
+{
+    records.clear();
+    sent_records.clear();
+    texts.clear();
+    sent_texts.clear();
+}
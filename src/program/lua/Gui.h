@@ -32,6 +32,12 @@ namespace Gui {
     /* Register all functions */
     void registerFunctions(lua_State *L);
 
+    /* Send the changes of the draw list to the game, and start a new one */
+    void sendDrawList();
+
+    /* Forget the draw list known by the game, when a new game is started */
+    void resetDrawList();
+
     /* Get the window resolution */
     int resolution(lua_State *L);
 
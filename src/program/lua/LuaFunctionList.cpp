@@ -19,6 +19,7 @@
 
 #include "LuaFunctionList.h"
 #include "Main.h"
+#include "Savestate.h"
 
 #include "utils.h"
 
@@ -77,8 +78,10 @@ void LuaFunctionList::removeForFile(int row)
     functions.remove_if([&file](const NamedLuaFunction& nlf){ return 0 == file.compare(nlf.file); });
 
     inotify_rm_watch(inotifyfd, fileList[row].wd);
-    if (fileList[row].lua_state)
+    if (fileList[row].lua_state) {
+        Savestate::close(fileList[row].lua_state);
         lua_close(fileList[row].lua_state);
+    }
     fileSet.erase(file);
     fileList.erase(fileList.begin() + row);
 }
@@ -102,8 +105,10 @@ void LuaFunctionList::watchChanges()
                     functions.remove_if([&file](const NamedLuaFunction& nlf){ return 0 == file.compare(nlf.file); });
 
                     /* Create a new lua state */
-                    if (lf.lua_state)
+                    if (lf.lua_state) {
+                        Savestate::close(lf.lua_state);
                         lua_close(lf.lua_state);
+                    }
                     lf.lua_state = Main::new_state();
                     Main::run(lf.lua_state, file);
                 }
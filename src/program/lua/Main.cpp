@@ -25,6 +25,7 @@
 #include "Memory.h"
 #include "Print.h"
 #include "Runtime.h"
+#include "Savestate.h"
 #include "Callbacks.h"
 
 #include <iostream>
@@ -56,6 +57,7 @@ lua_State* Lua::Main::new_state()
     Lua::Callbacks::registerFunctions(lua_state);
     Lua::Print::init(lua_state);
     Lua::Runtime::registerFunctions(lua_state, context);
+    Lua::Savestate::registerFunctions(lua_state, context);
     
     return lua_state;
 }
@@ -70,6 +72,7 @@ std::string luaFile;
 int Lua::Main::run(lua_State* lua_state, std::string filename)
 {
     luaFile = filename;
+    Lua::Memory::invalidateCache();
     int status = luaL_dofile(lua_state, filename.c_str());
     if (status != 0) {
         std::cerr << "Error " << status << " loading lua script " << filename << std::endl;
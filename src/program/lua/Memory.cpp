@@ -23,6 +23,10 @@
 #include "ramsearch/BaseAddresses.h"
 
 #include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <cstring>
+#include <algorithm>
 extern "C" {
 #include <lua.h>
 #include <lauxlib.h>
@@ -41,6 +45,10 @@ static const luaL_Reg memory_functions[] =
     { "reads64", Lua::Memory::reads64},
     { "readf", Lua::Memory::readf},
     { "readd", Lua::Memory::readd},
+    { "readBlock", Lua::Memory::readBlock},
+    { "unpack", Lua::Memory::unpack},
+    { "readPointerChain", Lua::Memory::readPointerChain},
+    { "setCache", Lua::Memory::setCache},
     { "write8", Lua::Memory::write8},
     { "write16", Lua::Memory::write16},
     { "write32", Lua::Memory::write32},
@@ -57,9 +65,69 @@ void Lua::Memory::registerFunctions(lua_State *L)
     lua_setglobal(L, "memory");
 }
 
+/* Cache of game memory pages, so that scripts reading many values in the
+ * same callback don't perform one syscall per value. Pages that could not be
+ * fully read are stored empty, and are read directly. */
+#define CACHE_PAGE_SIZE 4096
+#define CACHE_MAX_PAGES 1024
+static bool cache_enabled = false;
+static std::unordered_map<uintptr_t, std::vector<uint8_t>> cache_pages;
+
+/* Read game memory, returning 0 instead of -1 on error */
+static size_t directRead(uintptr_t addr, void* buf, size_t size)
+{
+    size_t ret = MemAccess::read(buf, reinterpret_cast<void*>(addr), size);
+    return (ret > size) ? 0 : ret;
+}
+
+static const std::vector<uint8_t>* cachedPage(uintptr_t page)
+{
+    auto it = cache_pages.find(page);
+    if (it == cache_pages.end()) {
+        if (cache_pages.size() >= CACHE_MAX_PAGES)
+            cache_pages.clear();
+
+        std::vector<uint8_t>& data = cache_pages[page];
+        data.resize(CACHE_PAGE_SIZE);
+        if (directRead(page, data.data(), CACHE_PAGE_SIZE) != CACHE_PAGE_SIZE)
+            data.clear();
+        return data.empty() ? nullptr : &data;
+    }
+    return it->second.empty() ? nullptr : &it->second;
+}
+
+void Lua::Memory::invalidateCache()
+{
+    cache_pages.clear();
+}
+
+size_t Lua::Memory::readBytes(uintptr_t addr, void* buf, size_t size)
+{
+    /* Large reads don't benefit from the cache */
+    if (!cache_enabled || size > 16*CACHE_PAGE_SIZE)
+        return directRead(addr, buf, size);
+
+    uint8_t* dest = static_cast<uint8_t*>(buf);
+    size_t done = 0;
+    while (done < size) {
+        uintptr_t cur = addr + done;
+        uintptr_t page = cur & ~static_cast<uintptr_t>(CACHE_PAGE_SIZE - 1);
+        size_t offset = cur - page;
+        size_t len = std::min(static_cast<size_t>(CACHE_PAGE_SIZE) - offset, size - done);
+
+        const std::vector<uint8_t>* data = cachedPage(page);
+        if (!data)
+            return done + directRead(cur, dest + done, size - done);
+
+        memcpy(dest + done, data->data() + offset, len);
+        done += len;
+    }
+    return done;
+}
+
 bool Lua::Memory::read(uintptr_t addr, void* return_value, int size)
 {
-    return MemAccess::read(return_value, reinterpret_cast<void*>(addr), size) == size;
+    return readBytes(addr, return_value, size) == static_cast<size_t>(size);
 }
 
 /* Define a macro to declare all read functions */
@@ -101,9 +169,87 @@ int Lua::Memory::read##NAME(lua_State *L) \
 READFUNCNUMBER(f, float)
 READFUNCNUMBER(d, double)
 
+int Lua::Memory::readBlock(lua_State *L)
+{
+    uintptr_t addr = static_cast<uintptr_t>(lua_tointeger(L, 1));
+    lua_Integer size = luaL_checkinteger(L, 2);
+    if (size <= 0) {
+        lua_pushliteral(L, "");
+        return 1;
+    }
+
+    std::vector<char> buf(size);
+    size_t ret = readBytes(addr, buf.data(), size);
+    lua_pushlstring(L, buf.data(), ret);
+    return 1;
+}
+
+int Lua::Memory::unpack(lua_State *L)
+{
+    uintptr_t addr = static_cast<uintptr_t>(lua_tointeger(L, 1));
+    luaL_checkstring(L, 2);
+
+    /* Rely on the string library for the format parsing */
+    lua_getglobal(L, "string");
+    lua_getfield(L, -1, "packsize");
+    lua_pushvalue(L, 2);
+    lua_call(L, 1, 1);
+    lua_Integer size = lua_tointeger(L, -1);
+    lua_pop(L, 1);
+
+    std::vector<char> buf(size);
+    if (readBytes(addr, buf.data(), size) != static_cast<size_t>(size)) {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    int top = lua_gettop(L);
+    lua_getfield(L, -1, "unpack");
+    lua_pushvalue(L, 2);
+    lua_pushlstring(L, buf.data(), size);
+    lua_call(L, 2, LUA_MULTRET);
+
+    /* Remove the next position returned by string.unpack */
+    lua_pop(L, 1);
+    return lua_gettop(L) - top;
+}
+
+int Lua::Memory::readPointerChain(lua_State *L)
+{
+    uintptr_t addr = static_cast<uintptr_t>(lua_tointeger(L, 1));
+    int n = lua_gettop(L);
+
+    for (int i = 2; i <= n; i++) {
+        uintptr_t next_addr;
+        if (!read(addr, &next_addr, sizeof(uintptr_t))) {
+            lua_pushinteger(L, 0);
+            return 1;
+        }
+        addr = next_addr + static_cast<uintptr_t>(lua_tointeger(L, i));
+    }
+
+    lua_pushinteger(L, static_cast<lua_Integer>(addr));
+    return 1;
+}
+
+int Lua::Memory::setCache(lua_State *L)
+{
+    cache_enabled = lua_toboolean(L, 1);
+    cache_pages.clear();
+    return 0;
+}
+
 void Lua::Memory::write(uintptr_t addr, void* value, int size)
 {
     MemAccess::write(value, reinterpret_cast<void*>(addr), size);
+
+    /* Drop cached pages that were modified */
+    if (!cache_pages.empty()) {
+        uintptr_t first = addr & ~static_cast<uintptr_t>(CACHE_PAGE_SIZE - 1);
+        uintptr_t last = (addr + size - 1) & ~static_cast<uintptr_t>(CACHE_PAGE_SIZE - 1);
+        for (uintptr_t page = first; page <= last; page += CACHE_PAGE_SIZE)
+            cache_pages.erase(page);
+    }
 }
 
 /* Define a macro to declare all write functions */
@@ -21,6 +21,7 @@
 #define LIBTAS_LUAMEMORY_H_INCLUDED
 
 #include <stdint.h>
+#include <stddef.h>
 extern "C" {
 #include <lua.h>
 }
@@ -35,6 +36,14 @@ namespace Memory {
     /* Helper function for reading an integer */
     bool read(uintptr_t addr, void* return_value, int size);
 
+    /* Helper function for reading a range of memory, going through the
+     * cache if enabled. Returns the number of bytes read. */
+    size_t readBytes(uintptr_t addr, void* buf, size_t size);
+
+    /* Drop all cached memory pages. Must be called each time the game may
+     * have run since the last Lua call */
+    void invalidateCache();
+
     /* Read an unsigned 8-bit integer */
     int readu8(lua_State *L);
 
@@ -65,6 +74,18 @@ namespace Memory {
     /* Read a double */
     int readd(lua_State *L);
 
+    /* Read a block of memory as a string */
+    int readBlock(lua_State *L);
+
+    /* Read a structure using a string.unpack format */
+    int unpack(lua_State *L);
+
+    /* Follow a pointer chain and return the final address */
+    int readPointerChain(lua_State *L);
+
+    /* Enable or disable the memory page cache */
+    int setCache(lua_State *L);
+
     /* Helper function for reading an integer */
     void write(uintptr_t addr, void* value, int size);
 
@@ -0,0 +1,327 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Savestate.h"
+#include "Memory.h"
+
+#include "GameEvents.h"
+#include "Context.h"
+#include "../shared/SharedConfig.h"
+
+#include <iostream>
+#include <cstring>
+extern "C" {
+#include <lua.h>
+#include <lauxlib.h>
+}
+
+static Context* context;
+static GameEvents* gameEvents = nullptr;
+
+/* Lua state which created each savestate slot, or nullptr if unused */
+static lua_State* slot_owners[SharedConfig::SLOT_COUNT];
+
+/* Slots released by scripts, whose state is freed at the next frame boundary */
+static bool slots_to_free[SharedConfig::SLOT_COUNT];
+
+/* Savestates can only be performed when the game is waiting at a frame
+ * boundary, which is the case during the frame callback */
+static bool in_frame_callback = false;
+
+/* State of the running search */
+struct Search {
+    bool active = false;
+    lua_State *L = nullptr;
+    int slot;
+    int candidates_ref;
+    int measure_ref;
+    int done_ref;
+    int results_ref;
+    int candidate_count;
+    int candidate; // current candidate, starting at 1
+    int frames;
+    int frame; // number of frames already run for the current candidate
+    bool was_running;
+};
+static Search search_state;
+
+/* List of functions to register */
+static const luaL_Reg savestate_functions[] =
+{
+    { "create", Lua::Savestate::create},
+    { "load", Lua::Savestate::load},
+    { "free", Lua::Savestate::free},
+    { "search", Lua::Savestate::search},
+    { NULL, NULL }
+};
+
+void Lua::Savestate::registerFunctions(lua_State *L, Context* c)
+{
+    context = c;
+    luaL_newlib(L, savestate_functions);
+    lua_setglobal(L, "savestate");
+}
+
+static void releaseSearch()
+{
+    lua_State *L = search_state.L;
+    luaL_unref(L, LUA_REGISTRYINDEX, search_state.candidates_ref);
+    luaL_unref(L, LUA_REGISTRYINDEX, search_state.measure_ref);
+    luaL_unref(L, LUA_REGISTRYINDEX, search_state.done_ref);
+    luaL_unref(L, LUA_REGISTRYINDEX, search_state.results_ref);
+    search_state.active = false;
+    search_state.L = nullptr;
+}
+
+void Lua::Savestate::registerGameEvents(GameEvents* ge)
+{
+    gameEvents = ge;
+
+    /* States from a previous game execution are gone */
+    memset(slot_owners, 0, sizeof(slot_owners));
+    memset(slots_to_free, 0, sizeof(slots_to_free));
+    if (search_state.active)
+        releaseSearch();
+}
+
+static bool validSlot(int slot)
+{
+    return (slot >= SharedConfig::SLOT_LUA_FIRST) && (slot < SharedConfig::SLOT_COUNT) && slot_owners[slot];
+}
+
+static void releaseSlot(int slot)
+{
+    slot_owners[slot] = nullptr;
+    slots_to_free[slot] = true;
+}
+
+void Lua::Savestate::close(lua_State *L)
+{
+    if (search_state.active && (search_state.L == L)) {
+        search_state.active = false;
+        search_state.L = nullptr;
+        context->config.sc.running = search_state.was_running;
+        context->config.sc_modified = true;
+    }
+
+    for (int slot = SharedConfig::SLOT_LUA_FIRST; slot < SharedConfig::SLOT_COUNT; slot++) {
+        if (slot_owners[slot] == L)
+            releaseSlot(slot);
+    }
+}
+
+static void checkFrameBoundary(lua_State *L)
+{
+    if (!gameEvents || !in_frame_callback)
+        luaL_error(L, "savestate functions can only be called from the frame callback");
+}
+
+static bool loadSlot(int slot)
+{
+    bool ret = gameEvents->loadState(slot, false);
+    Lua::Memory::invalidateCache();
+    return ret;
+}
+
+/* Stop the search, and call the done function with the results */
+static void finishSearch()
+{
+    lua_State *L = search_state.L;
+
+    context->config.sc.running = search_state.was_running;
+    context->config.sc_modified = true;
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, search_state.done_ref);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, search_state.results_ref);
+
+    /* Release before calling, so that a new search can be started */
+    releaseSearch();
+
+    if (0 != lua_pcall(L, 1, 0, 0)) {
+        std::cerr << "Failed to call the search done function: " << lua_tostring(L, -1) << std::endl;
+        lua_pop(L, 1);
+    }
+}
+
+/* Start running the current candidate from the search state */
+static void startCandidate()
+{
+    search_state.frame = 0;
+    if (!loadSlot(search_state.slot)) {
+        std::cerr << "Search stopped because the state could not be loaded" << std::endl;
+        finishSearch();
+    }
+}
+
+void Lua::Savestate::beginCallback(NamedLuaFunction::CallbackType type)
+{
+    in_frame_callback = (type == NamedLuaFunction::CallbackFrame);
+
+    /* Free released states now that the game waits at a frame boundary */
+    if (in_frame_callback && gameEvents) {
+        for (int slot = SharedConfig::SLOT_LUA_FIRST; slot < SharedConfig::SLOT_COUNT; slot++) {
+            if (slots_to_free[slot]) {
+                gameEvents->freeState(slot);
+                slots_to_free[slot] = false;
+            }
+        }
+    }
+
+    if (!search_state.active)
+        return;
+
+    lua_State *L = search_state.L;
+
+    if (type == NamedLuaFunction::CallbackInput) {
+        /* Let the candidate set the inputs of this frame */
+        lua_rawgeti(L, LUA_REGISTRYINDEX, search_state.candidates_ref);
+        lua_rawgeti(L, -1, search_state.candidate);
+        lua_pushinteger(L, search_state.frame + 1);
+        if (0 != lua_pcall(L, 1, 0, 0)) {
+            std::cerr << "Failed to call the search candidate: " << lua_tostring(L, -1) << std::endl;
+            lua_pop(L, 1);
+        }
+        lua_pop(L, 1);
+        return;
+    }
+
+    if (type != NamedLuaFunction::CallbackFrame)
+        return;
+
+    if (++search_state.frame < search_state.frames)
+        return;
+
+    /* Candidate is over, store its result */
+    lua_rawgeti(L, LUA_REGISTRYINDEX, search_state.results_ref);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, search_state.measure_ref);
+    if (0 != lua_pcall(L, 0, 1, 0)) {
+        std::cerr << "Failed to call the search measure function: " << lua_tostring(L, -1) << std::endl;
+        lua_pop(L, 1);
+        lua_pushnil(L);
+    }
+    lua_rawseti(L, -2, search_state.candidate);
+    lua_pop(L, 1);
+
+    if (++search_state.candidate > search_state.candidate_count) {
+        /* Go back to the initial state before returning the results */
+        loadSlot(search_state.slot);
+        finishSearch();
+        return;
+    }
+
+    startCandidate();
+}
+
+void Lua::Savestate::endCallback()
+{
+    in_frame_callback = false;
+}
+
+int Lua::Savestate::create(lua_State *L)
+{
+    checkFrameBoundary(L);
+
+    for (int slot = SharedConfig::SLOT_LUA_FIRST; slot < SharedConfig::SLOT_COUNT; slot++) {
+        if (slot_owners[slot])
+            continue;
+
+        if (!gameEvents->saveState(slot))
+            break;
+
+        slot_owners[slot] = L;
+        slots_to_free[slot] = false;
+        lua_pushinteger(L, slot);
+        return 1;
+    }
+
+    lua_pushnil(L);
+    return 1;
+}
+
+int Lua::Savestate::load(lua_State *L)
+{
+    checkFrameBoundary(L);
+
+    int slot = static_cast<int>(lua_tointeger(L, 1));
+    if (!validSlot(slot)) {
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+
+    lua_pushboolean(L, loadSlot(slot));
+    return 1;
+}
+
+int Lua::Savestate::free(lua_State *L)
+{
+    int slot = static_cast<int>(lua_tointeger(L, 1));
+    if (validSlot(slot) && (slot_owners[slot] == L))
+        releaseSlot(slot);
+    return 0;
+}
+
+int Lua::Savestate::search(lua_State *L)
+{
+    checkFrameBoundary(L);
+
+    if (search_state.active)
+        luaL_error(L, "a search is already running");
+
+    int slot = static_cast<int>(lua_tointeger(L, 1));
+    luaL_checktype(L, 2, LUA_TTABLE);
+    int frames = static_cast<int>(luaL_checkinteger(L, 3));
+    luaL_checktype(L, 4, LUA_TFUNCTION);
+    luaL_checktype(L, 5, LUA_TFUNCTION);
+
+    int candidate_count = static_cast<int>(lua_rawlen(L, 2));
+    if (!validSlot(slot) || (frames <= 0) || (candidate_count == 0)) {
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+
+    /* Start from the state, for the first candidate */
+    if (!loadSlot(slot)) {
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+
+    search_state.L = L;
+    search_state.slot = slot;
+    lua_pushvalue(L, 2);
+    search_state.candidates_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    lua_pushvalue(L, 4);
+    search_state.measure_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    lua_pushvalue(L, 5);
+    search_state.done_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    lua_newtable(L);
+    search_state.results_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    search_state.candidate_count = candidate_count;
+    search_state.candidate = 1;
+    search_state.frames = frames;
+    search_state.frame = 0;
+    search_state.active = true;
+
+    /* The game must run to go through the candidates */
+    search_state.was_running = context->config.sc.running;
+    context->config.sc.running = true;
+    context->config.sc_modified = true;
+
+    lua_pushboolean(L, 1);
+    return 1;
+}
@@ -0,0 +1,65 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_LUASAVESTATE_H_INCLUDED
+#define LIBTAS_LUASAVESTATE_H_INCLUDED
+
+#include "NamedLuaFunction.h"
+
+extern "C" {
+#include <lua.h>
+}
+
+struct Context;
+class GameEvents;
+
+namespace Lua {
+
+namespace Savestate {
+
+    /* Register all functions */
+    void registerFunctions(lua_State *L, Context* c);
+
+    /* Pass the object performing savestates, and reset all states */
+    void registerGameEvents(GameEvents* ge);
+
+    /* Called before and after each callback type, to drive a running search */
+    void beginCallback(NamedLuaFunction::CallbackType type);
+    void endCallback();
+
+    /* Stop the search and release the states of a lua state which is about
+     * to be closed */
+    void close(lua_State *L);
+
+    /* Create a new state and return its id */
+    int create(lua_State *L);
+
+    /* Load a state */
+    int load(lua_State *L);
+
+    /* Release a state */
+    int free(lua_State *L);
+
+    /* Run candidate inputs from a state and gather the results */
+    int search(lua_State *L);
+
+}
+}
+
+#endif
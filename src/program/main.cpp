@@ -19,6 +19,7 @@
 
 
 #include "ui/MainWindow.h"
+#include "BatchRunner.h"
 #include "Context.h"
 #include "utils.h" // create_dir
 #include "lua/Main.h"
@@ -67,6 +68,13 @@ static void print_usage(void)
     std::cout << "  -w, --write MOVIE       Record game inputs into the specified MOVIE file" << std::endl;
     std::cout << "  -l, --lua FILE          Start the specified FILE lua script" << std::endl;
     std::cout << "  -n, --non-interactive   Don't offer any interactive choice, so that it can run headless" << std::endl;
+    std::cout << "  -b, --batch             Play the movie without user interface and print a report" << std::endl;
+    std::cout << "      --checksum ADDR:SIZE  In batch mode, hash this memory range (in hex) at the end of the movie" << std::endl;
+    std::cout << "      --expect-checksum HASH  In batch mode, report a desync if the checksum differs from HASH" << std::endl;
+    std::cout << "      --state-hash ADDR:SIZE  When recording, store a hash of this memory range (in hex) at each frame" << std::endl;
+    std::cout << "      --dump-range START:END  In batch mode, only encode frames between START and END, and quit at frame END" << std::endl;
+    std::cout << "      --parallel-dump N   In batch mode, split the encode into N segments encoded in parallel, and concatenate them" << std::endl;
+    std::cout << "      --perf-export FILE  Export performance counters of each frame to FILE (CSV, or Chrome trace if .json)" << std::endl;
     std::cout << "      --libtas-so-path    Path to libtas.so (equivalent to setting LIBTAS_SO_PATH)" << std::endl;
     std::cout << "      --libtas32-so-path  Path to libtas32.so (equivalent to setting LIBTAS32_SO_PATH)" << std::endl;
     std::cout << "  -h, --help              Show this message" << std::endl;
@@ -102,6 +110,13 @@ int main(int argc, char **argv)
         {"dump", required_argument, nullptr, 'd'},
         {"lua", required_argument, nullptr, 'l'},
         {"non-interactive", no_argument, nullptr, 'n'},
+        {"batch", no_argument, nullptr, 'b'},
+        {"checksum", required_argument, nullptr, 'c'},
+        {"expect-checksum", required_argument, nullptr, 'e'},
+        {"state-hash", required_argument, nullptr, 's'},
+        {"dump-range", required_argument, nullptr, 'D'},
+        {"parallel-dump", required_argument, nullptr, 'j'},
+        {"perf-export", required_argument, nullptr, 'f'},
         {"libtas-so-path", required_argument, nullptr, 'p'},
         {"libtas32-so-path", required_argument, nullptr, 'P'},
         {"help", no_argument, nullptr, 'h'},
@@ -109,8 +124,10 @@ int main(int argc, char **argv)
     };
     int option_index = 0;
 
+    BatchRunner batchRunner(&context);
+
     // std::string libname;
-    while ((c = getopt_long (argc, argv, "+r:w:d:l:nh", long_options, &option_index)) != -1) {
+    while ((c = getopt_long (argc, argv, "+r:w:d:l:nbh", long_options, &option_index)) != -1) {
         switch (c) {
             case 'r':
             case 'w':
@@ -138,6 +155,49 @@ int main(int argc, char **argv)
             case 'n':
                 context.interactive = false;
                 break;
+            case 'b':
+                context.interactive = false;
+                context.batch = true;
+                break;
+            case 'c':
+                if (!batchRunner.addChecksumRange(optarg)) {
+                    std::cerr << "Invalid checksum range " << optarg << std::endl;
+                    return BatchRunner::EXIT_ERROR;
+                }
+                break;
+            case 'e':
+                if (!batchRunner.setExpectedChecksum(optarg)) {
+                    std::cerr << "Invalid checksum " << optarg << std::endl;
+                    return BatchRunner::EXIT_ERROR;
+                }
+                break;
+            case 's': {
+                uint64_t addr, size;
+                if (!parseMemoryRange(optarg, &addr, &size)) {
+                    std::cerr << "Invalid state hash range " << optarg << std::endl;
+                    return -1;
+                }
+                context.state_hash_ranges.push_back(std::make_pair(addr, size));
+                break;
+            }
+            case 'D':
+                if (!batchRunner.setDumpRange(optarg)) {
+                    std::cerr << "Invalid dump range " << optarg << std::endl;
+                    return BatchRunner::EXIT_ERROR;
+                }
+                break;
+            case 'j':
+                if (!batchRunner.setParallelJobs(optarg)) {
+                    std::cerr << "Invalid number of parallel encodes " << optarg << std::endl;
+                    return BatchRunner::EXIT_ERROR;
+                }
+                break;
+            case 'f':
+                abspath = realpath_nonexist(optarg);
+                if (!abspath.empty()) {
+                    context.perf_export_file = abspath;
+                }
+                break;
             case 'p':
                 abspath = realpath_nonexist(optarg);
                 if (!abspath.empty()) {
@@ -405,12 +465,23 @@ int main(int argc, char **argv)
     if (!luafile.empty())
         Lua::Callbacks::getList().addFile(luafile);
 
-    /* Starts the user interface */
-    QApplication app(argc, argv);
-
     QLocale::setDefault(QLocale("C"));
     std::locale::global(std::locale::classic());
 
+    /* In batch mode, play the movie without building any user interface */
+    if (context.batch) {
+        int ret = batchRunner.run();
+
+        Lua::Main::exit();
+#ifdef __unix__
+        xcb_disconnect(context.conn);
+#endif
+        return ret;
+    }
+
+    /* Starts the user interface */
+    QApplication app(argc, argv);
+
     MainWindow mainWin(&context);
     mainWin.show();
 
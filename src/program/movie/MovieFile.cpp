@@ -34,6 +34,7 @@ MovieFile::MovieFile(Context* c) : context(c)
     inputs = new MovieFileInputs(c);
     annotations = new MovieFileAnnotations(c);
     editor = new MovieFileEditor(c);
+    hashes = new MovieFileHashes(c);
 }
 
 const char* MovieFile::errorString(int error_code) {
@@ -61,6 +62,7 @@ void MovieFile::clear()
     inputs->clear();
     annotations->clear();
     editor->clear();
+    hashes->clear();
 }
 
 int MovieFile::extractMovie(const std::string& moviefile)
@@ -77,10 +79,12 @@ int MovieFile::extractMovie(const std::string& moviefile)
     std::string editorfile = context->config.tempmoviedir + "/editor.ini";
     std::string inputfile = context->config.tempmoviedir + "/inputs";
     std::string annotationsfile = context->config.tempmoviedir + "/annotations.txt";
+    std::string hashesfile = context->config.tempmoviedir + "/hashes";
     unlink(configfile.c_str());
     unlink(editorfile.c_str());
     unlink(inputfile.c_str());
     unlink(annotationsfile.c_str());
+    unlink(hashesfile.c_str());
 
     /* Build the tar command */
     std::ostringstream oss;
@@ -123,6 +127,7 @@ int MovieFile::loadMovie(const std::string& moviefile)
     inputs->load();
     annotations->load();
     editor->load();
+    hashes->load();
 
     /* Copy framerate values to inputs */
     inputs->framerate_num = header->framerate_num;
@@ -165,6 +170,7 @@ int MovieFile::saveMovie(const std::string& moviefile, uint64_t nb_frames)
     header->save(inputs->nbFrames(), nb_frames);
     annotations->save();
     editor->save();
+    bool has_hashes = hashes->save();
 
     /* Build the tar command */
     std::ostringstream oss;
@@ -173,6 +179,8 @@ int MovieFile::saveMovie(const std::string& moviefile, uint64_t nb_frames)
     oss << "\" -C ";
     oss << context->config.tempmoviedir;
     oss << " inputs config.ini editor.ini annotations.txt";
+    if (has_hashes)
+        oss << " hashes";
 
     /* Execute the tar command */
     // std::cout << oss.str() << std::endl;
@@ -207,6 +215,9 @@ void MovieFile::copyTo(MovieFile& movie) const
     /* This will only be used for savestate movies, we only care to copy relevant data */
     movie.editor->input_set = editor->input_set;
     movie.editor->nondraw_frames = editor->nondraw_frames;
+    movie.hashes->ranges = hashes->ranges;
+    movie.hashes->hashes = hashes->hashes;
+    movie.hashes->audio_hashes = hashes->audio_hashes;
     movie.header->framerate_num = header->framerate_num;
     movie.header->framerate_den = header->framerate_den;
     movie.header->savestate_framecount = context->framecount;
@@ -22,6 +22,7 @@
 
 #include "MovieFileAnnotations.h"
 #include "MovieFileEditor.h"
+#include "MovieFileHashes.h"
 #include "MovieFileHeader.h"
 #include "MovieFileInputs.h"
 
@@ -38,6 +39,7 @@ public:
     MovieFileInputs* inputs;
     MovieFileAnnotations* annotations;
     MovieFileEditor* editor;
+    MovieFileHashes* hashes;
 
     /* List of error codes */
     enum Error {
@@ -0,0 +1,146 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MovieFileHashes.h"
+
+#include "Context.h"
+
+#include <fstream>
+#include <unistd.h>
+
+/* Version of the hashes file format */
+#define HASHES_VERSION 1
+
+/* Store the hash of a frame, and remove the hashes of the following frames */
+static void setFrameHash(std::vector<uint64_t>& frame_hashes, uint64_t frame, uint64_t hash)
+{
+    frame_hashes.resize(frame + 1, 0);
+    frame_hashes[frame] = hash;
+}
+
+/* Compare the hash of a frame with the stored one, and update the first
+ * desync frame if it does not match */
+static bool checkFrameHash(const std::vector<uint64_t>& frame_hashes, uint64_t frame, uint64_t hash, int64_t& first_desync)
+{
+    if ((frame >= frame_hashes.size()) || (frame_hashes[frame] == 0) || (frame_hashes[frame] == hash))
+        return true;
+
+    if ((first_desync == -1) || (static_cast<int64_t>(frame) < first_desync))
+        first_desync = frame;
+    return false;
+}
+
+MovieFileHashes::MovieFileHashes(Context* c) : context(c) {}
+
+void MovieFileHashes::clear()
+{
+    ranges.clear();
+    hashes.clear();
+    audio_hashes.clear();
+    first_desync = -1;
+}
+
+void MovieFileHashes::load()
+{
+    clear();
+
+    /* Load hashes if available. The file contains a version, the number of
+     * ranges, each range as (address, size), the number of state hashes,
+     * one state hash per frame, then one audio hash per frame until the end */
+    std::string hashes_file = context->config.tempmoviedir + "/hashes";
+    std::ifstream hashes_stream(hashes_file, std::ios::binary);
+    if (!hashes_stream)
+        return;
+
+    uint32_t version = 0, range_count = 0;
+    hashes_stream.read(reinterpret_cast<char*>(&version), sizeof(uint32_t));
+    hashes_stream.read(reinterpret_cast<char*>(&range_count), sizeof(uint32_t));
+    if (!hashes_stream || (version != HASHES_VERSION))
+        return;
+
+    for (uint32_t r = 0; r < range_count; r++) {
+        uint64_t range[2];
+        hashes_stream.read(reinterpret_cast<char*>(range), sizeof(range));
+        if (!hashes_stream) {
+            ranges.clear();
+            return;
+        }
+        ranges.push_back(std::make_pair(range[0], range[1]));
+    }
+
+    uint64_t hash_count = 0;
+    hashes_stream.read(reinterpret_cast<char*>(&hash_count), sizeof(uint64_t));
+
+    uint64_t hash;
+    while ((hashes.size() < hash_count) && hashes_stream.read(reinterpret_cast<char*>(&hash), sizeof(uint64_t)))
+        hashes.push_back(hash);
+
+    while (hashes_stream.read(reinterpret_cast<char*>(&hash), sizeof(uint64_t)))
+        audio_hashes.push_back(hash);
+}
+
+bool MovieFileHashes::save()
+{
+    std::string hashes_file = context->config.tempmoviedir + "/hashes";
+
+    if (ranges.empty() && audio_hashes.empty()) {
+        unlink(hashes_file.c_str());
+        return false;
+    }
+
+    std::ofstream hashes_stream(hashes_file, std::ios::binary | std::ios::trunc);
+
+    uint32_t version = HASHES_VERSION;
+    uint32_t range_count = ranges.size();
+    hashes_stream.write(reinterpret_cast<const char*>(&version), sizeof(uint32_t));
+    hashes_stream.write(reinterpret_cast<const char*>(&range_count), sizeof(uint32_t));
+    for (const auto& range : ranges) {
+        hashes_stream.write(reinterpret_cast<const char*>(&range.first), sizeof(uint64_t));
+        hashes_stream.write(reinterpret_cast<const char*>(&range.second), sizeof(uint64_t));
+    }
+    uint64_t hash_count = hashes.size();
+    hashes_stream.write(reinterpret_cast<const char*>(&hash_count), sizeof(uint64_t));
+    if (!hashes.empty())
+        hashes_stream.write(reinterpret_cast<const char*>(hashes.data()), hashes.size() * sizeof(uint64_t));
+    if (!audio_hashes.empty())
+        hashes_stream.write(reinterpret_cast<const char*>(audio_hashes.data()), audio_hashes.size() * sizeof(uint64_t));
+    hashes_stream.close();
+
+    return true;
+}
+
+void MovieFileHashes::setHash(uint64_t frame, uint64_t hash)
+{
+    setFrameHash(hashes, frame, hash);
+}
+
+bool MovieFileHashes::checkHash(uint64_t frame, uint64_t hash)
+{
+    return checkFrameHash(hashes, frame, hash, first_desync);
+}
+
+void MovieFileHashes::setAudioHash(uint64_t frame, uint64_t hash)
+{
+    setFrameHash(audio_hashes, frame, hash);
+}
+
+bool MovieFileHashes::checkAudioHash(uint64_t frame, uint64_t hash)
+{
+    return checkFrameHash(audio_hashes, frame, hash, first_desync);
+}
@@ -0,0 +1,77 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_MOVIEFILEHASHES_H_INCLUDED
+#define LIBTAS_MOVIEFILEHASHES_H_INCLUDED
+
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+struct Context;
+
+/* Hashes of game memory ranges and fingerprints of the game audio, computed
+ * by the game at each frame boundary. They are stored inside the movie file
+ * in a compact binary stream, and used to detect the first frame where a
+ * playback diverges from the recording.
+ * A hash value of zero means that the hash of that frame is unknown.
+ */
+class MovieFileHashes {
+public:
+    /* List of memory ranges (address, size) used to compute the hashes */
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+
+    /* Hash of the state at each frame */
+    std::vector<uint64_t> hashes;
+
+    /* Fingerprint of the audio at each frame */
+    std::vector<uint64_t> audio_hashes;
+
+    /* First frame where a hash mismatch was detected, or -1 */
+    int64_t first_desync = -1;
+
+    /* Prepare a movie file from the context */
+    MovieFileHashes(Context* c);
+
+    /* Clear */
+    void clear();
+
+    /* Import the hashes from the hashes file */
+    void load();
+
+    /* Write the hashes file. Returns if the file must be part of the movie */
+    bool save();
+
+    /* Store the hash of a frame. Hashes of the following frames are removed,
+     * because they were made with different inputs */
+    void setHash(uint64_t frame, uint64_t hash);
+
+    /* Compare the hash of a frame with the stored one. Returns false if it
+     * does not match, and updates the first desync frame */
+    bool checkHash(uint64_t frame, uint64_t hash);
+
+    /* Same as setHash() and checkHash() for audio fingerprints */
+    void setAudioHash(uint64_t frame, uint64_t hash);
+    bool checkAudioHash(uint64_t frame, uint64_t hash);
+
+private:
+    Context* context;
+};
+
+#endif
@@ -562,23 +562,61 @@ void MovieFileInputs::wasModified()
 uint64_t MovieFileInputs::processEvent()
 {
     /* Process input events */
-    while (!input_event_queue.empty()) {
-        InputEvent ie;
-        input_event_queue.pop(ie);
-        
+    InputEvent ie;
+    while (input_event_queue.pop(ie)) {
         /* Check for setting inputs before current framecount */
-        if (ie.framecount < context->framecount)
+        if (ie.framecount < context->framecount) {
+            processed_count.fetch_add(1, std::memory_order_release);
             continue;
+        }
         
         std::unique_lock<std::mutex> lock(input_list_mutex);
 
-        if (ie.framecount >= input_list.size())
+        if (ie.framecount >= input_list.size()) {
+            processed_count.fetch_add(1, std::memory_order_release);
             continue;
+        }
 
         AllInputs& ai = input_list[ie.framecount];        
         ai.setInput(ie.si, ie.value);
         wasModified();
+
+        /* Only count the change once applied, so that the UI never sees it
+         * neither pending nor in the input list */
+        processed_count.fetch_add(1, std::memory_order_release);
         return ie.framecount;
     }
     return UINT64_MAX;
 }
+
+void MovieFileInputs::queueInput(const InputEvent& ie)
+{
+    /* Forget about the previous changes once they have all been processed */
+    if (processed_count.load(std::memory_order_acquire) >= queued_count)
+        pending_inputs.clear();
+
+    pending_inputs[std::make_pair(ie.framecount, ie.si)] = {ie.value, queued_count};
+    queued_count++;
+    input_event_queue.push(ie);
+}
+
+bool MovieFileInputs::pendingInput(uint64_t framecount, const SingleInput& si, int& value)
+{
+    uint64_t processed = processed_count.load(std::memory_order_acquire);
+    if (processed >= queued_count)
+        return false;
+
+    auto it = pending_inputs.find(std::make_pair(framecount, si));
+    if (it == pending_inputs.end())
+        return false;
+
+    /* Changes are processed in order, so if the last change of this input was
+     * processed, there is no pending change left */
+    if (it->second.change < processed) {
+        pending_inputs.erase(it);
+        return false;
+    }
+
+    value = it->second.value;
+    return true;
+}
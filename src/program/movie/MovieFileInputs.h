@@ -20,14 +20,17 @@
 #ifndef LIBTAS_MOVIEFILEINPUTS_H_INCLUDED
 #define LIBTAS_MOVIEFILEINPUTS_H_INCLUDED
 
-#include "ConcurrentQueue.h"
+#include "SPSCQueue.h"
 #include "../shared/inputs/AllInputs.h"
 
 #include <fstream>
 #include <string>
 #include <vector>
 #include <set>
+#include <map>
+#include <utility>
 #include <mutex>
+#include <atomic>
 #include <stdint.h>
 
 struct Context;
@@ -59,9 +62,6 @@ public:
     /* Initial framerate values */
     unsigned int framerate_num, framerate_den;
 
-    /* Queue of movie input changes that where pushed by the UI, to process by the main thread */
-    ConcurrentQueue<InputEvent> input_event_queue;
-
     /* Prepare a movie file from the context */
     MovieFileInputs(Context* c);
 
@@ -131,6 +131,15 @@ public:
      * If no event left, returns UINT64_MAX */
     uint64_t processEvent();
 
+    /* Push an input change from the UI thread, to be processed by the main
+     * thread */
+    void queueInput(const InputEvent& ie);
+
+    /* Returns if an input change is pending for this frame and single input,
+     * and fills the value of the most recent change. Lookup is done without
+     * going through the queue, so it can be called when drawing each cell. */
+    bool pendingInput(uint64_t framecount, const SingleInput& si, int& value);
+
 private:
     Context* context;
 
@@ -141,6 +150,26 @@ private:
      * threads can read and write to the list */
     std::mutex input_list_mutex;
 
+    /* Queue of movie input changes that where pushed by the UI, to process by
+     * the main thread. Only the UI thread pushes, so that it never blocks
+     * the main thread when editing many inputs at once. */
+    SPSCQueue<InputEvent, 4096> input_event_queue;
+
+    /* Most recent value and change number of each frame and single input
+     * pushed to the queue, so that the UI can look up pending changes without
+     * a lock. Only accessed by the UI thread. */
+    struct PendingInput {
+        int value;
+        uint64_t change;
+    };
+    std::map<std::pair<uint64_t, SingleInput>, PendingInput> pending_inputs;
+
+    /* Number of input changes pushed by the UI thread */
+    uint64_t queued_count = 0;
+
+    /* Number of input changes popped by the main thread */
+    std::atomic<uint64_t> processed_count{0};
+
     /* Read the keyboard input string */
     int readKeyboardFrame(std::istringstream& input_string, AllInputs& inputs);
 
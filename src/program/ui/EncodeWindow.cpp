@@ -76,6 +76,18 @@ EncodeWindow::EncodeWindow(Context* c, QWidget *parent) : QDialog(parent), conte
 
     ffmpegOptions = new QLineEdit();
 
+    yuvConversion = new QCheckBox("Convert to YUV 4:2:0 inside the game");
+    yuvConversion->setToolTip("Send smaller frames to ffmpeg, which speeds up encoding at large resolutions. Encodes are not lossless anymore");
+
+    videoDownscale = new QComboBox();
+    videoDownscale->addItem("None", 1);
+    videoDownscale->addItem("1/2", 2);
+    videoDownscale->addItem("1/4", 4);
+    connect(yuvConversion, &QAbstractButton::toggled, videoDownscale, &QWidget::setEnabled);
+
+    skipDuplicates = new QCheckBox("Skip duplicate frames");
+    skipDuplicates->setToolTip("Identical frames are not sent, the previous frame lasts longer instead. This produces a variable framerate video, unless an output framerate is set with the -r option");
+
     QGroupBox *codecGroupBox = new QGroupBox(tr("Encode codec settings"));
     QGridLayout *encodeCodecLayout = new QGridLayout;
     encodeCodecLayout->addWidget(new QLabel(tr("Video codec:")), 0, 0);
@@ -93,6 +105,10 @@ EncodeWindow::EncodeWindow(Context* c, QWidget *parent) : QDialog(parent), conte
 
     encodeCodecLayout->addWidget(new QLabel(tr("Video framerate:")), 3, 0);
     encodeCodecLayout->addWidget(videoFramerate, 3, 1, 1, 4);
+    encodeCodecLayout->addWidget(yuvConversion, 4, 0, 1, 2);
+    encodeCodecLayout->addWidget(new QLabel(tr("Downscale:")), 4, 3);
+    encodeCodecLayout->addWidget(videoDownscale, 4, 4);
+    encodeCodecLayout->addWidget(skipDuplicates, 5, 0, 1, 2);
 
     encodeCodecLayout->setColumnMinimumWidth(2, 50);
     encodeCodecLayout->setColumnStretch(2, 1);
@@ -147,6 +163,15 @@ void EncodeWindow::update_config()
     else
         videoFramerate->setValue(context->config.sc.initial_framerate_num / context->config.sc.initial_framerate_den);
 
+    /* Set in-game conversion */
+    yuvConversion->setChecked(context->config.sc.video_yuv_conversion);
+    int downscaleIndex = videoDownscale->findData(context->config.sc.video_downscale);
+    videoDownscale->setCurrentIndex((downscaleIndex >= 0) ? downscaleIndex : 0);
+    videoDownscale->setEnabled(context->config.sc.video_yuv_conversion);
+
+    /* Set duplicate frames */
+    skipDuplicates->setChecked(context->config.sc.video_skip_duplicates);
+
     if (context->config.ffmpegoptions.empty()) {
         slotUpdate();
     }
@@ -216,6 +241,9 @@ void EncodeWindow::slotOk()
     context->config.ffmpegoptions = ffmpegOptions->text().toStdString();
 
     context->config.sc.video_framerate = videoFramerate->value();
+    context->config.sc.video_yuv_conversion = yuvConversion->isChecked();
+    context->config.sc.video_downscale = videoDownscale->currentData().toInt();
+    context->config.sc.video_skip_duplicates = skipDuplicates->isChecked();
 
     context->config.sc_modified = true;
 
@@ -25,6 +25,7 @@
 #include <QtWidgets/QLineEdit>
 #include <QtWidgets/QComboBox>
 #include <QtWidgets/QSpinBox>
+#include <QtWidgets/QCheckBox>
 
 /* Forward declaration */
 struct Context;
@@ -49,6 +50,9 @@ private:
     QSpinBox *audioBitrate;
     QLineEdit *ffmpegOptions;
     QSpinBox *videoFramerate;
+    QCheckBox *yuvConversion;
+    QComboBox *videoDownscale;
+    QCheckBox *skipDuplicates;
 
 private slots:
     void slotBrowseEncodePath();
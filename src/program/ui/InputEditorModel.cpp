@@ -35,8 +35,14 @@
 #include <sstream>
 #include <iostream>
 #include <set>
+#include <algorithm>
 
-InputEditorModel::InputEditorModel(Context* c, MovieFile* m, QObject *parent) : QAbstractTableModel(parent), context(c), movie(m) {}
+InputEditorModel::InputEditorModel(Context* c, MovieFile* m, QObject *parent) : QAbstractTableModel(parent), context(c), movie(m)
+{
+    savestateFont.setBold(true);
+    markerFont.setStretch(QFont::ExtraExpanded);
+    markerFont.setBold(true);
+}
 
 int InputEditorModel::rowCount(const QModelIndex & /*parent*/) const
 {
@@ -125,15 +131,14 @@ QVariant InputEditorModel::data(const QModelIndex &index, int role) const
     }
 
     if (role == Qt::FontRole) {
-        QFont font;
+        /* Fonts are built once, and other cells use the view font */
         if (index.column() == COLUMN_SAVESTATE && row == last_savestate) {
-            font.setBold(true);
+            return savestateFont;
         }
         else if (index.column() == COLUMN_FRAME && movie->editor->markers.count(row)) {
-            font.setStretch(QFont::ExtraExpanded);
-            font.setBold(true);
+            return markerFont;
         }
-        return font;
+        return QVariant();
     }
 
     if (role == Qt::ForegroundRole) {
@@ -148,32 +153,24 @@ QVariant InputEditorModel::data(const QModelIndex &index, int role) const
         const SingleInput si = movie->editor->input_set[index.column()-COLUMN_SPECIAL_SIZE];
 
         /* Show inputs with transparancy when they are pending due to rewind */
-        bool pending_input = false;
-        movie->inputs->input_event_queue.lock();
-        for (auto it = movie->inputs->input_event_queue.begin(); it != movie->inputs->input_event_queue.end(); it++) {
-            if (it->framecount != row)
-                continue;
-
-            if (si == it->si) {
-                pending_input = true;
-                /* For analog, use half-transparancy. Otherwise,
-                 * use strong/weak transparancy of set/clear input */
-                if (si.isAnalog()) {
-                    color.setAlpha(128);
+        int pending_value;
+        bool pending_input = movie->inputs->pendingInput(row, si, pending_value);
+        if (pending_input) {
+            /* For analog, use half-transparancy. Otherwise,
+             * use strong/weak transparancy of set/clear input. Only the
+             * most recent change of the same input is considered. */
+            if (si.isAnalog()) {
+                color.setAlpha(128);
+            }
+            else {
+                if (pending_value) {
+                    color.setAlpha(192);
                 }
                 else {
-                    if (it->value) {
-                        color.setAlpha(192);
-                    }
-                    else {
-                        color.setAlpha(64);
-                    }
+                    color.setAlpha(64);
                 }
-                /* We don't return the brush immediatly, because users may change
-                 * multiple times the same input. */
             }
         }
-        movie->inputs->input_event_queue.unlock();
 
         /* If hovering on the cell, show a preview of the input for the following:
          * - the cell is blank
@@ -313,23 +310,18 @@ QVariant InputEditorModel::data(const QModelIndex &index, int role) const
         }
 
         /* If the value is currently being modified, load the new value */
-        movie->inputs->input_event_queue.lock();
-        for (auto it = movie->inputs->input_event_queue.begin(); it != movie->inputs->input_event_queue.end(); it++) {
-            if (it->framecount != row)
-                continue;
-            if (si == it->si) {
-                if (si.isAnalog()) {
-                    value = it->value;
-                }
-                else {
-                    /* For non-analog values, always print the value, and the
-                     * transparancy value will indicate if the value is being
-                     * cleared or set. */
-                    value = 1;
-                }
+        int pending_value;
+        if (movie->inputs->pendingInput(row, si, pending_value)) {
+            if (si.isAnalog()) {
+                value = pending_value;
+            }
+            else {
+                /* For non-analog values, always print the value, and the
+                 * transparancy value will indicate if the value is being
+                 * cleared or set. */
+                value = 1;
             }
         }
-        movie->inputs->input_event_queue.unlock();
 
         if (si.isAnalog()) {
             /* Default framerate has a value of 0, which may be confusing,
@@ -425,7 +417,7 @@ bool InputEditorModel::setData(const QModelIndex &index, const QVariant &value,
         ie.framecount = row;
         ie.si = si;
         ie.value = value.toInt();
-        movie->inputs->input_event_queue.push(ie);
+        movie->inputs->queueInput(ie);
         emit dataChanged(index, index, {role});
         return true;
     }
@@ -512,7 +504,7 @@ bool InputEditorModel::toggleInput(const QModelIndex &index)
     ie.framecount = row;
     ie.si = si;
     ie.value = !ai.getInput(si);
-    movie->inputs->input_event_queue.push(ie);
+    movie->inputs->queueInput(ie);
     emit dataChanged(index, index);
     return ie.value;
 }
@@ -841,7 +833,7 @@ void InputEditorModel::clearUniqueInput(int column)
         ie.framecount = f;
         ie.si = si;
         ie.value = 0;
-        movie->inputs->input_event_queue.push(ie);
+        movie->inputs->queueInput(ie);
     }
 }
 
@@ -862,7 +854,7 @@ bool InputEditorModel::removeUniqueInput(int column)
         ie.framecount = f;
         ie.si = si;
         ie.value = 0;
-        movie->inputs->input_event_queue.push(ie);
+        movie->inputs->queueInput(ie);
     }
 
     /* Remove clear locked state */
@@ -965,9 +957,12 @@ void InputEditorModel::update()
         emit inputSetChanged();
     }
     else {
-        emit dataChanged(index(context->framecount,0), index(context->framecount,columnCount()-1));
-        // emit dataChanged(index(0,0), index(rowCount(),columnCount()));
+        /* Only refresh the rows whose status changed since last update */
+        uint64_t first_row = std::min(last_update_frame, context->framecount);
+        uint64_t last_row = std::max(last_update_frame, context->framecount);
+        emit dataChanged(index(first_row,0), index(last_row,columnCount()-1));
     }
+    last_update_frame = context->framecount;
 }
 
 void InputEditorModel::resetInputs()
@@ -1107,8 +1102,13 @@ void InputEditorModel::setHoveredCell(const QModelIndex &i)
     
     const QModelIndex old = hoveredIndex;
     hoveredIndex = i;
-    emit dataChanged(index(0,old.column()), index(rowCount(),old.column()), roles);
-    emit dataChanged(index(0,hoveredIndex.column()), index(rowCount(),hoveredIndex.column()), QVector<int>(1, Qt::BackgroundRole));
+
+    /* Only the previous hovered cell shows a different input preview. Column
+     * highlighting is only drawn in the header. */
+    if (old.isValid())
+        emit dataChanged(old, old, roles);
+    if (hoveredIndex.isValid())
+        emit dataChanged(hoveredIndex, hoveredIndex, roles);
     emit headerDataChanged(Qt::Horizontal, old.column(), old.column());
     emit headerDataChanged(Qt::Horizontal, hoveredIndex.column(), hoveredIndex.column());
 }
@@ -21,6 +21,7 @@
 #define LIBTAS_INPUTEDITORMODEL_H_INCLUDED
 
 #include <QtCore/QAbstractTableModel>
+#include <QtGui/QFont>
 #include <vector>
 #include <sstream>
 #include <stdint.h>
@@ -175,11 +176,18 @@ private:
     /* Framecount of the last invalidation */
     uint64_t invalid_frame = 0;
 
+    /* Framecount of the last table update */
+    uint64_t last_update_frame = 0;
+
     /* Freeze the vertical scroll, used for rewind */
     bool freeze_scroll = false;
 
     /* Current hovered cell */
     QModelIndex hoveredIndex;
+
+    /* Fonts for the last savestate and marker cells */
+    QFont savestateFont;
+    QFont markerFont;
     
 signals:
     void inputSetChanged();
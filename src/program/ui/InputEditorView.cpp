@@ -187,16 +187,16 @@ void InputEditorView::resizeAllColumns()
     horizontalHeader()->resizeSection(InputEditorModel::COLUMN_FRAME, 80);
 
     /* Set analog columns to be resizable by users.
-     * Increase the other columns by a small amount, because even if it's
-     * supposed to take the same place as the header, sometimes it considers
-     * that it doesn't have enough space. */
+     * Other columns only show the input label when set, which is the same
+     * text as the header, so we size them from the header alone instead of
+     * going through the rows. Increase them by a small amount, because
+     * sometimes it considers that it doesn't have enough space. */
     for (int c = InputEditorModel::COLUMN_SPECIAL_SIZE; c < inputEditorModel->columnCount(); c++) {
         if (inputEditorModel->isInputAnalog(c)) {
             horizontalHeader()->setSectionResizeMode(c, QHeaderView::Interactive);
         }
         else {
-            resizeColumnToContents(c);
-            int size = horizontalHeader()->sectionSize(c);
+            int size = horizontalHeader()->sectionSizeHint(c);
             horizontalHeader()->resizeSection(c, size + 2);
         }
     }
@@ -390,7 +390,8 @@ void InputEditorView::wheelEvent(QWheelEvent *event)
 
     if (event->angleDelta().y() < 0) {
         /* Push a single frame advance event */
-        if (context->hotkey_pressed_queue.empty() || context->hotkey_pressed_queue.back() != HOTKEY_FRAMEADVANCE) {
+        HotKeyType last_hotkey;
+        if (!context->hotkey_pressed_queue.back(last_hotkey) || last_hotkey != HOTKEY_FRAMEADVANCE) {
             context->hotkey_pressed_queue.push(HOTKEY_FRAMEADVANCE);
             context->hotkey_released_queue.push(HOTKEY_FRAMEADVANCE);
         }
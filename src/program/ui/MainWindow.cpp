@@ -23,6 +23,7 @@
 #include "InputWindow.h"
 #include "ControllerTabWindow.h"
 #include "GameInfoWindow.h"
+#include "PerfWindow.h"
 #include "RamSearchWindow.h"
 #include "RamWatchWindow.h"
 #include "RamWatchView.h"
@@ -169,6 +170,7 @@ MainWindow::MainWindow(Context* c) : QMainWindow(), context(c)
     inputEditorWindow = new InputEditorWindow(c, this);
     annotationsWindow = new AnnotationsWindow(c, this);
     timeTraceWindow = new TimeTraceWindow(c, this);
+    perfWindow = new PerfWindow(&gameLoop->perfMonitor, this);
     luaConsoleWindow = new LuaConsoleWindow(c, this);
 
     connect(gameLoop, &GameLoop::inputsToBeChanged, inputEditorWindow->inputEditorView->inputEditorModel, &InputEditorModel::beginModifyInputs);
@@ -574,6 +576,7 @@ void MainWindow::createActions()
 
     addActionCheckable(fastforwardGroup, tr("Skipping sleep"), SharedConfig::FF_SLEEP);
     addActionCheckable(fastforwardGroup, tr("Skipping audio mixing"), SharedConfig::FF_MIXING);
+    addActionCheckable(fastforwardGroup, tr("Computing audio fingerprint"), SharedConfig::FF_AUDIO_FINGERPRINT);
 
     fastforwardRenderGroup = new QActionGroup(this);
     connect(fastforwardRenderGroup, &QActionGroup::triggered, this, LAMBDARADIOSLOT(fastforwardRenderGroup, context->config.sc.fastforward_render));
@@ -676,6 +679,7 @@ void MainWindow::createMenus()
     disabledActionsOnStart.append(busyloopAction);
 
     toolsMenu->addAction(tr("Time Trace..."), timeTraceWindow, &TimeTraceWindow::show);
+    toolsMenu->addAction(tr("Performance counters..."), perfWindow, &PerfWindow::show);
 
 
     /* Input Menu */
@@ -61,6 +61,7 @@ class OsdWindow;
 class AnnotationsWindow;
 class AutoSaveWindow;
 class TimeTraceWindow;
+class PerfWindow;
 class LuaConsoleWindow;
 
 class MainWindow : public QMainWindow
@@ -92,6 +93,7 @@ public:
     AnnotationsWindow* annotationsWindow;
     AutoSaveWindow* autoSaveWindow;
     TimeTraceWindow* timeTraceWindow;
+    PerfWindow* perfWindow;
     LuaConsoleWindow* luaConsoleWindow;
 
     QList<QWidget*> disabledWidgetsOnStart;
@@ -0,0 +1,99 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PerfWindow.h"
+#include "PerfMonitor.h"
+
+#include <QtWidgets/QVBoxLayout>
+#include <QtWidgets/QHeaderView>
+
+PerfWindow::PerfWindow(PerfMonitor *pm, QWidget *parent) : QDialog(parent), perfMonitor(pm)
+{
+    setWindowTitle("Performance counters");
+
+    frameLabel = new QLabel(tr("No game running"));
+
+    /* Table */
+    counterTable = new QTableWidget(PerfCounters::COUNTER_COUNT, 6, this);
+    counterTable->setHorizontalHeaderLabels({tr("Counter"), tr("Frame (ms)"), tr("Frame calls"), tr("Total (s)"), tr("Total calls"), tr("Median call (us)")});
+    counterTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    counterTable->setSelectionMode(QAbstractItemView::NoSelection);
+    counterTable->setShowGrid(false);
+    counterTable->setAlternatingRowColors(true);
+    counterTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    counterTable->verticalHeader()->setDefaultSectionSize(counterTable->verticalHeader()->minimumSectionSize());
+    counterTable->verticalHeader()->hide();
+
+    for (int c = 0; c < PerfCounters::COUNTER_COUNT; c++) {
+        counterTable->setItem(c, 0, new QTableWidgetItem(PerfCounters::name(c)));
+        for (int col = 1; col < 6; col++) {
+            QTableWidgetItem *item = new QTableWidgetItem();
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            counterTable->setItem(c, col, item);
+        }
+    }
+
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addWidget(frameLabel);
+    mainLayout->addWidget(counterTable);
+    setLayout(mainLayout);
+
+    /* Counters are only read by the game loop, we poll the last values */
+    updateTimer = new QTimer(this);
+    connect(updateTimer, &QTimer::timeout, this, &PerfWindow::update);
+    updateTimer->start(500);
+}
+
+void PerfWindow::update()
+{
+    if (!isVisible())
+        return;
+
+    PerfCounters::Data data;
+    if (!perfMonitor->get(data))
+        return;
+
+    frameLabel->setText(tr("Frame %1").arg(data.framecount));
+
+    for (int c = 0; c < PerfCounters::COUNTER_COUNT; c++) {
+        const PerfCounters::Value& value = data.values[c];
+        counterTable->item(c, 1)->setText(QString::number(value.frame_ns / 1000000.0, 'f', 3));
+        counterTable->item(c, 2)->setText(QString::number(value.frame_calls));
+        counterTable->item(c, 3)->setText(QString::number(value.total_ns / 1000000000.0, 'f', 3));
+        counterTable->item(c, 4)->setText(QString::number(value.total_calls));
+
+        /* Upper bound of the histogram bucket containing the median call */
+        uint64_t count = 0;
+        for (int b = 0; b < PERF_HISTOGRAM_SIZE; b++)
+            count += value.histogram[b];
+
+        QString median;
+        if (count > 0) {
+            uint64_t cumul = 0;
+            for (int b = 0; b < PERF_HISTOGRAM_SIZE; b++) {
+                cumul += value.histogram[b];
+                if (2 * cumul >= count) {
+                    median = (b == PERF_HISTOGRAM_SIZE - 1) ? QString(">= %1").arg(1 << (b - 1)) : QString("< %1").arg(1 << b);
+                    break;
+                }
+            }
+        }
+        counterTable->item(c, 5)->setText(median);
+    }
+}
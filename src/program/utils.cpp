@@ -23,6 +23,7 @@
 #include <sys/stat.h>
 #include <cerrno> // errno
 #include <cstring> // strerror
+#include <cstdlib> // strtoull
 #include <iostream>
 #include <unistd.h> // unlink
 
@@ -237,3 +238,18 @@ std::string queryCmd(const std::string& cmd, int* status)
     outputstr = (end == std::string::npos) ? "" : outputstr.substr(0, end + 1);
     return outputstr;
 }
+
+bool parseMemoryRange(const char* str, uint64_t* addr, uint64_t* size)
+{
+    char* end;
+    *addr = std::strtoull(str, &end, 16);
+    if ((end == str) || (*end != ':'))
+        return false;
+
+    const char* sizestr = end + 1;
+    *size = std::strtoull(sizestr, &end, 16);
+    if ((end == sizestr) || (*end != '\0') || (*size == 0))
+        return false;
+
+    return true;
+}
@@ -21,6 +21,7 @@
 #define LIBTAS_UTILS_H_INCLUDED
 
 #include <string>
+#include <stdint.h>
 
 /* Forward declaration */
 struct Context;
@@ -64,4 +65,8 @@ std::string extractMacOSExecutable(std::string path);
 /* Get the result of a shell command */
 std::string queryCmd(const std::string& cmd, int* status = nullptr);
 
+/* Parse a memory range in the form ADDR:SIZE, with both values in hexadecimal.
+ * Returns false if the string could not be parsed. */
+bool parseMemoryRange(const char* str, uint64_t* addr, uint64_t* size);
+
 #endif
@@ -0,0 +1,72 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_LUADRAWRECORD_H_INCLUDED
+#define LIBTAS_LUADRAWRECORD_H_INCLUDED
+
+#include <stdint.h>
+
+/* Maximum number of lua primitives drawn in a frame */
+#define LUA_DRAW_MAX_RECORDS 65536
+/* Maximum total size of lua texts drawn in a frame */
+#define LUA_DRAW_MAX_TEXT (1 << 20)
+
+/*
+ * Compact description of a lua drawing primitive, which is sent as-is to the
+ * game. The index of a record in the frame draw list is used as its ID, so
+ * that a script drawing the same primitives in the same order each frame only
+ * sends the primitives that changed.
+ */
+struct LuaDrawRecord {
+    enum Type {
+        LUA_DRAW_TEXT,
+        LUA_DRAW_PIXEL,
+        LUA_DRAW_RECT,
+        LUA_DRAW_LINE,
+        LUA_DRAW_ELLIPSE,
+    };
+
+    int32_t type;
+
+    /* Position of the primitive. For rectangles, (x1, y1) is the size, and
+     * for ellipses, (x0, y0) is the center and (x1, y1) the radii */
+    int32_t x0;
+    int32_t y0;
+    int32_t x1;
+    int32_t y1;
+
+    /* Color as 0xaarrggbb */
+    uint32_t color;
+
+    /* Rectangle outline thickness */
+    int32_t thickness;
+
+    /* Filled rectangle or monospace text */
+    int32_t flag;
+
+    /* Text parameters, the text itself is stored in the text buffer at offset
+     * `text_offset` and is not null-terminated */
+    float anchor_x;
+    float anchor_y;
+    float font_size;
+    uint32_t text_offset;
+    uint32_t text_size;
+};
+
+#endif
@@ -0,0 +1,120 @@
+/*
+    Copyright 2015-2023 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_PERFCOUNTERS_H_INCLUDED
+#define LIBTAS_PERFCOUNTERS_H_INCLUDED
+
+#include <atomic>
+#include <cstring>
+#include <stdint.h>
+
+/* Number of buckets in the duration histogram of each counter. Bucket 0
+ * counts calls shorter than 1 microsecond, and bucket i counts calls that
+ * took between 2^(i-1) and 2^i microseconds. The last bucket counts all
+ * longer calls. */
+#define PERF_HISTOGRAM_SIZE 16
+
+/*
+ * Performance counters of the game. They are updated by the game at each
+ * frame boundary, inside the memory that it shares with the program, so that
+ * the program can show or export them without any message.
+ */
+struct PerfCounters {
+    enum Counter {
+        /* Same order as the PerfTimer timers */
+        GAME = 0,
+        FRAME,
+        RENDER,
+        IDLE,
+        WAIT,
+        TIME,
+        SPECIAL,
+
+        SAVESTATE,
+        LOADSTATE,
+        STATE_IO,
+        AUDIO_MIX,
+        CAPTURE,
+        ENCODE,
+        READBACK,
+        HOOK_CALLS,
+        SOCKET_SYSCALLS,
+        COUNTER_COUNT
+    };
+
+    struct Value {
+        /* Time spent and number of calls during the last frame */
+        uint64_t frame_ns;
+        uint64_t frame_calls;
+
+        /* Time spent and number of calls since the game startup */
+        uint64_t total_ns;
+        uint64_t total_calls;
+
+        /* Histogram of call durations since the game startup */
+        uint32_t histogram[PERF_HISTOGRAM_SIZE];
+    };
+
+    struct Data {
+        /* Frame of the last update */
+        uint64_t framecount;
+
+        Value values[COUNTER_COUNT];
+    };
+
+    /* Incremented before and after each update, so it is odd while the
+     * counters are being written */
+    std::atomic<uint32_t> sequence;
+
+    Data data;
+
+    static const char* name(int counter)
+    {
+        static const char* const names[COUNTER_COUNT] = {
+            "game", "frame", "render", "idle", "wait", "time", "special",
+            "savestate", "loadstate", "state_io", "audio_mix", "capture", "encode",
+            "readback", "hook_calls", "socket_syscalls"
+        };
+        return names[counter];
+    }
+
+    void beginWrite()
+    {
+        sequence.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void endWrite()
+    {
+        sequence.fetch_add(1, std::memory_order_release);
+    }
+
+    /* Copy the counters. Returns false if they were being written */
+    bool read(Data& out) const
+    {
+        uint32_t seq = sequence.load(std::memory_order_acquire);
+        if (seq & 1)
+            return false;
+        memcpy(&out, &data, sizeof(Data));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence.load(std::memory_order_relaxed) == seq;
+    }
+};
+
+#endif
@@ -32,6 +32,7 @@ struct __attribute__((packed, aligned(8))) SharedConfig {
     enum FastForwardMode {
         FF_SLEEP = 0x01, // Skips sleep calls
         FF_MIXING = 0x02, // Skips audio mixing
+        FF_AUDIO_FINGERPRINT = 0x04, // Computes an audio fingerprint at each frame, even when audio mixing is skipped
     };
     int fastforward_mode = FF_SLEEP | FF_MIXING;
 
@@ -107,6 +108,7 @@ struct __attribute__((packed, aligned(8))) SharedConfig {
     int video_codec = VCODEC_X264;
     int video_bitrate = 4000;
     int video_framerate = 60; // used when variable framerate
+    int video_downscale = 1; // divide the encode dimensions by this factor
     int audio_codec = ACODEC_AAC;
     int audio_bitrate = 128;
 
@@ -251,6 +253,16 @@ struct __attribute__((packed, aligned(8))) SharedConfig {
     /* Savestate settings */
     int savestate_settings = SS_COMPRESSED;
 
+    /* Savestate slots. Slots 1 to 9 are used by hotkeys, slot 10 is the
+     * backtrack savestate, and remaining slots are for states created by
+     * Lua scripts */
+    enum SaveStateSlots
+    {
+        SLOT_BACKTRACK = 10,
+        SLOT_LUA_FIRST = 11,
+        SLOT_COUNT = 43,
+    };
+
     /* Stacktrace hash to advance time */
     uint64_t busy_loop_hash = 0;
 
@@ -278,6 +290,12 @@ struct __attribute__((packed, aligned(8))) SharedConfig {
     /* Display OSD in the video encode */
     bool osd_encode = false;
 
+    /* Convert frames to YUV 4:2:0 inside the game before sending them to ffmpeg */
+    bool video_yuv_conversion = false;
+
+    /* Skip duplicate frames in the encode, making the previous frame last longer */
+    bool video_skip_duplicates = false;
+
     /* Use a backup of savefiles in memory, which leaves the original
      * savefiles unmodified and save the content in savestates */
     bool prevent_savefiles = true;
@@ -203,6 +203,13 @@ enum {
      */
     MSGN_BASE_SAVESTATE_INDEX,
 
+    /*
+     * Ask the game to free the savestate stored in RAM, whose index was sent
+     * before
+     * Argument: none
+     */
+    MSGN_FREE_SAVESTATE,
+
     /*
      * Notify the program that encoding failed
      * Arguments: none
@@ -288,34 +295,15 @@ enum {
     MSGB_NONDRAW_FRAME,
 
     /*
-     * Send to the game a text to be displayed from a lua script.
-     * Argument: int x, int y, string text, uint32_t fg, uint32_t bg
+     * Send to the game the changes of the lua draw list since the last
+     * message. It is only sent when the draw list changed, the game keeps
+     * drawing the previous list otherwise.
+     * Argument: uint32_t record_count, bool text_changed,
+     *           [uint32_t text_size, char[text_size] texts],
+     *           uint32_t run_count, run_count * (uint32_t first,
+     *           uint32_t count, LuaDrawRecord[count] records)
      */
-    MSGN_LUA_TEXT,
-
-    /*
-     * Send to the game a pixel to be displayed from a lua script.
-     * Argument: int x, int y, uint32_t color
-     */
-    MSGN_LUA_PIXEL,
-
-    /*
-     * Send to the game a rectangle to be displayed from a lua script.
-     * Argument: int x, int y, int w, int h, int thickness, uint32_t outline, uint32_t fill
-     */
-    MSGN_LUA_RECT,
-
-    /*
-     * Send to the game a line to be displayed from a lua script.
-     * Argument: int x0, int y0, int x1, int y1, uint32_t color
-     */
-    MSGN_LUA_LINE,
-
-    /*
-     * Send to the game a line to be displayed from a lua script.
-     * Argument: int center_x, int center_y, int radius_x, int radius_y, uint32_t color
-     */
-    MSGN_LUA_ELLIPSE,
+    MSGN_LUA_DRAW_LIST,
 
     /*
      * Ask the game to send the screen resolution.
@@ -352,6 +340,36 @@ enum {
      * Argument: uint64_t addr
      */
     MSGN_SDL_DYNAPI_ADDR,
+
+    /*
+     * Send to the game a memory range to be hashed at each frame boundary
+     * Argument: uint64_t addr, uint64_t size
+     */
+    MSGN_STATE_HASH_RANGE,
+
+    /*
+     * Send the hash of the game memory ranges at the frame boundary
+     * Argument: uint64_t hash
+     */
+    MSGB_STATE_HASH,
+
+    /*
+     * Send the fingerprint of the audio mixed during the frame
+     * Argument: uint64_t hash
+     */
+    MSGB_AUDIO_HASH,
+
+    /*
+     * A batch of messages, sent in a single write. The payload contains
+     * regular messages with their arguments, which are read by the receiver
+     * as if they were sent individually.
+     * Argument: int (MSG_BATCH_VERSION), uint32_t (payload length) then
+     *           char[len]
+     */
+    MSG_MESSAGE_BATCH,
 };
 
+/* Version of the batch frame format */
+#define MSG_BATCH_VERSION 1
+
 #endif
@@ -18,6 +18,8 @@
  */
 
 #include "sockethelpers.h"
+#include "messages.h"
+#include "PerfCounters.h"
 
 #ifdef LIBTAS_LIBRARY
 #include "lcf.h"
@@ -30,13 +32,20 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
 #include <cstdlib>
+#include <cstring>
 #include <unistd.h>
 #include <sys/un.h>
 #include <iostream>
 #include <vector>
 #include <mutex>
+#include <atomic>
 #include <errno.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
 
 
 #define SOCKET_FILENAME "/tmp/libTAS.socket"
@@ -49,13 +58,301 @@
 using namespace libtas;
 #endif
 
+/* Path of the socket file. It can be changed with the LIBTAS_SOCKET_PATH
+ * environment variable, so that several games can run at the same time. */
+static const char* socketPath(void)
+{
+    const char* path = getenv("LIBTAS_SOCKET_PATH");
+    if (path && path[0])
+        return path;
+    return SOCKET_FILENAME;
+}
+
+static struct sockaddr_un socketAddress(void)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+#if defined(__APPLE__) && defined(__MACH__)
+    addr.sun_len = sizeof(struct sockaddr_un);
+#endif
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath(), sizeof(addr.sun_path) - 1);
+    return addr;
+}
+
 /* Socket to communicate between the program and the game */
 static int socket_fd = 0;
 
 static std::mutex mutex;
 
+/* Is a batch of messages being built, and its content. The beginning of the
+ * buffer is reserved for the batch header. */
+static bool batching = false;
+static std::vector<char> send_batch;
+
+/* Content of the last received batch, and current position in it */
+static std::vector<char> recv_batch;
+static size_t recv_batch_pos = 0;
+
+/* Size of the batch header: message, version and payload length */
+#define BATCH_HEADER_SIZE (2 * sizeof(int) + sizeof(uint32_t))
+
+/* Number of syscalls made by the message functions */
+static std::atomic<unsigned int> syscall_count(0);
+
+#ifdef __linux__
+/* Size of each ring of the shared channel, must be a power of two */
+#define CHANNEL_RING_SIZE (256 * 1024)
+
+/* Number of checks of a ring before sleeping on the futex */
+#define CHANNEL_SPIN_COUNT 4096
+
+/* After the socket connection is made, all messages go through a channel in
+ * shared memory, made of two single-producer single-consumer byte rings, one
+ * for each direction. Sending or receiving a message is a plain memcpy, and
+ * a futex syscall is only needed to wake a peer that is sleeping on an empty
+ * (or full) ring. The socket is only kept to detect when the peer is gone. */
+struct ChannelRing {
+    /* Total number of bytes written, futex word of the reader */
+    alignas(64) std::atomic<uint32_t> head;
+
+    /* Total number of bytes read, futex word of the writer */
+    alignas(64) std::atomic<uint32_t> tail;
+
+    /* Set when the reader or the writer is sleeping on the futex */
+    alignas(64) std::atomic<int> reader_waiting;
+    std::atomic<int> writer_waiting;
+
+    char data[CHANNEL_RING_SIZE];
+};
+
+struct Channel {
+    /* Rings from the program to the game, and from the game to the program */
+    ChannelRing rings[2];
+
+    /* Set when one side closed the connection */
+    std::atomic<int> closed;
+
+    /* Performance counters, written by the game */
+    PerfCounters perf;
+};
+
+#ifdef LIBTAS_LIBRARY
+static const int SEND_RING = 1;
+static const int RECV_RING = 0;
+#else
+static const int SEND_RING = 0;
+static const int RECV_RING = 1;
+#endif
+
+static Channel* channel = nullptr;
+
+static inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static void futexWait(std::atomic<uint32_t>* word, uint32_t value, const struct timespec* timeout)
+{
+    syscall_count++;
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, value, timeout, nullptr, 0);
+}
+
+static void futexWake(std::atomic<uint32_t>* word)
+{
+    syscall_count++;
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+/* Check if the other side has closed the connection or is gone */
+static bool isPeerClosed()
+{
+    if (channel->closed.load())
+        return true;
+
+    char c;
+    syscall_count++;
+    ssize_t ret = recv(socket_fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return (ret == 0);
+}
+
+/* Wait until `word` is different from `value`. Returns false if the peer
+ * closed the connection in the meantime. */
+static bool waitChannel(std::atomic<uint32_t>* word, uint32_t value, std::atomic<int>* waiting)
+{
+    /* Spinning is only useful if the peer can run at the same time */
+    static const int spin_count = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? CHANNEL_SPIN_COUNT : 0;
+
+    for (int i = 0; i < spin_count; i++) {
+        if (word->load(std::memory_order_acquire) != value)
+            return true;
+        cpuRelax();
+    }
+
+    while (true) {
+        waiting->store(1);
+        if (word->load() != value) {
+            waiting->store(0);
+            return true;
+        }
+
+        /* Wake up regularly to check that the peer is still there */
+        struct timespec timeout = {0, 100L*1000L*1000L};
+        futexWait(word, value, &timeout);
+        waiting->store(0);
+
+        if (word->load(std::memory_order_acquire) != value)
+            return true;
+
+        if (isPeerClosed())
+            return false;
+    }
+}
+
+static int sendChannel(const void* elem, unsigned int size)
+{
+    ChannelRing& ring = channel->rings[SEND_RING];
+    const char* src = static_cast<const char*>(elem);
+    unsigned int remaining = size;
+    uint32_t head = ring.head.load(std::memory_order_relaxed);
+
+    while (remaining > 0) {
+        uint32_t tail = ring.tail.load(std::memory_order_acquire);
+        uint32_t space = CHANNEL_RING_SIZE - (head - tail);
+        if (space == 0) {
+            /* Ring is full, wait for the reader */
+            if (!waitChannel(&ring.tail, tail, &ring.writer_waiting))
+                return -1;
+            continue;
+        }
+
+        uint32_t chunk = (remaining < space) ? remaining : space;
+        uint32_t offset = head & (CHANNEL_RING_SIZE - 1);
+        uint32_t first = (chunk < (CHANNEL_RING_SIZE - offset)) ? chunk : (CHANNEL_RING_SIZE - offset);
+        memcpy(ring.data + offset, src, first);
+        memcpy(ring.data, src + first, chunk - first);
+
+        head += chunk;
+        ring.head.store(head, std::memory_order_release);
+        src += chunk;
+        remaining -= chunk;
+
+        /* Wake the reader only if it is sleeping */
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ring.reader_waiting.load())
+            futexWake(&ring.head);
+    }
+
+    return size;
+}
+
+static int receiveChannel(void* elem, unsigned int size)
+{
+    ChannelRing& ring = channel->rings[RECV_RING];
+    char* dst = static_cast<char*>(elem);
+    unsigned int remaining = size;
+    uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+
+    while (remaining > 0) {
+        uint32_t head = ring.head.load(std::memory_order_acquire);
+        uint32_t avail = head - tail;
+        if (avail == 0) {
+            /* Ring is empty, wait for the writer */
+            if (!waitChannel(&ring.head, head, &ring.reader_waiting))
+                return 0;
+            continue;
+        }
+
+        uint32_t chunk = (remaining < avail) ? remaining : avail;
+        uint32_t offset = tail & (CHANNEL_RING_SIZE - 1);
+        uint32_t first = (chunk < (CHANNEL_RING_SIZE - offset)) ? chunk : (CHANNEL_RING_SIZE - offset);
+        memcpy(dst, ring.data + offset, first);
+        memcpy(dst + first, ring.data, chunk - first);
+
+        tail += chunk;
+        ring.tail.store(tail, std::memory_order_release);
+        dst += chunk;
+        remaining -= chunk;
+
+        /* Wake the writer only if it is sleeping */
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ring.writer_waiting.load())
+            futexWake(&ring.tail);
+    }
+
+    return size;
+}
+#endif
+
+#ifdef LIBTAS_LIBRARY
+/* Send the file descriptor of the shared channel over the socket, or -1 if
+ * there is no channel. */
+static bool sendChannelFd(int fd)
+{
+    int has_channel = (fd >= 0);
+    struct iovec iov = { &has_channel, sizeof(int) };
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    char control[CMSG_SPACE(sizeof(int))];
+    if (has_channel) {
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    return sendmsg(socket_fd, &msg, MSG_NOSIGNAL) == sizeof(int);
+}
+#else
+
+/* Receive the file descriptor of the shared channel. Returns -1 if there is
+ * no channel, and -2 on error. */
+static int receiveChannelFd()
+{
+    int has_channel = 0;
+    struct iovec iov = { &has_channel, sizeof(int) };
+
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t ret;
+    do {
+        ret = recvmsg(socket_fd, &msg, MSG_WAITALL);
+    } while ((ret == -1) && (errno == EINTR));
+
+    if (ret != sizeof(int))
+        return -2;
+
+    if (!has_channel)
+        return -1;
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || (cmsg->cmsg_level != SOL_SOCKET) || (cmsg->cmsg_type != SCM_RIGHTS))
+        return -2;
+
+    int fd;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    return fd;
+}
+#endif
+
 int removeSocket(void) {
-    int ret = unlink(SOCKET_FILENAME);
+    int ret = unlink(socketPath());
     if ((ret == -1) && (errno != ENOENT))
         return errno;
     return 0;
@@ -64,11 +361,7 @@ int removeSocket(void) {
 #ifndef LIBTAS_LIBRARY
 bool initSocketProgram(pid_t fork_pid)
 {
-#ifdef __unix__
-    const struct sockaddr_un addr = { AF_UNIX, SOCKET_FILENAME };
-#elif defined(__APPLE__) && defined(__MACH__)
-    const struct sockaddr_un addr = { sizeof(struct sockaddr_un), AF_UNIX, SOCKET_FILENAME };
-#endif
+    const struct sockaddr_un addr = socketAddress();
     socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
 
     struct timespec tim = {0, 500L*1000L*1000L};
@@ -102,6 +395,25 @@ bool initSocketProgram(pid_t fork_pid)
     }
     std::cout << "Attempt " << retry + 1 << ": Connected." << std::endl;
 
+    /* Map the shared channel created by the game */
+    int channel_fd = receiveChannelFd();
+    if (channel_fd == -2) {
+        std::cout << "Couldn't receive the shared channel." << std::endl;
+        return false;
+    }
+
+#ifdef __linux__
+    if (channel_fd >= 0) {
+        void* addr = mmap(nullptr, sizeof(Channel), PROT_READ | PROT_WRITE, MAP_SHARED, channel_fd, 0);
+        close(channel_fd);
+        if (addr == MAP_FAILED) {
+            std::cerr << "Couldn't map the shared channel: " << strerror(errno) << std::endl;
+            return false;
+        }
+        channel = static_cast<Channel*>(addr);
+    }
+#endif
+
     return true;
 }
 
@@ -115,16 +427,13 @@ bool initSocketGame(void)
      * the link is already done in another process of the game.
      * In this case, we just return immediately.
      */
+    const struct sockaddr_un addr = socketAddress();
+
     struct stat st;
-    int result = stat(SOCKET_FILENAME, &st);
+    int result = stat(addr.sun_path, &st);
     if (result == 0)
         return false;
 
-#ifdef __unix__
-    const struct sockaddr_un addr = { AF_UNIX, SOCKET_FILENAME };
-#elif defined(__APPLE__) && defined(__MACH__)
-    const struct sockaddr_un addr = { sizeof(struct sockaddr_un), AF_UNIX, SOCKET_FILENAME };
-#endif
     const int tmp_fd = socket(AF_UNIX, SOCK_STREAM, 0);
     if (bind(tmp_fd, reinterpret_cast<const struct sockaddr*>(&addr), sizeof(struct sockaddr_un)))
     {
@@ -155,9 +464,49 @@ bool initSocketGame(void)
 #endif
     
     close(tmp_fd);
+
+    /* Create the shared channel and send it to the program. If it fails, we
+     * fallback to sending messages through the socket. */
+    int channel_fd = -1;
+#ifdef __linux__
+    channel_fd = syscall(SYS_memfd_create, "libTAS-channel", 0);
+    if (channel_fd >= 0) {
+        void* addr = MAP_FAILED;
+        if (ftruncate(channel_fd, sizeof(Channel)) == 0)
+            addr = mmap(nullptr, sizeof(Channel), PROT_READ | PROT_WRITE, MAP_SHARED, channel_fd, 0);
+
+        if (addr == MAP_FAILED) {
+            debuglogstdio(LCF_SOCKET | LCF_ERROR, "Couldn't create the shared channel %s", strerror(errno));
+            close(channel_fd);
+            channel_fd = -1;
+        }
+        else {
+            /* memfd is zero-filled, which is the initial state of the rings */
+            channel = static_cast<Channel*>(addr);
+        }
+    }
+#endif
+
+    if (!sendChannelFd(channel_fd)) {
+        debuglogstdio(LCF_SOCKET | LCF_ERROR, "Couldn't send the shared channel %s", strerror(errno));
+        exit(-1);
+    }
+
+    if (channel_fd >= 0)
+        close(channel_fd);
+
     return true;
 }
 
+bool isChannelArea(const void* addr, size_t size)
+{
+#ifdef __linux__
+    return channel && (addr == channel) && (size >= sizeof(Channel));
+#else
+    return false;
+#endif
+}
+
 #endif
 
 void closeSocket(void)
@@ -165,6 +514,25 @@ void closeSocket(void)
 #ifdef LIBTAS_LIBRARY
     GlobalNative gn;
 #endif
+
+#ifdef __linux__
+    if (channel) {
+        /* Tell the other side, and wake it if it was waiting on us */
+        channel->closed.store(1);
+        for (int r = 0; r < 2; r++) {
+            futexWake(&channel->rings[r].head);
+            futexWake(&channel->rings[r].tail);
+        }
+        munmap(channel, sizeof(Channel));
+        channel = nullptr;
+    }
+#endif
+
+    /* Drop any leftover batch */
+    batching = false;
+    recv_batch.clear();
+    recv_batch_pos = 0;
+
     close(socket_fd);
 }
 
@@ -178,14 +546,26 @@ void unlockSocket(void)
     mutex.unlock();
 }
 
-int sendData(const void* elem, unsigned int size)
+/* Write data to the channel or the socket */
+static int writeData(const void* elem, unsigned int size)
 {
+#ifdef __linux__
+    if (channel) {
+        int ret = sendChannel(elem, size);
+        if (ret == -1) {
 #ifdef LIBTAS_LIBRARY
-    debuglogstdio(LCF_SOCKET, "Send socket data of size %u", size);
+            debuglogstdio(LCF_SOCKET | LCF_ERROR, "send() to closed channel");
+#else
+            std::cerr << "send() to closed channel" << std::endl;
+#endif
+        }
+        return ret;
+    }
 #endif
 
     ssize_t ret = 0;
     do {
+        syscall_count++;
         ret = send(socket_fd, elem, size, MSG_NOSIGNAL);
     } while ((ret == -1) && (errno == EINTR));
 
@@ -207,6 +587,65 @@ int sendData(const void* elem, unsigned int size)
     return ret;
 }
 
+void beginMessageBatch(void)
+{
+    if (batching)
+        return;
+
+    batching = true;
+    send_batch.resize(BATCH_HEADER_SIZE);
+}
+
+int flushMessageBatch(void)
+{
+    if (!batching)
+        return 0;
+
+    batching = false;
+    if (send_batch.size() == BATCH_HEADER_SIZE)
+        return 0;
+
+#ifdef LIBTAS_LIBRARY
+    debuglogstdio(LCF_SOCKET, "Send batch of size %zu", send_batch.size() - BATCH_HEADER_SIZE);
+#endif
+
+    /* Fill the header and send everything at once */
+    int header[2] = {MSG_MESSAGE_BATCH, MSG_BATCH_VERSION};
+    uint32_t payload_size = send_batch.size() - BATCH_HEADER_SIZE;
+    memcpy(send_batch.data(), header, sizeof(header));
+    memcpy(send_batch.data() + sizeof(header), &payload_size, sizeof(uint32_t));
+    return writeData(send_batch.data(), send_batch.size());
+}
+
+unsigned int fetchSocketSyscallCount(void)
+{
+    return syscall_count.exchange(0);
+}
+
+PerfCounters* getSharedPerfCounters(void)
+{
+#ifdef __linux__
+    if (channel)
+        return &channel->perf;
+#endif
+    return nullptr;
+}
+
+int sendData(const void* elem, unsigned int size)
+{
+#ifdef LIBTAS_LIBRARY
+    debuglogstdio(LCF_SOCKET, "Send socket data of size %u", size);
+#endif
+
+    if (batching) {
+        const char* data = static_cast<const char*>(elem);
+        send_batch.insert(send_batch.end(), data, data + size);
+        return size;
+    }
+
+    return writeData(elem, size);
+}
+
 int sendMessage(int message)
 {
 #ifdef LIBTAS_LIBRARY
@@ -226,14 +665,17 @@ void sendString(const std::string& str)
         sendData(str.c_str(), str_size);
 }
 
-int receiveData(void* elem, unsigned int size)
+/* Read data from the channel or the socket */
+static int readData(void* elem, unsigned int size)
 {
-#ifdef LIBTAS_LIBRARY
-    debuglogstdio(LCF_SOCKET, "Receive socket data of size %u", size);
-#endif
-
     ssize_t ret = 0;
+#ifdef __linux__
+    if (channel)
+        ret = receiveChannel(elem, size);
+    else
+#endif
     do {
+        syscall_count++;
         ret = recv(socket_fd, elem, size, MSG_WAITALL);
     } while ((ret == -1) && (errno == EINTR));
 
@@ -261,10 +703,71 @@ int receiveData(void* elem, unsigned int size)
     return ret;
 }
 
+/* Read the content of a batch, after its message was received. Returns false
+ * on error. */
+static bool readBatch()
+{
+    int version;
+    uint32_t payload_size;
+    if (readData(&version, sizeof(int)) != sizeof(int))
+        return false;
+    if (readData(&payload_size, sizeof(uint32_t)) != sizeof(uint32_t))
+        return false;
+
+    if (version != MSG_BATCH_VERSION) {
+#ifdef LIBTAS_LIBRARY
+        debuglogstdio(LCF_SOCKET | LCF_ERROR, "Unsupported batch version %d", version);
+#else
+        std::cerr << "Unsupported batch version " << version << std::endl;
+#endif
+        return false;
+    }
+
+    recv_batch.resize(payload_size);
+    recv_batch_pos = 0;
+    return readData(recv_batch.data(), payload_size) == static_cast<int>(payload_size);
+}
+
+int receiveData(void* elem, unsigned int size)
+{
+#ifdef LIBTAS_LIBRARY
+    debuglogstdio(LCF_SOCKET, "Receive socket data of size %u", size);
+#endif
+
+    /* Send our pending messages before waiting for the other side */
+    flushMessageBatch();
+
+    if (recv_batch_pos < recv_batch.size()) {
+        /* Read from the current batch */
+        size_t avail = recv_batch.size() - recv_batch_pos;
+        size_t chunk = (size < avail) ? size : avail;
+        memcpy(elem, recv_batch.data() + recv_batch_pos, chunk);
+        recv_batch_pos += chunk;
+        if (chunk == size)
+            return size;
+
+        /* Messages are not split between batches, but be safe */
+        int ret = readData(static_cast<char*>(elem) + chunk, size - chunk);
+        if (ret <= 0)
+            return ret;
+        return chunk + ret;
+    }
+
+    return readData(elem, size);
+}
+
 int receiveMessage()
 {
     int msg;
     int ret = receiveData(&msg, sizeof(int));
+
+    /* Unpack a batch and return its first message */
+    if ((ret == sizeof(int)) && (msg == MSG_MESSAGE_BATCH)) {
+        if (!readBatch())
+            return -1;
+        ret = receiveData(&msg, sizeof(int));
+    }
+
 #ifdef LIBTAS_LIBRARY
     debuglogstdio(LCF_SOCKET, "Receive socket message %d", msg);
 #endif
@@ -280,7 +783,29 @@ int receiveMessage()
 int receiveMessageNonBlocking()
 {
     int msg;
-    int ret = recv(socket_fd, &msg, sizeof(int), MSG_WAITALL | MSG_DONTWAIT);
+    int ret;
+
+    /* Send our pending messages before checking the other side */
+    flushMessageBatch();
+
+    /* Return the next message from the current batch if any */
+    if (recv_batch_pos < recv_batch.size())
+        return receiveMessage();
+
+#ifdef __linux__
+    if (channel) {
+        ChannelRing& ring = channel->rings[RECV_RING];
+        uint32_t avail = ring.head.load(std::memory_order_acquire) - ring.tail.load(std::memory_order_relaxed);
+        if (avail < sizeof(int))
+            return channel->closed.load() ? -2 : -1;
+        ret = receiveChannel(&msg, sizeof(int));
+    }
+    else
+#endif
+    {
+        syscall_count++;
+        ret = recv(socket_fd, &msg, sizeof(int), MSG_WAITALL | MSG_DONTWAIT);
+    }
     if (ret < 0)
         return ret;
 #ifdef LIBTAS_LIBRARY
@@ -291,6 +816,13 @@ int receiveMessageNonBlocking()
     if (ret == 0)
         return -2;
 
+    /* Unpack a batch and return its first message */
+    if (msg == MSG_MESSAGE_BATCH) {
+        if (!readBatch())
+            return -1;
+        return receiveMessage();
+    }
+
     return msg;
 }
 
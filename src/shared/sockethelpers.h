@@ -24,6 +24,9 @@
 #include <string>
 #include <sys/types.h>
 
+/* Forward declaration */
+struct PerfCounters;
+
 /* Remove the socket file and return error */
 int removeSocket();
 
@@ -33,6 +36,10 @@ bool initSocketProgram(pid_t fork_pid);
 #else
 /* Initiate a socket connection with libTAS */
 bool initSocketGame(void);
+
+/* Returns if the memory area is the channel shared with the program, which
+ * must not be saved nor restored in savestates */
+bool isChannelArea(const void* addr, size_t size);
 #endif
 
 /* Close the socket connection */
@@ -44,6 +51,24 @@ void lockSocket(void);
 /* Unlock access to socket */
 void unlockSocket(void);
 
+/* Start a batch of messages. All following sends are accumulated in a
+ * buffer and sent in a single write, either when flushMessageBatch() is called
+ * or before the next receive, so that batching never blocks the other side.
+ */
+void beginMessageBatch(void);
+
+/* Send the current batch of messages if any, and stop batching.
+ * Returns -1 on error. */
+int flushMessageBatch(void);
+
+/* Return the number of syscalls made by the message functions since the
+ * last call, for instrumentation */
+unsigned int fetchSocketSyscallCount(void);
+
+/* Return the performance counters inside the memory shared between the game
+ * and the program, or nullptr if there is no shared memory */
+PerfCounters* getSharedPerfCounters(void);
+
 /* Send data over the socket. Data is stored at the beginning of
  * pointer elem, and has the specified size in bytes.
  */
@@ -0,0 +1,67 @@
+#!/bin/sh
+# Check that batch mode plays a short movie to the end and reports a sync.
+#
+# Usage: ./batchtest.sh [frames]
+#
+# Builds a movie of `frames` empty frames, and plays it in batch mode on the
+# savestatebench synthetic game (under xvfb-run if there is no display), with
+# a checksum of a memory range of the game to also check that it is computed.
+# Exits with 0 if libTAS reported a sync.
+# Set LIBTAS to the libTAS executable if it is not in PATH.
+
+FRAMES=${1:-60}
+LIBTAS=${LIBTAS:-libTAS}
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d /tmp/libTAS-batchtest.XXXXXX)
+
+make -C "$DIR" savestatebench >/dev/null || exit 1
+
+# A movie file is a gzipped tar archive of a config file and an input file,
+# with one line per frame
+cat > "$WORK/config.ini" <<END
+[General]
+frame_count=$FRAMES
+mouse_support=false
+nb_controllers=0
+initial_time_sec=1
+initial_time_nsec=0
+initial_monotonic_time_sec=1
+initial_monotonic_time_nsec=0
+framerate_num=60
+framerate_den=1
+auto_restart=false
+variable_framerate=false
+END
+
+i=0
+while [ $i -lt "$FRAMES" ]; do
+    echo "|" >> "$WORK/inputs"
+    i=$((i + 1))
+done
+
+tar -czf "$WORK/batchtest.ltm" -C "$WORK" config.ini inputs || exit 1
+
+# The game runs longer than the movie, so that libTAS is the one stopping it.
+# The checksum covers the ELF header of the game, which is built as a
+# position-dependent executable so that it is loaded at 0x400000.
+RUN="$LIBTAS --batch --read $WORK/batchtest.ltm --checksum 400000:40 $DIR/savestatebench 1 0 $((FRAMES * 2))"
+if [ -z "$DISPLAY" ]; then
+    REPORT=$(xvfb-run -a $RUN)
+else
+    REPORT=$($RUN)
+fi
+RET=$?
+
+echo "$REPORT"
+rm -rf "$WORK"
+
+if [ $RET -ne 0 ]; then
+    echo "FAIL: exit code $RET"
+    exit 1
+fi
+
+case "$REPORT" in
+    *'"status": "sync"'*'"checksum": '*) echo "PASS" ;;
+    *) echo "FAIL: no sync or no checksum in report"; exit 1 ;;
+esac
@@ -0,0 +1,89 @@
+// Micro-benchmark of the audio mixing bus, to be built with the test Makefile
+// Usage: ./mixbench [frames]
+//
+// For several numbers of sources, it mixes one frame (1/60 s) of 48 kHz
+// stereo 16-bit samples per source, either with the former per-source mixing
+// that clamps into the output buffer, or with the mixing bus that accumulates
+// all sources and clamps once.
+
+#include "audio/AudioMixer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+
+#define FREQUENCY 48000
+#define CHANNELS 2
+#define SAMPLES (FREQUENCY / 60)
+
+using namespace libtas;
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Former mixing of a single source into the output buffer
+static int mixLegacy(const int16_t* in, int16_t* out, int nbSamples, int lvas, int rvas)
+{
+    int nbSaturate = 0;
+    for (int s=0; s<nbSamples*CHANNELS; s+=CHANNELS) {
+        int sumL = out[s] + ((in[s] * lvas) >> 16);
+        out[s] = (sumL < INT16_MIN) ? INT16_MIN : ((sumL > INT16_MAX) ? INT16_MAX : sumL);
+        nbSaturate += (sumL < INT16_MIN) || (sumL > INT16_MAX);
+
+        int sumR = out[s+1] + ((in[s+1] * rvas) >> 16);
+        out[s+1] = (sumR < INT16_MIN) ? INT16_MIN : ((sumR > INT16_MAX) ? INT16_MAX : sumR);
+        nbSaturate += (sumR < INT16_MIN) || (sumR > INT16_MAX);
+    }
+    return nbSaturate;
+}
+
+int main(int argc, char** argv)
+{
+    int frames = (argc > 1) ? atoi(argv[1]) : 600;
+    const int source_counts[] = {8, 32, 64, 128, 256};
+    const int max_sources = 256;
+
+    // Quiet random samples, so that mixing rarely saturates
+    std::vector<std::vector<int16_t>> sources(max_sources);
+    srand(1);
+    for (auto& source : sources) {
+        source.resize(SAMPLES * CHANNELS);
+        for (auto& sample : source)
+            sample = (rand() % 1024) - 512;
+    }
+
+    std::vector<int16_t> out(SAMPLES * CHANNELS);
+    std::vector<float> bus(SAMPLES * CHANNELS);
+
+    printf("sources  legacy (us/frame)  bus (us/frame)  speedup\n");
+    for (int nb_sources : source_counts) {
+        int saturate = 0;
+
+        double start = now();
+        for (int f = 0; f < frames; f++) {
+            std::fill(out.begin(), out.end(), 0);
+            for (int s = 0; s < nb_sources; s++)
+                saturate += mixLegacy(sources[s].data(), out.data(), SAMPLES, 52428, 39321);
+        }
+        double legacy = (now() - start) * 1e6 / frames;
+
+        start = now();
+        for (int f = 0; f < frames; f++) {
+            std::fill(bus.begin(), bus.end(), 0.0f);
+            for (int s = 0; s < nb_sources; s++)
+                AudioMixer::accumulate(bus.data(), reinterpret_cast<const uint8_t*>(sources[s].data()), SAMPLES, CHANNELS, 16, 0.8f, 0.6f);
+            saturate += AudioMixer::store(bus.data(), reinterpret_cast<uint8_t*>(out.data()), SAMPLES, CHANNELS, 16);
+        }
+        double mixbus = (now() - start) * 1e6 / frames;
+
+        printf("%7d  %17.1f  %14.1f  %6.2fx  (%d saturated)\n", nb_sources, legacy, mixbus, legacy / mixbus, saturate);
+    }
+
+    return 0;
+}
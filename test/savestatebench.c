@@ -0,0 +1,88 @@
+// Synthetic game for benchmarking savestates, to be run with savestatebench.sh
+// Usage: ./savestatebench [heap_mb] [dirty_percent] [frames]
+//
+// It allocates a heap of heap_mb megabytes, and each frame writes into
+// dirty_percent of its pages, then presents a small image with XShmPutImage
+// so that libTAS reaches a frame boundary. Works under Xvfb.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/mman.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+
+#define PAGE_SIZE 4096
+#define WIDTH 64
+#define HEIGHT 64
+
+int main(int argc, char** argv)
+{
+    size_t heap_mb = (argc > 1) ? strtoul(argv[1], NULL, 10) : 64;
+    int dirty_percent = (argc > 2) ? atoi(argv[2]) : 10;
+    int frames = (argc > 3) ? atoi(argv[3]) : 600;
+
+    size_t heap_size = heap_mb * 1024 * 1024;
+    size_t page_count = heap_size / PAGE_SIZE;
+    size_t dirty_count = page_count * dirty_percent / 100;
+
+    char* heap = mmap(NULL, heap_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (heap == MAP_FAILED) {
+        printf("Could not allocate %zu MB\n", heap_mb);
+        return 1;
+    }
+
+    /* Commit all pages with non-zero content */
+    for (size_t p = 0; p < page_count; p++)
+        memset(heap + p * PAGE_SIZE, (int)(p & 0xff) | 1, PAGE_SIZE);
+
+    Display* display = XOpenDisplay(NULL);
+    if (!display) {
+        printf("Could not open display\n");
+        return 1;
+    }
+
+    int screen = DefaultScreen(display);
+    Window window = XCreateSimpleWindow(display, RootWindow(display, screen),
+        0, 0, WIDTH, HEIGHT, 0, BlackPixel(display, screen), BlackPixel(display, screen));
+    XMapWindow(display, window);
+    GC gc = XCreateGC(display, window, 0, NULL);
+
+    XShmSegmentInfo shminfo;
+    XImage* image = XShmCreateImage(display, DefaultVisual(display, screen),
+        DefaultDepth(display, screen), ZPixmap, NULL, &shminfo, WIDTH, HEIGHT);
+    shminfo.shmid = shmget(IPC_PRIVATE, image->bytes_per_line * image->height, IPC_CREAT | 0600);
+    shminfo.shmaddr = image->data = shmat(shminfo.shmid, NULL, 0);
+    shminfo.readOnly = False;
+    XShmAttach(display, &shminfo);
+    XSync(display, False);
+
+    printf("Running %d frames with %zu MB heap, dirtying %zu pages per frame\n", frames, heap_mb, dirty_count);
+
+    /* Deterministic page selection */
+    uint32_t seed = 12345;
+
+    for (int f = 0; f < frames; f++) {
+        for (size_t d = 0; d < dirty_count; d++) {
+            seed = seed * 1103515245 + 12345;
+            size_t p = (seed >> 8) % page_count;
+            heap[p * PAGE_SIZE + (f % PAGE_SIZE)] = (char)f;
+        }
+
+        memset(image->data, f & 0xff, image->bytes_per_line * image->height);
+        XShmPutImage(display, window, gc, image, 0, 0, 0, 0, WIDTH, HEIGHT, False);
+        XSync(display, False);
+    }
+
+    XShmDetach(display, &shminfo);
+    XDestroyImage(image);
+    shmdt(shminfo.shmaddr);
+    shmctl(shminfo.shmid, IPC_RMID, NULL);
+    XCloseDisplay(display);
+    munmap(heap, heap_size);
+    return 0;
+}
@@ -0,0 +1,28 @@
+-- Lua script driving savestatebench, see savestatebench.sh
+-- Alternates a savestate and a loadstate on slot 1 every SAVESTATE_BENCH_PERIOD
+-- frames, SAVESTATE_BENCH_COUNT times.
+
+local count = tonumber(os.getenv("SAVESTATE_BENCH_COUNT")) or 10
+local period = tonumber(os.getenv("SAVESTATE_BENCH_PERIOD")) or 10
+
+-- Frames are counted here, because loading states rewinds the frame count
+local ticks = 0
+local saves = 0
+local loads = 0
+
+function onFrame()
+    ticks = ticks + 1
+    if loads >= count or ticks % period ~= 0 then
+        return
+    end
+
+    if saves == loads then
+        runtime.saveState(1)
+        saves = saves + 1
+    else
+        runtime.loadState(1)
+        loads = loads + 1
+    end
+end
+
+callback.onFrame(onFrame)
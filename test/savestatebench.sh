@@ -0,0 +1,46 @@
+#!/bin/sh
+# Benchmark savestate and loadstate timings with a synthetic game.
+#
+# Usage: ./savestatebench.sh [heap_mb] [dirty_percent] [count]
+#
+# Runs savestatebench under libTAS (non-interactive, under xvfb-run if there
+# is no display), performing `count` savestates and loadstates, and reports
+# the average timing of each checkpoint phase in ms and the state size.
+# Savestate settings (incremental, RAM, compression...) are the ones stored
+# in the libTAS configuration of the savestatebench game.
+# Set LIBTAS to the libTAS executable if it is not in PATH.
+
+HEAP_MB=${1:-64}
+DIRTY_PERCENT=${2:-10}
+COUNT=${3:-10}
+LIBTAS=${LIBTAS:-libTAS}
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+STATS=$(mktemp /tmp/libTAS-savestatebench.XXXXXX)
+
+make -C "$DIR" savestatebench >/dev/null || exit 1
+
+# Enough frames to perform all savestates and loadstates
+PERIOD=10
+FRAMES=$(( (COUNT * 2 + 2) * PERIOD ))
+
+export LIBTAS_CHECKPOINT_STATS="$STATS"
+export SAVESTATE_BENCH_COUNT="$COUNT"
+export SAVESTATE_BENCH_PERIOD="$PERIOD"
+
+RUN="$LIBTAS -n --lua $DIR/savestatebench.lua $DIR/savestatebench $HEAP_MB $DIRTY_PERCENT $FRAMES"
+if [ -z "$DISPLAY" ]; then
+    xvfb-run -a $RUN
+else
+    $RUN
+fi
+
+echo "heap ${HEAP_MB} MB, ${DIRTY_PERCENT}% pages dirtied per frame"
+awk '{ n[$1]++; s[$1]+=$3; f[$1]+=$4; a[$1]+=$5; r[$1]+=$6; z[$1]+=$7; io[$1]+=$8 }
+    END {
+        printf "%-5s %5s %10s %10s %10s %10s %10s %14s\n", "op", "count", "suspend", "files", "areas", "(io)", "resume", "size";
+        for (op in n)
+            printf "%-5s %5d %10.3f %10.3f %10.3f %10.3f %10.3f %14d\n", op, n[op], s[op]/n[op], f[op]/n[op], a[op]/n[op], io[op]/n[op], r[op]/n[op], z[op]/n[op];
+    }' "$STATS"
+
+rm -f "$STATS"